@@ -1,8 +1,12 @@
 #ifndef CONST_H_INCLUDED
 #define CONST_H_INCLUDED
 #include <stdbool.h>
-#include "mAbassi.h"          /* MUST include "SAL.H" and not uAbassi.h        */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#ifndef SCREEN_WIDTH
 #define SCREEN_WIDTH 800
+#endif
 #define SCREEN_HEIGHT 480
 #define COLOR_DEPTH 32
 
@@ -20,6 +24,24 @@
 #define HORI true
 #define VERTI false
 
+// Boards in game, one player each (more than 2: boards linked in a ring)
+#ifndef GAME_PLAYERS
+#define GAME_PLAYERS 2
+#endif
+#define MAX_PLAYERS 16		// Player id is 4 bits in the SPI words
+#if (GAME_PLAYERS < 2) || (GAME_PLAYERS > MAX_PLAYERS)
+#error "GAME_PLAYERS must be between 2 and MAX_PLAYERS"
+#endif
+
+// Player moved by this board (0 to GAME_PLAYERS-1, each board is built with its own)
+#ifndef OWN_PLAYER
+#define OWN_PLAYER 1
+#endif
+
+// Sender of a SPI word (bits [20:23], same place in every word format)
+#define WORD_ID_SHIFT	20
+#define WORD_ID(w)		(((w) >> WORD_ID_SHIFT) & 0xF)
+
 typedef enum{UP,DOWN,LEFT,RIGHT}DIR;
 
 typedef struct{
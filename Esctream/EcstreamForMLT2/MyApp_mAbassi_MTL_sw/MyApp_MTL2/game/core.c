@@ -0,0 +1,206 @@
+#include "Const.h"
+#include <stdlib.h>
+#include "core.h"
+
+bool notcuty(LINE* line, PLAYER* player)
+{
+    if(line->interrupt==false){
+        return true;
+    }
+    else{
+        switch (line->dir){
+        case UP:
+            if(player->y+PLAYER_HEIGHT<line->stop_at)
+                return false;
+            else
+                return true;
+            break;
+        case DOWN:
+        	if(player->y>line->stop_at)
+                return false;
+        	else
+        		return true;
+            break;
+        default:	// Horizontal line
+        	return true;
+        }
+    }
+}
+
+bool notcutx(LINE* line,PLAYER* player){
+    if(line->interrupt==false){
+        return true;
+    }
+    else{
+        switch (line->dir){
+        case LEFT:
+            if(player->x+PLAYER_WIDTH<line->stop_at)
+                return false;
+            else
+                return true;
+            break;
+        case RIGHT:
+        	if(player->x>line->stop_at)
+                return false;
+        	else
+        		return true;
+            break;
+        default:	// Vertical line
+        	return true;
+        }
+    }
+}
+
+// Direction of a 4px step towards the touched point (X, Y), as a MOVE_* code.
+// The code only depends on the relative position, so it can be sent to the
+// other board and replayed there by apply_move().
+uint8_t move_code(PLAYER *plyr, int X, int Y) {
+	int dist_x = (X-20)-plyr->x;
+	int dist_y = (Y-20)-plyr->y;
+	int major, minor;
+
+	if (abs(dist_x) > abs(dist_y)) {
+		major = (dist_x > 0) ? MOVE_RIGHT : MOVE_LEFT;
+		minor = (dist_y > 0) ? MOVE_MINOR_POS : ((dist_y < 0) ? MOVE_MINOR_NEG : 0);
+	}
+	else {
+		major = (dist_y > 0) ? MOVE_DOWN : MOVE_UP;
+		minor = (dist_x > 0) ? MOVE_MINOR_POS : ((dist_x < 0) ? MOVE_MINOR_NEG : 0);
+	}
+	return (uint8_t) (1 + major*3 + minor);
+}
+
+// Move player by one step (4px on the major axis, 1px on the minor one)
+// (record changes in the LVL structure)
+void apply_move(PLAYER *plyr, uint8_t code) {
+	if (code == MOVE_NONE || code > MOVE_LAST)
+		return;
+
+	int major = (code-1) / 3;
+	int minor = (code-1) % 3;
+
+	// Horizontal move
+	if (major == MOVE_RIGHT || major == MOVE_LEFT) {
+		if (major == MOVE_RIGHT && plyr->x+3<=800-40)
+			plyr->x = plyr->x+4;
+		else if (major == MOVE_LEFT && plyr->x-3>=0)
+			plyr->x = plyr->x-4;
+		if (minor == MOVE_MINOR_POS && plyr->y+1<=480-40)
+			plyr->y = plyr->y+1;
+		else if (minor == MOVE_MINOR_NEG && plyr->y-1>=0)
+			plyr->y = plyr->y-1;
+	}
+	// Vertical move
+	else {
+		if (major == MOVE_DOWN && plyr->y+3<=480-40)
+			plyr->y = plyr->y+4;
+		else if (major == MOVE_UP && plyr->y-3>=0)
+			plyr->y = plyr->y-4;
+		if (minor == MOVE_MINOR_POS && plyr->x+1<=800-40)
+			plyr->x = plyr->x+1;
+		else if (minor == MOVE_MINOR_NEG && plyr->x-1>=0)
+			plyr->x = plyr->x-1;
+	}
+}
+
+// Move player towards direction of touched point (X, Y) by 4px
+void incrCoordinate(PLAYER *plyr, int X, int Y) {
+	apply_move(plyr, move_code(plyr, X, Y));
+}
+
+bool success(LVL* lvl){
+    int nbr_succes=0;
+    for(int i=0;i<lvl->nbr_players;i++){
+      PLAYER* player=lvl->players+i;
+        if((player->fin_x<player->x+PLAYER_WIDTH && player->fin_x>player->x) && (player->fin_y<player->y+PLAYER_HEIGHT && player->fin_y>player->y)){
+        	nbr_succes++;
+        }
+    }
+    return nbr_succes==lvl->nbr_players;
+}
+
+
+// Player/line collisions: updates the interrupted lines, returns true on defeat.
+// One pass over every (line, player) pair, whatever the number of players.
+bool pos_correlator(LVL *lvl){
+	bool defeat = false;
+
+	// For each line of the level
+    for(int j=0; j<lvl->nbr_lines; j++)
+    {
+
+        LINE* line = lvl->lines+j;
+        bool blocked = false;	// A player of the other color is on the line
+
+        // For each player of the level
+        for(int i=0; i<lvl->nbr_players; i++)
+        {
+            PLAYER* player = lvl->players+i;
+            int lx = line->x;
+            int px = player->x;
+            int pxpw = player->x+PLAYER_WIDTH;
+            int lxlw = line->x+line->width;
+
+            if ((lx>px && lx<pxpw) ||( lxlw >px && lxlw<pxpw))
+            {
+            	// Player is cutting a line of same color
+                if (line->color == player->color)
+                {
+                    if (notcuty(line,player))
+                    {
+                    	// Update defeat
+                    	defeat = true;
+                    }
+                }
+                // Player is blocking a line of opposite color
+                else
+                {
+                	// Update line informations
+                    line->interrupt=true;
+                    blocked=true;
+                    if(line->dir==UP)
+                    {
+                        line->stop_at=player->y+PLAYER_HEIGHT;
+                    }
+                    else if(line->dir==DOWN)
+                    {
+                        line->stop_at=player->y;
+                    }
+                }
+           }
+           int ly=line->y;
+           int lylh=line->y+line->height;
+           int py=player->y;
+           int pyph=player->y+PLAYER_HEIGHT;
+           if((ly<pyph && ly>py) || (lylh>py && lylh <pyph ))
+           {
+        	    // Player is cutting a line of same color
+                if(line->color==player->color)
+                {
+                    if(notcutx(line,player))
+                    {
+                    	// Update defeat
+                    	defeat = true;
+                    }
+                }
+                // Player is blocking a line of opposite color
+                else{
+                	// Update line informations
+                    line->interrupt=true;
+                    blocked=true;
+                    if(line->dir==LEFT){
+                        line->stop_at=player->x+PLAYER_WIDTH;
+                    }
+                    else if(line->dir==RIGHT){
+                        line->stop_at=player->x;
+                    }
+                }
+            }
+        }
+        // No line interrupt
+        if(!blocked){
+            line->interrupt=false;
+        }
+    }
+    return defeat;
+}
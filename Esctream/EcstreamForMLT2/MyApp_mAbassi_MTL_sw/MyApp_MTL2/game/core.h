@@ -0,0 +1,38 @@
+/*
+ * core.h
+ *
+ *  Game rules shared by the board, the Linux host build (../host) and the
+ *  PC port: player moves, line collisions and victory. No RTOS nor hardware.
+ */
+
+#ifndef GAME_CORE_H_
+#define GAME_CORE_H_
+#include "Const.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Player step codes (0 = no move, 1 + major*3 + minor otherwise)
+#define MOVE_NONE		0
+#define MOVE_LAST		12
+#define MOVE_RIGHT		0	// Major axis
+#define MOVE_LEFT		1
+#define MOVE_DOWN		2
+#define MOVE_UP			3
+#define MOVE_MINOR_POS	1	// Minor axis (+1px / -1px)
+#define MOVE_MINOR_NEG	2
+
+bool notcuty(LINE* line, PLAYER* player);
+bool notcutx(LINE* line, PLAYER* player);
+bool pos_correlator(LVL* lvl);
+bool success(LVL* lvl);
+uint8_t move_code(PLAYER *plyr, int X, int Y);
+void apply_move(PLAYER *plyr, uint8_t code);
+void incrCoordinate(PLAYER *plyr, int X, int Y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GAME_CORE_H_ */
@@ -0,0 +1,99 @@
+#include <Const.h>
+#include <string.h>
+#include "frame.h"
+
+// CRC-32 (IEEE 802.3), 4 bits at a time so the table stays small in the ISR
+static const uint32_t crc_table[16] = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32(const uint32_t *word, int n){
+	uint32_t crc = 0xFFFFFFFF;
+	int i, k;
+	for (i=0; i<n; i++) {
+		crc ^= word[i];
+		for (k=0; k<8; k++)
+			crc = (crc >> 4) ^ crc_table[crc & 0xF];
+	}
+	return ~crc;
+}
+
+// Start a frame, the payload is added with FRAME_Add()
+void FRAME_Begin(FRAME *f, int id, int type, uint8_t seq, uint32_t time){
+	f->word[0] = FRAME_HEADER(id, type, seq, 0);
+	f->word[1] = time;
+	f->len = 2;
+	f->pos = 0;
+}
+
+// false when the frame is full
+bool FRAME_Add(FRAME *f, uint32_t word){
+	if (FRAME_FULL(f))
+		return false;
+	f->word[f->len++] = word;
+	return true;
+}
+
+// Set the payload count and append the CRC, the frame can then be sent
+void FRAME_End(FRAME *f){
+	f->word[0] = (f->word[0] & ~0xFF) | (f->len - 2);
+	f->word[f->len] = crc32(f->word, f->len);
+	f->len++;
+	f->pos = 0;
+}
+
+// Next word to send, false once the whole frame is sent
+bool FRAME_NextWord(FRAME *f, uint32_t *word){
+	if (f->pos >= f->len)
+		return false;
+	*word = f->word[f->pos++];
+	return true;
+}
+
+void FRAME_RxInit(FRAME_RX *rx){
+	memset(rx, 0, sizeof(FRAME_RX));
+}
+
+// Check a whole frame of n words where it lies (a received packet)
+int FRAME_Check(FRAME_RX *rx, const uint32_t *word, int n){
+	int id, seq, behind;
+
+	if (n < FRAME_OVERHEAD || !FRAME_IS_HEADER(word[0]) || (int) (word[0] & 0xFF) + FRAME_OVERHEAD != n) {
+		rx->crc_errors++;
+		return FRAME_RX_CRC;
+	}
+	if (crc32(word, n - 1) != word[n - 1]) {
+		rx->crc_errors++;
+		return FRAME_RX_CRC;
+	}
+	// The sender restarted when the sequence went back further than the window
+	id = (word[0] >> 20) & 0xF;
+	seq = (word[0] >> 8) & 0xFF;
+	behind = (uint8_t) (rx->seq[id] - seq);
+	if ((rx->known & (1u << id)) && behind < FRAME_STALE_WINDOW) {
+		rx->stale++;
+		return FRAME_RX_STALE;
+	}
+	rx->known |= 1u << id;
+	rx->seq[id] = seq;
+	rx->good++;
+	return FRAME_RX_OK;
+}
+
+// Feed a received word. Outside of a frame anything but a header is ignored;
+// after a bad CRC the receiver waits for the next header.
+int FRAME_RxWord(FRAME_RX *rx, uint32_t word){
+	FRAME *f = &rx->frame;
+
+	if (f->pos == 0) {
+		if (!FRAME_IS_HEADER(word))
+			return FRAME_RX_NONE;
+		f->len = (word & 0xFF) + FRAME_OVERHEAD;
+	}
+	f->word[f->pos++] = word;
+	if (f->pos < f->len)
+		return FRAME_RX_NONE;
+	f->pos = 0;
+	return FRAME_Check(rx, f->word, f->len);
+}
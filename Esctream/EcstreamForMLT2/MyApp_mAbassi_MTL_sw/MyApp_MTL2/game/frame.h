@@ -0,0 +1,74 @@
+/*
+ * frame.h
+ *
+ *  Frames of the board to board SPI link. A frame batches every link word
+ *  (gui.h, lockstep.h) a board has to send at a time:
+ *
+ *  word 0			header: FRAME_MAGIC [24:31], sender id [20:23], type [16:19],
+ *					sequence [8:15], payload words [0:7]
+ *  word 1			time_us() of the sender when the frame was built, the shared
+ *					clock in us (sync_now(), ptpsync.h) when GAME_SYNC
+ *  words 2..		payload
+ *  last word		CRC-32 of the words before it
+ *
+ *  Between frames FRAME_IDLE is sent. The SPI ISR builds and checks the
+ *  frames word by word, so the game task only sees the payload of complete,
+ *  valid and new frames. Over UDP (netsync.h) a datagram holds one frame.
+ */
+
+#ifndef GAME_FRAME_H_
+#define GAME_FRAME_H_
+#include "Const.h"
+
+#define FRAME_MAGIC			0xA5
+#define FRAME_IDLE			0x00000000
+#define FRAME_PAYLOAD_MAX	16				// Payload words in a frame
+#define FRAME_OVERHEAD		3				// Header, time and CRC
+#define FRAME_WORDS_MAX		(FRAME_PAYLOAD_MAX + FRAME_OVERHEAD)
+#define FRAME_STALE_WINDOW	16				// Sequences behind the last one dropped as replays
+#define FRAME_REFRESH_US	100000			// Own state sent again after this long without change
+
+// Payload types
+#define FRAME_WORDS			1				// Link words, see gui.h and lockstep.h
+
+#define FRAME_HEADER(id, type, seq, n)	(((uint32_t) FRAME_MAGIC << 24) | (((id) & 0xF) << 20) | (((type) & 0xF) << 16) | (((seq) & 0xFF) << 8) | ((n) & 0xFF))
+#define FRAME_IS_HEADER(w)	(((w) >> 24) == FRAME_MAGIC && ((w) & 0xFF) <= FRAME_PAYLOAD_MAX)
+#define FRAME_ID(f)			(((f)->word[0] >> 20) & 0xF)
+#define FRAME_TYPE(f)		(((f)->word[0] >> 16) & 0xF)
+#define FRAME_SEQ(f)		(((f)->word[0] >> 8) & 0xFF)
+#define FRAME_COUNT(f)		((f)->word[0] & 0xFF)
+#define FRAME_TIME(f)		((f)->word[1])
+#define FRAME_PAYLOAD(f)	((f)->word + 2)
+#define FRAME_FULL(f)		((f)->len >= FRAME_WORDS_MAX - 1)
+
+typedef struct{
+	uint32_t word[FRAME_WORDS_MAX];
+	int      len;			// Words in word[]
+	int      pos;			// Next word to send, or to receive
+}FRAME;
+
+// Result of FRAME_RxWord()
+#define FRAME_RX_NONE		0				// Frame not complete yet
+#define FRAME_RX_OK			1				// rx->frame holds a new frame
+#define FRAME_RX_CRC		2				// Frame dropped, bad CRC
+#define FRAME_RX_STALE		3				// Frame dropped, sequence already seen
+
+typedef struct{
+	FRAME    frame;			// Frame being received, then the last one received
+	uint32_t known;			// Senders a frame was received from (one bit per id)
+	uint8_t  seq[MAX_PLAYERS];	// Last sequence received from each sender
+	// Statistics
+	uint32_t good;
+	uint32_t crc_errors;
+	uint32_t stale;
+}FRAME_RX;
+
+void FRAME_Begin(FRAME *f, int id, int type, uint8_t seq, uint32_t time);
+bool FRAME_Add(FRAME *f, uint32_t word);
+void FRAME_End(FRAME *f);
+bool FRAME_NextWord(FRAME *f, uint32_t *word);
+void FRAME_RxInit(FRAME_RX *rx);
+int FRAME_RxWord(FRAME_RX *rx, uint32_t word);
+int FRAME_Check(FRAME_RX *rx, const uint32_t *word, int n);
+
+#endif /* GAME_FRAME_H_ */
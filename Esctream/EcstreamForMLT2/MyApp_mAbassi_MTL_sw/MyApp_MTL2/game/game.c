@@ -4,167 +4,13 @@
 #include <string.h>
 
 #include "mAbassi.h"          /* MUST include "SAL.H" and not uAbassi.h        */
-#include "Platform.h"         /* Everything about the target platform is here  */
-#include "HWinfo.h"           /* Everything about the target hardware is here  */
 #include "SysCall.h"          /* System Call layer stuff     */
 
-#include "arm_pl330.h"
-#include "dw_i2c.h"
-#include "cd_qspi.h"
-#include "dw_sdmmc.h"
-#include "dw_spi.h"
-#include "dw_uart.h"
-#include "alt_gpio.h"
-
 #include "gui.h"
+#include "telemetry.h"
 
 // #include "game.h"
 
-int abs (int a) {
-	if (a>0) { return a; }
-	else { return -a; }
-}
-
-bool notcuty(LINE* line, PLAYER* player)
-{
-    if(line->interrupt==false){
-        return true;
-    }
-    else{
-        switch (line->dir){
-        case UP:
-            if(player->y+PLAYER_HEIGHT<line->stop_at)
-                return false;
-            else
-                return true;
-            break;
-        case DOWN:
-        	if(player->y>line->stop_at)
-                return false;
-        	else
-        		return true;
-            break;
-        }
-    }
-}
-
-bool notcutx(LINE* line,PLAYER* player){
-    if(line->interrupt==false){
-        return true;
-    }
-    else{
-        switch (line->dir){
-        case LEFT:
-            if(player->x+PLAYER_WIDTH<line->stop_at)
-                return false;
-            else
-                return true;
-            break;
-        case RIGHT:
-        	if(player->x>line->stop_at)
-                return false;
-        	else
-        		return true;
-            break;
-        }
-    }
-}
-
-bool success(LVL* lvl){
-    int nbr_succes=0;
-    for(int i=0;i<lvl->nbr_players;i++){
-      PLAYER* player=lvl->players+i;
-        if((player->fin_x<player->x+PLAYER_WIDTH && player->fin_x>player->x) && (player->fin_y<player->y+PLAYER_HEIGHT && player->fin_y>player->y)){
-        	nbr_succes++;
-            printf("success - One player at final position\n");
-        }
-    }
-    return nbr_succes==lvl->nbr_players;
-}
-
-
-void pos_correlator(LVL *lvl){
-	// For each line of the level
-    for(int j=0; j<lvl->nbr_lines; j++)
-    {
-
-        LINE* line = lvl->lines+j;
-        bool no_interrupt[lvl->nbr_players]; //permet de remettre  false line->interrupt quand il n'y a plus d'interrupt
-
-        // For each player of the level
-        for(int i=0; i<lvl->nbr_players; i++)
-        {
-            PLAYER* player = lvl->players+i;
-            int lx = line->x;
-            int px = player->x;
-            int pxpw = player->x+PLAYER_WIDTH;
-            int lxlw = line->x+line->width;
-
-            no_interrupt[i] = true;
-
-            if ((lx>px && lx<pxpw) ||( lxlw >px && lxlw<pxpw))
-            {
-            	// Player is cutting a line of same color
-                if (line->color == player->color)
-                {
-                    if (notcuty(line,player))
-                    {
-                    	// Update defeat
-                    	*flag = (*flag) | 0x00000002;
-                    }
-                }
-                // Player is blocking a line of opposite color
-                else
-                {
-                	// Update line informations
-                    line->interrupt=true;
-                    no_interrupt[i]=false;
-                    if(line->dir==UP)
-                    {
-                        line->stop_at=player->y+PLAYER_HEIGHT;
-                    }
-                    else if(line->dir==DOWN)
-                    {
-                        line->stop_at=player->y;
-                    }
-                }
-           }
-           int ly=line->y;
-           int lylh=line->y+line->height;
-           int py=player->y;
-           int pyph=player->y+PLAYER_HEIGHT;
-           if((ly<pyph && ly>py) || (lylh>py && lylh <pyph ))
-           {
-        	    // Player is cutting a line of same color
-                if(line->color==player->color)
-                {
-                    if(notcutx(line,player))
-                    {
-                    	// Update defeat
-                    	*flag = (*flag) | 0x00000002;
-                    }
-                }
-                // Player is blocking a line of opposite color
-                else{
-                	// Update line informations
-                    line->interrupt=true;
-                    no_interrupt[i]=false;
-                    if(line->dir==LEFT){
-                        line->stop_at=player->x+PLAYER_WIDTH;
-                    }
-                    else if(line->dir==RIGHT){
-                        line->stop_at=player->x;
-                    }
-                }
-            }
-        }
-        // No line interrupt
-        if(no_interrupt[0] && no_interrupt[1]){
-            line->interrupt=false;
-        }
-    }
-}
-
 IMAGE* initimage(const char *filename, int height, int width)
 {
 	IMAGE *img = malloc(sizeof(IMAGE));
@@ -209,6 +55,8 @@ IMAGE* initimage(const char *filename, int height, int width)
     	j++;
     } while (j<height);
     printf("initimage - Image fully %s stored in memory (%d rows)\n", img->name, img->height);
+    TELEM_Count(&gameStats.images, 1);
+    TELEM_Count(&gameStats.image_bytes, (int32_t) (img->rowsize*img->height));
 
     // Close file
 	int c = close(img->FdSrc);
@@ -220,6 +68,8 @@ IMAGE* initimage(const char *filename, int height, int width)
 
 void suppressimage(IMAGE* img)
 {
+	TELEM_Count(&gameStats.images, -1);
+	TELEM_Count(&gameStats.image_bytes, -(int32_t) (img->rowsize*img->height));
 	free(img->name);
 	free(img->g_Buffer);
 	free(img);
@@ -9,10 +9,8 @@
 #define GAME_GAME_H_
 #include "Const.h"
 #include "vip_fr.h"
+#include "core.h"
 
-int abs(int a);
-void pos_correlator(LVL* lvl);
-bool success(LVL* lvl);
 extern int *flag;
 
 IMAGE* initimage(const char *filename, int height, int width);
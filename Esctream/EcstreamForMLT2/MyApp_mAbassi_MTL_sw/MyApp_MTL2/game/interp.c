@@ -0,0 +1,109 @@
+#include <Const.h>
+#include <string.h>
+#include "interp.h"
+#include "trace.h"
+
+static INTERP_SAMPLE* older(INTERP *ip, int back){
+	return ip->s + ((ip->head - back) & (INTERP_SAMPLES-1));
+}
+
+static int clamp(int v, int lo, int hi){
+	if (v < lo)
+		return lo;
+	if (v > hi)
+		return hi;
+	return v;
+}
+
+void INTERP_Init(INTERP *ip){
+	memset(ip, 0, sizeof(INTERP));
+	ip->interval = INTERP_DEFAULT_US;
+}
+
+// Record a position received from the other board at time t (us)
+void INTERP_Push(INTERP *ip, uint32_t t, int x, int y){
+	if (ip->count > 0) {
+		uint32_t gap = t - older(ip, 0)->t;
+		if (gap > INTERP_RESET_US) {
+			ip->count = 0;
+		}
+		else {
+			// Interval and jitter estimates (gain 1/8 and 1/16)
+			int32_t d = (int32_t) gap - (int32_t) ip->interval;
+			ip->interval += d / 8;
+			ip->jitter += ((d < 0 ? -d : d) - (int32_t) ip->jitter) / 16;
+		}
+	}
+
+	ip->head = (ip->head + 1) & (INTERP_SAMPLES-1);
+	ip->s[ip->head].t = t;
+	ip->s[ip->head].x = x;
+	ip->s[ip->head].y = y;
+	if (ip->count < INTERP_SAMPLES)
+		ip->count++;
+
+	ip->samples++;
+	if ((ip->samples % INTERP_REPORT) == 0)
+		TRACE_INFO("INTERP - interval %u us, jitter %u us, late %u, held %u\n", ip->interval, ip->jitter, ip->late, ip->held);
+}
+
+// Position to draw at time now (us), delayed by one sample interval.
+// Returns false if nothing was received yet.
+bool INTERP_Sample(INTERP *ip, uint32_t now, int *x, int *y){
+	INTERP_SAMPLE *a = NULL, *b;
+	uint32_t render;
+	int i;
+
+	if (ip->count == 0)
+		return false;
+
+	b = older(ip, 0);
+	if (ip->count == 1) {
+		*x = b->x;
+		*y = b->y;
+		return true;
+	}
+
+	render = now - ip->interval;
+
+	// Newest sample already in the past: dead reckoning with the last velocity
+	if ((int32_t) (render - b->t) >= 0) {
+		uint32_t ahead = render - b->t;
+		a = older(ip, 1);
+		if (ahead > INTERP_MAX_EXTRAP_US || b->t == a->t) {
+			ip->held++;
+			*x = b->x;
+			*y = b->y;
+		}
+		else {
+			int32_t dt = (int32_t) (b->t - a->t);
+			ip->late++;
+			*x = b->x + (int) (((int64_t) (b->x - a->x) * ahead) / dt);
+			*y = b->y + (int) (((int64_t) (b->y - a->y) * ahead) / dt);
+		}
+	}
+	else {
+		// Interpolate between the two samples around the render time
+		for (i=1; i<ip->count; i++) {
+			a = older(ip, i);
+			if ((int32_t) (render - a->t) >= 0)
+				break;
+			b = a;
+		}
+		if (i == ip->count) {
+			// Older than everything we kept
+			*x = b->x;
+			*y = b->y;
+		}
+		else {
+			int32_t dt = (int32_t) (b->t - a->t);
+			int32_t part = (int32_t) (render - a->t);
+			*x = a->x + (dt > 0 ? (int) (((int64_t) (b->x - a->x) * part) / dt) : 0);
+			*y = a->y + (dt > 0 ? (int) (((int64_t) (b->y - a->y) * part) / dt) : 0);
+		}
+	}
+
+	*x = clamp(*x, 0, SCREEN_WIDTH-PLAYER_WIDTH);
+	*y = clamp(*y, 0, SCREEN_HEIGHT-PLAYER_HEIGHT);
+	return true;
+}
@@ -0,0 +1,41 @@
+/*
+ * interp.h
+ *
+ *  Remote player smoother: received positions are buffered with their
+ *  arrival time and the remote player is drawn about one sample interval
+ *  in the past, so a late or bursty sample does not make it jump.
+ */
+
+#ifndef GAME_INTERP_H_
+#define GAME_INTERP_H_
+#include "Const.h"
+
+#define INTERP_SAMPLES			8			// Received positions kept (power of 2)
+#define INTERP_DEFAULT_US		50000		// Sample interval assumed before the first measure
+#define INTERP_MAX_EXTRAP_US	150000		// Dead reckoning limit, then hold the last sample
+#define INTERP_RESET_US			1000000		// Longer gaps (pause, level change) restart the buffer
+#define INTERP_REPORT			256			// Trace the statistics every N samples
+
+typedef struct{
+	uint32_t t;			// Arrival time (us)
+	int      x;
+	int      y;
+}INTERP_SAMPLE;
+
+typedef struct{
+	INTERP_SAMPLE s[INTERP_SAMPLES];
+	int      count;			// Valid samples (up to INTERP_SAMPLES)
+	int      head;			// Index of the newest sample
+	// Statistics
+	uint32_t interval;		// Smoothed inter-arrival time (us), used as render delay
+	uint32_t jitter;		// Smoothed |inter-arrival - interval| (us), RFC 3550 style
+	uint32_t samples;		// Samples received
+	uint32_t late;			// Draws that had to extrapolate
+	uint32_t held;			// Draws past INTERP_MAX_EXTRAP_US
+}INTERP;
+
+void INTERP_Init(INTERP *ip);
+void INTERP_Push(INTERP *ip, uint32_t t, int x, int y);
+bool INTERP_Sample(INTERP *ip, uint32_t now, int *x, int *y);
+
+#endif /* GAME_INTERP_H_ */
@@ -1,5 +1,6 @@
 #include <Const.h>
 #include <stdlib.h>
+#include "level.h"
 
 void new_player(LVL* level,int offset, int start_x, int start_y, int fin_x, int fin_y, int color){
     PLAYER* player=level->players+offset;
@@ -42,10 +43,18 @@ void reset_lvl(LVL* lvl){
 	}
 }
 
+// Levels are drawn for two players, the others start as copies of them
+static void add_players(LVL* lvl){
+	for(int i=lvl->nbr_players;i<GAME_PLAYERS;i++){
+		PLAYER* base = lvl->players+(i%lvl->nbr_players);
+		new_player(lvl,i,base->start_x,base->start_y,base->fin_x,base->fin_y,base->color);
+	}
+	lvl->nbr_players=GAME_PLAYERS;
+}
+
 void change_lvl(LVL* lvl,int lvl_num){
 	//free_lvl(lvl);
 	level(lvl_num,lvl);
-	printf("change lvl");
 }
 
 void level(int lvl_number, LVL *lvl){
@@ -178,6 +187,7 @@ void level(int lvl_number, LVL *lvl){
         break;
         }
         default:
-        break;
+        return;
     }
+    add_players(lvl);
 }
@@ -1,5 +1,7 @@
 #ifndef LEVEL_H_INCLUDED
 #define LEVEL_H_INCLUDED
+#include "Const.h"
+
 void level(int lvl_number, LVL *lvl);
 void endLevel(LVL* level);
 int test();
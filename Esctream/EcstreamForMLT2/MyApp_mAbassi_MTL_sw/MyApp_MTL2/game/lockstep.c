@@ -0,0 +1,187 @@
+#include <Const.h>
+#include <string.h>
+#include "game.h"
+#include "lockstep.h"
+#include "trace.h"
+
+// Rebuild a full counter from its "bits" low bits, choosing the value closest to ref
+static uint32_t unwrap(uint32_t ref, uint32_t low, int bits){
+	uint32_t mask = (1u << bits) - 1;
+	int32_t diff = (int32_t) ((low - ref) & mask);
+	if (diff >= (1 << (bits-1)))
+		diff -= (1 << bits);
+	return ref + diff;
+}
+
+static LS_INPUT* slot(LS_INPUT *tab, uint32_t tick){
+	return tab + (tick & (LOCKSTEP_WINDOW-1));
+}
+
+static void set_input(LS_INPUT *tab, uint32_t tick, uint8_t code){
+	LS_INPUT *in = slot(tab, tick);
+	in->tick = tick;
+	in->code = code;
+	in->valid = true;
+}
+
+static bool has_input(LS_INPUT *tab, uint32_t tick){
+	LS_INPUT *in = slot(tab, tick);
+	return in->valid && in->tick == tick;
+}
+
+static LS_HASH* hash_slot(LOCKSTEP *ls, uint32_t period){
+	LS_HASH *h = ls->hash + (period % LOCKSTEP_HASH_SLOTS);
+	if (h->period != period) {
+		// Recycle the slot of an older period
+		memset(h, 0, sizeof(LS_HASH));
+		h->period = period;
+	}
+	return h;
+}
+
+static void compare_hash(LOCKSTEP *ls, LS_HASH *h){
+	if (!h->has_local || !h->has_remote)
+		return;
+	for (int id=0; id<GAME_PLAYERS; id++) {
+		if ((h->has_remote & (1u << id)) && h->local != h->remote[id]) {
+			ls->desyncs++;
+			ls->desync_tick = h->period * LOCKSTEP_HASH_PERIOD;
+			TRACE_WARN("LOCKSTEP - Desync with player %d detected at tick %u (%04x != %04x)\n", id, ls->desync_tick, h->local, h->remote[id]);
+		}
+	}
+	// Only report a period once
+	h->has_remote = 0;
+}
+
+void LOCKSTEP_Init(LOCKSTEP *ls, int delay, int own){
+	memset(ls, 0, sizeof(LOCKSTEP));
+	if (delay < 0)
+		delay = 0;
+	if (delay > LOCKSTEP_WINDOW/2 - 1)
+		delay = LOCKSTEP_WINDOW/2 - 1;
+	ls->delay = delay;
+	ls->own = own;
+
+	// Nobody has input for the first delay ticks
+	for (uint32_t t=0; t<(uint32_t)delay; t++) {
+		for (int id=0; id<GAME_PLAYERS; id++)
+			set_input(ls->input[id], t, MOVE_NONE);
+	}
+	ls->next_local = delay;
+}
+
+// True if an own input may be scheduled (never run more than delay ticks ahead)
+bool LOCKSTEP_CanSchedule(LOCKSTEP *ls){
+	return ls->next_local <= ls->tick + ls->delay;
+}
+
+// Record the own input for the next tick (sent by LOCKSTEP_Resend())
+void LOCKSTEP_LocalInput(LOCKSTEP *ls, uint8_t code){
+	uint32_t tick = ls->next_local++;
+	set_input(ls->input[ls->own], tick, code);
+	ls->sent[tick & (LOCKSTEP_WINDOW-1)] = code;
+}
+
+// Payloads of the own inputs the other boards may still miss, oldest first, returns
+// how many (at most LOCKSTEP_WINDOW). Another board is never more than delay+1 ticks
+// behind this one, which schedules at most delay ticks ahead: the last 2*delay+1 do.
+int LOCKSTEP_Resend(LOCKSTEP *ls, uint32_t *words){
+	uint32_t first = (uint32_t) ls->delay;			// Ticks before are known to everyone
+	int n = 0;
+
+	if (ls->next_local > first + 2*ls->delay + 1)
+		first = ls->next_local - (2*ls->delay + 1);
+	for (uint32_t tick=first; tick<ls->next_local; tick++) {
+		uint8_t code = ls->sent[tick & (LOCKSTEP_WINDOW-1)];
+		words[n++] = ((uint32_t) ls->own << WORD_ID_SHIFT) | ((tick & ((1u << LS_TICK_BITS) - 1)) << 4) | (code & 0xF);
+	}
+	return n;
+}
+
+// Decode a word received from another board
+void LOCKSTEP_RemoteWord(LOCKSTEP *ls, uint32_t word){
+	int id = WORD_ID(word);
+	if (id >= GAME_PLAYERS || id == ls->own) {
+		ls->dropped++;
+		return;
+	}
+	if (word & LS_WORD_HASH) {
+		uint32_t period = unwrap(ls->tick / LOCKSTEP_HASH_PERIOD, (word >> 16) & ((1u << LS_PERIOD_BITS) - 1), LS_PERIOD_BITS);
+		LS_HASH *h = hash_slot(ls, period);
+		h->remote[id] = (uint16_t) (word & 0xFFFF);
+		h->has_remote |= 1u << id;
+		compare_hash(ls, h);
+	}
+	else {
+		uint32_t tick = unwrap(ls->tick, (word >> 4) & ((1u << LS_TICK_BITS) - 1), LS_TICK_BITS);
+		if ((int32_t) (tick - ls->tick) < 0)
+			return;					// Sent again, already simulated
+		if (tick - ls->tick >= LOCKSTEP_WINDOW) {
+			ls->dropped++;
+			return;
+		}
+		set_input(ls->input[id], tick, word & 0xF);	// Same code when sent again
+	}
+}
+
+// True if the inputs of every player are known for the next tick
+bool LOCKSTEP_Ready(LOCKSTEP *ls){
+	for (int id=0; id<GAME_PLAYERS; id++) {
+		if (!has_input(ls->input[id], ls->tick))
+			return false;
+	}
+	return true;
+}
+
+// Simulate one tick. Players are always moved in index order, so every board
+// computes the same state. Returns true (and the word to send) when a state hash is due.
+bool LOCKSTEP_Step(LOCKSTEP *ls, LVL *lvl, uint32_t *hashWord){
+	for (int i=0; i<lvl->nbr_players; i++) {
+		LS_INPUT *in = slot(ls->input[i], ls->tick);
+		apply_move(lvl->players+i, in->code);
+		in->valid = false;
+	}
+	if (pos_correlator(lvl))
+		*flag = (*flag) | 0x00000002;
+	if (success(lvl))
+		*flag = (*flag) | 0x00000004;
+
+	ls->tick++;
+
+	if ((ls->tick % LOCKSTEP_HASH_PERIOD) != 0)
+		return false;
+
+	uint32_t period = ls->tick / LOCKSTEP_HASH_PERIOD;
+	LS_HASH *h = hash_slot(ls, period);
+	h->local = LOCKSTEP_Hash(lvl);
+	h->has_local = true;
+	compare_hash(ls, h);
+
+	*hashWord = ((uint32_t) ls->own << WORD_ID_SHIFT) | LS_WORD_HASH | ((period & ((1u << LS_PERIOD_BITS) - 1)) << 16) | h->local;
+	return true;
+}
+
+// FNV-1a over everything the simulation decides, folded to 16 bits
+uint16_t LOCKSTEP_Hash(LVL *lvl){
+	uint32_t h = 2166136261u;
+	int v[2];
+
+	for (int i=0; i<lvl->nbr_players; i++) {
+		PLAYER *player = lvl->players+i;
+		v[0] = player->x;
+		v[1] = player->y;
+		for (int k=0; k<2; k++) {
+			h = (h ^ (uint32_t) v[k]) * 16777619u;
+		}
+	}
+	for (int j=0; j<lvl->nbr_lines; j++) {
+		LINE *line = lvl->lines+j;
+		v[0] = line->interrupt;
+		v[1] = line->interrupt ? line->stop_at : 0;
+		for (int k=0; k<2; k++) {
+			h = (h ^ (uint32_t) v[k]) * 16777619u;
+		}
+	}
+	h = (h ^ (uint32_t) (*flag & 0x00000006)) * 16777619u;	// Defeat & victory
+	return (uint16_t) ((h >> 16) ^ (h & 0xFFFF));
+}
@@ -0,0 +1,77 @@
+/*
+ * lockstep.h
+ *
+ *  Deterministic lockstep between the boards: each board only sends its
+ *  own per-tick input (a MOVE_* code) and all of them run the same simulation.
+ *  Nothing is acknowledged: every input goes again with the next ones (the
+ *  last 2*delay+1 ticks, LOCKSTEP_Resend()) and while no tick can be simulated,
+ *  so a lost word only delays the other boards. They keep one input per tick.
+ */
+
+#ifndef GAME_LOCKSTEP_H_
+#define GAME_LOCKSTEP_H_
+#include "Const.h"
+
+#ifndef GAME_LOCKSTEP
+#define GAME_LOCKSTEP			0	// 1: exchange inputs instead of positions
+#endif
+#ifndef LOCKSTEP_INPUT_DELAY
+#define LOCKSTEP_INPUT_DELAY	3	// Ticks between sampling an input and simulating it
+#endif
+#define LOCKSTEP_WINDOW			32	// Max ticks in flight (power of 2, > 2*delay)
+#define LOCKSTEP_HASH_PERIOD	16	// State hash exchanged every N ticks
+#define LOCKSTEP_HASH_SLOTS		8	// Hashes kept while waiting for the other boards
+#define LOCKSTEP_TICK_MS		20	// Minimum time between two local inputs
+#define LOCKSTEP_STALL_MS		100	// Own inputs sent again after this long without a tick
+
+// Structure of SPI_RXDATA / SPI_TXDATA in lockstep mode:
+// bits [28:31]		level
+// bits [24:27]		flag
+// bits [20:23]		player id
+// bit  [19]		0 = input, 1 = state hash
+// input:	bits [4:18] tick,		bits [0:3]  move code
+// hash:	bits [16:18] tick/LOCKSTEP_HASH_PERIOD,	bits [0:15] hash
+#define LS_WORD_HASH		0x00080000
+#define LS_WORD_PAYLOAD		0x00FFFFFF
+#define LS_TICK_BITS		15
+#define LS_PERIOD_BITS		3		// Enough for LOCKSTEP_HASH_SLOTS periods
+
+typedef struct{
+	uint32_t tick;		// Tick this input is for
+	uint8_t  code;		// MOVE_* code
+	bool     valid;
+}LS_INPUT;
+
+typedef struct{
+	uint32_t period;	// tick/LOCKSTEP_HASH_PERIOD
+	uint16_t local;
+	uint16_t remote[GAME_PLAYERS];
+	bool     has_local;
+	uint32_t has_remote;	// One bit per player
+}LS_HASH;
+
+typedef struct{
+	int      delay;			// Input delay, in ticks
+	int      own;			// Index of the own player
+	uint32_t tick;			// Next tick to simulate
+	uint32_t next_local;	// Next tick own input is scheduled for
+	LS_INPUT input[GAME_PLAYERS][LOCKSTEP_WINDOW];	// Inputs of every player, own included
+	uint8_t  sent[LOCKSTEP_WINDOW];	// Own inputs, kept once simulated to be sent again
+	LS_HASH  hash[LOCKSTEP_HASH_SLOTS];
+	// Statistics
+	int      desyncs;		// Number of hash mismatches
+	uint32_t desync_tick;	// First tick of the last mismatching period
+	int      dropped;		// Remote words ahead of the window
+	int      stalls;		// Times no tick was simulated for LOCKSTEP_STALL_MS
+}LOCKSTEP;
+
+void LOCKSTEP_Init(LOCKSTEP *ls, int delay, int own);
+bool LOCKSTEP_CanSchedule(LOCKSTEP *ls);
+void LOCKSTEP_LocalInput(LOCKSTEP *ls, uint8_t code);
+int LOCKSTEP_Resend(LOCKSTEP *ls, uint32_t *words);
+void LOCKSTEP_RemoteWord(LOCKSTEP *ls, uint32_t word);
+bool LOCKSTEP_Ready(LOCKSTEP *ls);
+bool LOCKSTEP_Step(LOCKSTEP *ls, LVL *lvl, uint32_t *hashWord);
+uint16_t LOCKSTEP_Hash(LVL *lvl);
+
+#endif /* GAME_LOCKSTEP_H_ */
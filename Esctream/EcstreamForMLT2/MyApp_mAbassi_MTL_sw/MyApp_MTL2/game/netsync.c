@@ -0,0 +1,70 @@
+#include <Const.h>
+#include <string.h>
+#include "netsync.h"
+#include "lwip/timers.h"
+
+static void netsync_Recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port){
+	NETSYNC *ns = (NETSYNC *) arg;
+	uint32_t copy[FRAME_WORDS_MAX];
+	const uint32_t *word = (const uint32_t *) p->payload;
+	int n = p->tot_len / 4;
+
+	if (p->tot_len % 4 != 0 || n > FRAME_WORDS_MAX) {
+		ns->rx.crc_errors++;
+		pbuf_free(p);
+		return;
+	}
+	// A frame fits in a pbuf of the pool, gathered only when split or unaligned
+	if (p->len != p->tot_len || ((mem_ptr_t) word & 3) != 0) {
+		pbuf_copy_partial(p, copy, p->tot_len, 0);
+		word = copy;
+		ns->gathered++;
+	}
+	if (FRAME_Check(&ns->rx, word, n) == FRAME_RX_OK && ((word[0] >> 16) & 0xF) == FRAME_WORDS)
+		ns->received(word + 2, n - FRAME_OVERHEAD, word[1]);
+	pbuf_free(p);
+}
+
+// Sends every frame ready
+void NETSYNC_Poll(NETSYNC *ns){
+	struct pbuf *p;
+
+	while (ns->next(&ns->tx)) {
+		p = pbuf_alloc(PBUF_TRANSPORT, ns->tx.len * 4, PBUF_RAM);
+		if (p == NULL) {
+			ns->send_errors++;
+			return;
+		}
+		memcpy(p->payload, ns->tx.word, ns->tx.len * 4);
+		if (udp_sendto(ns->pcb, p, &ns->peer, ns->peer_port) == ERR_OK)
+			ns->sent++;
+		else
+			ns->send_errors++;
+		pbuf_free(p);
+	}
+}
+
+static void netsync_Timer(void *arg){
+	NETSYNC_Poll((NETSYNC *) arg);
+	sys_timeout(NETSYNC_PERIOD_MS, netsync_Timer, arg);
+}
+
+// Must be called in the lwIP thread (tcpip_callback()), false when out of UDP pcbs
+bool NETSYNC_Init(NETSYNC *ns, u16_t port, const ip_addr_t *peer, u16_t peer_port, NETSYNC_NEXT next, NETSYNC_RECEIVED received){
+	memset(ns, 0, sizeof(NETSYNC));
+	ns->peer = *peer;
+	ns->peer_port = peer_port;
+	ns->next = next;
+	ns->received = received;
+	ns->pcb = udp_new();
+	if (ns->pcb == NULL)
+		return false;
+	if (udp_bind(ns->pcb, IP_ADDR_ANY, port) != ERR_OK) {
+		udp_remove(ns->pcb);
+		ns->pcb = NULL;
+		return false;
+	}
+	udp_recv(ns->pcb, netsync_Recv, ns);
+	sys_timeout(NETSYNC_PERIOD_MS, netsync_Timer, ns);
+	return true;
+}
@@ -0,0 +1,52 @@
+/*
+ * netsync.h
+ *
+ *  Game sync between the boards straight over the HPS Ethernet, with the
+ *  raw UDP API of lwIP: one datagram per frame (frame.h), the words in the
+ *  byte order of the boards. Received frames are checked where they lie in
+ *  the pbuf and their payload handed on, the frames to send are asked for
+ *  every NETSYNC_PERIOD_MS. Everything runs in the lwIP thread (or in the
+ *  main loop without an OS, as in ../host/netsync_test.c).
+ */
+
+#ifndef GAME_NETSYNC_H_
+#define GAME_NETSYNC_H_
+#include "Const.h"
+#include "frame.h"
+#include "lwip/udp.h"
+
+#ifndef GAME_NET
+#define GAME_NET			0		// 1: boards linked by UDP instead of SPI
+#endif
+#define NETSYNC_PORT		5570
+#define NETSYNC_PERIOD_MS	1		// Polling of the frames to send
+
+// The board of player i is NETSYNC_NET (NETSYNC_HOST0 + i), see LwIP_Init()
+#define NETSYNC_NET			"192.168.1."
+#define NETSYNC_HOST0		10
+#define NETSYNC_NETMASK		"255.255.255.0"
+#define NETSYNC_GATEWAY		"192.168.1.1"
+
+// Next frame to send, false when there is nothing to send
+typedef bool (*NETSYNC_NEXT)(FRAME *f);
+// Payload of a new frame received, and the time of the sender in it (FRAME_TIME)
+typedef void (*NETSYNC_RECEIVED)(const uint32_t *word, int n, uint32_t time);
+
+typedef struct{
+	struct udp_pcb  *pcb;
+	ip_addr_t        peer;
+	u16_t            peer_port;
+	NETSYNC_NEXT     next;
+	NETSYNC_RECEIVED received;
+	FRAME_RX         rx;		// Sequences and statistics of the frames received
+	FRAME            tx;
+	// Statistics
+	uint32_t         sent;
+	uint32_t         send_errors;
+	uint32_t         gathered;	// Frames split across pbufs, copied before the check
+}NETSYNC;
+
+bool NETSYNC_Init(NETSYNC *ns, u16_t port, const ip_addr_t *peer, u16_t peer_port, NETSYNC_NEXT next, NETSYNC_RECEIVED received);
+void NETSYNC_Poll(NETSYNC *ns);
+
+#endif /* GAME_NETSYNC_H_ */
@@ -0,0 +1,278 @@
+#include <Const.h>
+#include <string.h>
+#include "terasic_includes.h"
+#include "replay.h"
+#include "lockstep.h"
+
+#include "mAbassi.h"          /* MUST include "SAL.H" and not uAbassi.h        */
+#include "SysCall.h"          /* System Call layer stuff     */
+
+static struct{
+	int      mode;
+	int      fd;
+	char     name[256];		// Host runs use absolute paths
+	uint32_t start;			// time_us() when the recording started
+	uint32_t now;			// Session time of the current GUI loop
+	uint32_t last;			// Time of the last record written or read
+	uint8_t  buf[REPLAY_BUFFER*REPLAY_RECORD_SIZE];
+	int      len;			// Bytes in buf
+	int      pos;			// Playback: next byte to decode in buf
+	REPLAY_EVENT next;		// Playback: next record (if has_next)
+	bool     has_next;
+	int      flag;			// Last own flag recorded
+	int      diverged;		// Playback: own flag while it differs from the recording, else -1
+	// Statistics
+	uint32_t records;
+	uint32_t loops;
+	uint32_t mismatches;	// Playback: own flag differs from the recording
+	uint32_t skipped;		// Playback: records GUI() did not ask for in time
+}rp = { .mode = REPLAY_OFF, .fd = -1 };
+
+static void put32(uint8_t *p, uint32_t v){
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p){
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void flush(void){
+	if (rp.len > 0 && write(rp.fd, rp.buf, rp.len) != rp.len)
+		printf("REPLAY - Error while writing %s\n", rp.name);
+	rp.len = 0;
+}
+
+// Write the buffered records and reopen the file, so the session survives a reset
+static void save(void){
+	flush();
+	close(rp.fd);
+	rp.fd = open(rp.name, O_WRONLY | O_APPEND, 0777);
+	if (rp.fd == -1) {
+		printf("REPLAY - Error while reopening %s, recording stopped\n", rp.name);
+		rp.mode = REPLAY_OFF;
+	}
+}
+
+// Record data at session time t (never before the previous record)
+static void put(uint8_t type, uint32_t t, uint32_t data){
+	if ((int32_t) (t - rp.last) < 0)
+		t = rp.last;
+	uint32_t dt = t - rp.last;
+
+	if (rp.len + 2*REPLAY_RECORD_SIZE > (int) sizeof(rp.buf))
+		flush();
+	if (dt > REPLAY_DT_MAX) {
+		put32(rp.buf + rp.len, REPLAY_GAP << 24);
+		put32(rp.buf + rp.len + 4, dt);
+		rp.len += REPLAY_RECORD_SIZE;
+		dt = 0;
+	}
+	put32(rp.buf + rp.len, ((uint32_t) type << 24) | dt);
+	put32(rp.buf + rp.len + 4, data);
+	rp.len += REPLAY_RECORD_SIZE;
+	rp.last = t;
+	rp.records++;
+}
+
+// Decode the next record of the file into rp.next
+static bool read_next(void){
+	for (;;) {
+		if (rp.pos + REPLAY_RECORD_SIZE > rp.len) {
+			// Refill the buffer
+			memmove(rp.buf, rp.buf + rp.pos, rp.len - rp.pos);
+			rp.len -= rp.pos;
+			rp.pos = 0;
+			int Nrd = read(rp.fd, rp.buf + rp.len, sizeof(rp.buf) - rp.len);
+			if (Nrd > 0)
+				rp.len += Nrd;
+			if (rp.len < REPLAY_RECORD_SIZE) {
+				rp.has_next = false;
+				return false;
+			}
+		}
+		uint32_t head = get32(rp.buf + rp.pos);
+		uint32_t data = get32(rp.buf + rp.pos + 4);
+		rp.pos += REPLAY_RECORD_SIZE;
+
+		rp.last += head & REPLAY_DT_MAX;
+		if ((head >> 24) == REPLAY_GAP) {
+			rp.last += data;
+			continue;
+		}
+		rp.next.t = rp.last;
+		rp.next.type = head >> 24;
+		rp.next.data = data;
+		rp.has_next = true;
+		rp.records++;
+		return true;
+	}
+}
+
+// True if the next record is of this type and due in the current GUI loop
+static bool due(uint8_t type){
+	return rp.mode == REPLAY_PLAY && rp.has_next && rp.next.type == type && rp.next.t <= rp.now;
+}
+
+bool REPLAY_Open(const char *name, int mode){
+	uint8_t header[REPLAY_HEADER_SIZE];
+
+	if (mode == REPLAY_OFF)
+		return true;
+
+	memset(&rp, 0, sizeof(rp));
+	strncpy(rp.name, name, sizeof(rp.name)-1);
+	rp.flag = -1;
+	rp.diverged = -1;
+
+	if (mode == REPLAY_RECORD) {
+		rp.fd = open(rp.name, O_WRONLY | O_CREAT | O_TRUNC, 0777);
+		if (rp.fd == -1) {
+			printf("REPLAY - Error while creating %s\n", rp.name);
+			return false;
+		}
+		memcpy(header, REPLAY_MAGIC, 4);
+		header[4] = REPLAY_VERSION;
+		header[5] = OWN_PLAYER;
+		header[6] = GAME_LOCKSTEP;
+		header[7] = GAME_PLAYERS;
+		if (write(rp.fd, header, sizeof(header)) != sizeof(header))
+			printf("REPLAY - Error while writing %s\n", rp.name);
+		rp.start = time_us();
+		rp.mode = REPLAY_RECORD;
+		printf("REPLAY - Recording session to %s\n", rp.name);
+		return true;
+	}
+
+	rp.fd = open(rp.name, O_RDONLY, 0777);
+	if (rp.fd == -1) {
+		printf("REPLAY - Error while opening %s\n", rp.name);
+		return false;
+	}
+	if (read(rp.fd, header, sizeof(header)) != sizeof(header) || memcmp(header, REPLAY_MAGIC, 4) != 0 || header[4] != REPLAY_VERSION) {
+		printf("REPLAY - %s is not a session file\n", rp.name);
+		close(rp.fd);
+		return false;
+	}
+	if (header[5] != OWN_PLAYER || header[6] != GAME_LOCKSTEP || header[7] != GAME_PLAYERS) {
+		printf("REPLAY - %s was recorded with OWN_PLAYER=%d GAME_LOCKSTEP=%d GAME_PLAYERS=%d\n", rp.name, header[5], header[6], header[7]);
+		close(rp.fd);
+		return false;
+	}
+	rp.mode = REPLAY_PLAY;
+	read_next();
+	printf("REPLAY - Playing session %s\n", rp.name);
+	return true;
+}
+
+// Stop recording or playing, returns the number of flag mismatches seen in playback
+int REPLAY_Close(void){
+	if (rp.mode == REPLAY_OFF)
+		return 0;
+	if (rp.mode == REPLAY_RECORD)
+		flush();
+	close(rp.fd);
+	rp.fd = -1;
+	printf("REPLAY - %s: %u loops, %u records, %u us, %u flag mismatches, %u skipped\n",
+		   rp.name, (unsigned) rp.loops, (unsigned) rp.records, (unsigned) rp.now,
+		   (unsigned) rp.mismatches, (unsigned) rp.skipped);
+	rp.mode = REPLAY_OFF;
+	return rp.mismatches;
+}
+
+int REPLAY_Mode(void){
+	return rp.mode;
+}
+
+// True once every record of the played session has been used
+bool REPLAY_Done(void){
+	return rp.mode == REPLAY_PLAY && !rp.has_next;
+}
+
+// Start of a GUI loop: timestamp the loop, or move the playback clock
+// to the next record (REPLAY_STEP_US at most)
+void REPLAY_Poll(void){
+	if (rp.mode == REPLAY_OFF)
+		return;
+	rp.loops++;
+
+	if (rp.mode == REPLAY_RECORD) {
+		rp.now = time_us() - rp.start;
+		return;
+	}
+
+	// Records of the previous loop GUI() did not take
+	while (rp.loops > 1 && rp.has_next && rp.next.t <= rp.now) {
+		rp.skipped++;
+		read_next();
+	}
+	uint32_t now = rp.now + REPLAY_STEP_US;
+	if (rp.has_next && rp.next.t < now)
+		now = rp.next.t;
+	rp.now = now;
+}
+
+// Time base of the game (us): session clock in playback, time_us() otherwise
+uint32_t REPLAY_Time(void){
+	if (rp.mode == REPLAY_PLAY)
+		return rp.now;
+	return time_us();
+}
+
+// Called by GUI() for every word of the other boards, after REPLAY_Poll(), with
+// the time_us() of the ISR that received it: the session keeps when the words
+// arrived, not when the game task took them
+void REPLAY_SpiWord(uint32_t word, uint32_t time){
+	if (rp.mode == REPLAY_RECORD)
+		put(REPLAY_SPI, time - rp.start, word);
+}
+
+// Next word of the played session, with the session time it was received at
+bool REPLAY_GetWord(uint32_t *word, uint32_t *time){
+	if (!due(REPLAY_SPI))
+		return false;
+	*word = rp.next.data;
+	*time = rp.next.t;
+	read_next();
+	return true;
+}
+
+void REPLAY_Touch(uint8_t Event, uint8_t TouchNum, uint16_t X, uint16_t Y){
+	if (rp.mode == REPLAY_RECORD)
+		put(REPLAY_TOUCH, rp.now, ((uint32_t) Event << 24) | ((TouchNum & 0xF) << 20) | ((X & 0x3FF) << 10) | (Y & 0x3FF));
+}
+
+bool REPLAY_GetTouch(uint8_t *Event, uint8_t *TouchNum, uint16_t *X, uint16_t *Y){
+	if (!due(REPLAY_TOUCH))
+		return false;
+	*Event = rp.next.data >> 24;
+	*TouchNum = (rp.next.data >> 20) & 0xF;
+	*X = (rp.next.data >> 10) & 0x3FF;
+	*Y = rp.next.data & 0x3FF;
+	read_next();
+	return true;
+}
+
+// End of a GUI loop: record a change of the own flag, or check it against the recording
+void REPLAY_Flag(int value){
+	if (rp.mode == REPLAY_RECORD && value != rp.flag) {
+		put(REPLAY_FLAG, rp.now, value);
+		rp.flag = value;
+		save();		// Game paused, started or ended: good time for a slow SD write
+	}
+	if (rp.mode != REPLAY_PLAY)
+		return;
+
+	while (due(REPLAY_FLAG)) {
+		rp.flag = rp.next.data;
+		read_next();
+	}
+	// Report each divergence once
+	if (value != rp.flag && value != rp.diverged) {
+		rp.mismatches++;
+		printf("REPLAY - Flag is %d instead of %d at %u us\n", value, rp.flag, (unsigned) rp.now);
+	}
+	rp.diverged = (value != rp.flag) ? value : -1;
+}
@@ -0,0 +1,62 @@
+/*
+ * replay.h
+ *
+ *  Session recorder: touches, words received from the other board and own
+ *  flag changes are logged to a file on the SD card. In playback mode they
+ *  are fed back through GUI() instead of the touch panel and the SPI ISR,
+ *  on the board or on a Linux host (see ../host).
+ */
+
+#ifndef GAME_REPLAY_H_
+#define GAME_REPLAY_H_
+#include "Const.h"
+
+#define REPLAY_OFF			0
+#define REPLAY_RECORD		1
+#define REPLAY_PLAY			2
+
+#ifndef GAME_REPLAY
+#define GAME_REPLAY			REPLAY_OFF	// Mode selected at start-up
+#endif
+#ifndef REPLAY_FILE
+#define REPLAY_FILE			"session.rpl"
+#endif
+#define REPLAY_BUFFER		512			// Records kept in RAM between two writes
+#define REPLAY_STEP_US		1000		// Playback clock step while no record is due
+
+// File layout (little endian):
+// header:	"ESRP", version, OWN_PLAYER, GAME_LOCKSTEP, GAME_PLAYERS
+// record:	bits [24:31] type, bits [0:23] time since the previous record (us)
+//			32 bit data
+#define REPLAY_MAGIC		"ESRP"
+#define REPLAY_VERSION		3			// 2: player id in the SPI words, 3: SPI words at their ISR time
+#define REPLAY_HEADER_SIZE	8
+#define REPLAY_RECORD_SIZE	8
+#define REPLAY_DT_MAX		0x00FFFFFF
+
+typedef enum{
+	REPLAY_GAP = 0,		// data = time to add (us), for gaps over REPLAY_DT_MAX
+	REPLAY_TOUCH,		// data = Event<<24 | TouchNum<<20 | X<<10 | Y
+	REPLAY_SPI,			// data = word received from another board
+	REPLAY_FLAG			// data = own flag at the end of a GUI loop
+}REPLAY_TYPE;
+
+typedef struct{
+	uint32_t t;			// Session time (us)
+	uint8_t  type;
+	uint32_t data;
+}REPLAY_EVENT;
+
+bool REPLAY_Open(const char *name, int mode);
+int REPLAY_Close(void);
+int REPLAY_Mode(void);
+bool REPLAY_Done(void);
+void REPLAY_Poll(void);
+uint32_t REPLAY_Time(void);
+void REPLAY_SpiWord(uint32_t word, uint32_t time);
+bool REPLAY_GetWord(uint32_t *word, uint32_t *time);
+void REPLAY_Touch(uint8_t Event, uint8_t TouchNum, uint16_t X, uint16_t Y);
+bool REPLAY_GetTouch(uint8_t *Event, uint8_t *TouchNum, uint16_t *X, uint16_t *Y);
+void REPLAY_Flag(int value);
+
+#endif /* GAME_REPLAY_H_ */
@@ -0,0 +1,38 @@
+#include <Const.h>
+#include <string.h>
+#include "spsc.h"
+
+// The index of the other side is read with acquire and the own one written
+// with release, so a slot is never seen before its data (both cores of the A9).
+
+void SPSC_Init(SPSC_RING *r){
+	memset(r, 0, sizeof(SPSC_RING));
+}
+
+bool SPSC_Push(SPSC_RING *r, uint32_t word, uint32_t time){
+	uint32_t head = r->head;
+	if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= SPSC_SIZE) {
+		r->dropped++;
+		return false;
+	}
+	r->word[head & (SPSC_SIZE-1)] = word;
+	r->time[head & (SPSC_SIZE-1)] = time;
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// time may be NULL
+bool SPSC_Pop(SPSC_RING *r, uint32_t *word, uint32_t *time){
+	uint32_t tail = r->tail;
+	if (tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+		return false;
+	*word = r->word[tail & (SPSC_SIZE-1)];
+	if (time != NULL)
+		*time = r->time[tail & (SPSC_SIZE-1)];
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool SPSC_IsEmpty(SPSC_RING *r){
+	return r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+}
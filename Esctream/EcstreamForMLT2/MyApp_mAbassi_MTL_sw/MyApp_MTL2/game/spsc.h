@@ -0,0 +1,28 @@
+/*
+ * spsc.h
+ *
+ *  Lock-free single producer / single consumer ring of timestamped words,
+ *  between the SPI ISR and the game task. Each side only writes its own
+ *  index, so neither of them ever waits for the other.
+ */
+
+#ifndef GAME_SPSC_H_
+#define GAME_SPSC_H_
+#include "Const.h"
+
+#define SPSC_SIZE		64		// Words in a ring (power of 2)
+
+typedef struct{
+	uint32_t head;				// Next slot to write, producer only
+	uint32_t tail;				// Next slot to read, consumer only
+	uint32_t dropped;			// Words pushed while full, producer only
+	uint32_t word[SPSC_SIZE];
+	uint32_t time[SPSC_SIZE];	// Reception time (us)
+}SPSC_RING;
+
+void SPSC_Init(SPSC_RING *r);
+bool SPSC_Push(SPSC_RING *r, uint32_t word, uint32_t time);
+bool SPSC_Pop(SPSC_RING *r, uint32_t *word, uint32_t *time);
+bool SPSC_IsEmpty(SPSC_RING *r);
+
+#endif /* GAME_SPSC_H_ */
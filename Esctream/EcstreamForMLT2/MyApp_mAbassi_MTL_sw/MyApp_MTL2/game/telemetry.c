@@ -0,0 +1,45 @@
+#include <Const.h>
+#include <string.h>
+#include "telemetry.h"
+
+// A histogram has one writer, so a plain read-modify-write is enough for it;
+// the relaxed atomics only make each store whole for the readers (the 64 bit
+// sum is stored with ldrexd / strexd on the A9). Counters may have several.
+
+GAME_STATS gameStats;
+
+void TELEM_Add(TELEM_HIST *h, uint32_t us){
+	int i;
+
+	for (i=0; i<TELEM_BINS-1 && us >= ((uint32_t) TELEM_BIN0_US << i); i++)
+		;
+	__atomic_store_n(&h->bin[i], h->bin[i] + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&h->sum, h->sum + us, __ATOMIC_RELAXED);
+	if (us > h->max)
+		__atomic_store_n(&h->max, us, __ATOMIC_RELAXED);
+	__atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELAXED);
+}
+
+void TELEM_Count(uint32_t *counter, int32_t n){
+	__atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+uint32_t TELEM_Read(const uint32_t *counter){
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+// {"n":..,"avg_us":..,"max_us":..,"bins":[..]}, returns the length written
+// (clipped to size-1)
+int TELEM_Json(char *buf, int size, const TELEM_HIST *h){
+	uint32_t count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+	uint64_t sum = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+	int len, i;
+
+	len = snprintf(buf, size, "{\"n\":%u,\"avg_us\":%u,\"max_us\":%u,\"bins\":[", (unsigned) count,
+	               (unsigned) (count != 0 ? sum / count : 0), (unsigned) __atomic_load_n(&h->max, __ATOMIC_RELAXED));
+	for (i=0; i<TELEM_BINS && len < size; i++)
+		len += snprintf(buf + len, size - len, i == 0 ? "%u" : ",%u", (unsigned) __atomic_load_n(&h->bin[i], __ATOMIC_RELAXED));
+	if (len < size)
+		len += snprintf(buf + len, size - len, "]}");
+	return len < size ? len : size - 1;
+}
@@ -0,0 +1,49 @@
+/*
+ * telemetry.h
+ *
+ *  Game telemetry: latency histograms and counters updated on the hot paths
+ *  with relaxed atomics only (no lock, no print), read at any time from
+ *  another task or core (the /telemetry.json page of ../src/web.c). Each
+ *  histogram has a single writer, a reader may see a sample counted in one
+ *  field and not yet in the next one.
+ *
+ *  Bin i of a histogram counts the values below TELEM_BIN0_US << i, the last
+ *  bin the longer ones.
+ */
+
+#ifndef GAME_TELEMETRY_H_
+#define GAME_TELEMETRY_H_
+#include "Const.h"
+
+#define TELEM_BINS			12		// 256 us to 262 ms, then the rest
+#define TELEM_BIN0_US		256
+
+typedef struct{
+	uint32_t bin[TELEM_BINS];
+	uint32_t count;
+	uint32_t max;			// us
+	uint64_t sum;			// us
+}TELEM_HIST;
+
+typedef struct{
+	TELEM_HIST frame;		// Between two flips of the frame buffers
+	TELEM_HIST draw;		// GUI_DeskDraw() up to its flip
+	TELEM_HIST touch;		// Touch read by Task_Touch to the flip showing it
+	TELEM_HIST link;		// One way, frame built to received (shared clock, GAME_SYNC)
+	uint32_t   flips;
+	uint32_t   last_flip;	// time_us() of the last flip
+	uint32_t   link_tx;		// Frames sent to the next board (SPI or UDP)
+	uint32_t   link_rx;		// Frames received from the previous board
+	uint32_t   link_words;	// Payload words received
+	uint32_t   images;		// Images loaded by initimage() and not suppressed
+	uint32_t   image_bytes;
+}GAME_STATS;
+
+extern GAME_STATS gameStats;
+
+void TELEM_Add(TELEM_HIST *h, uint32_t us);
+void TELEM_Count(uint32_t *counter, int32_t n);
+uint32_t TELEM_Read(const uint32_t *counter);
+int TELEM_Json(char *buf, int size, const TELEM_HIST *h);
+
+#endif /* GAME_TELEMETRY_H_ */
@@ -0,0 +1,235 @@
+#include <Const.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tilecodec.h"
+
+#define TILE_PIX(w)			((w) & 0xFFFFFF)
+#define TILE_OP(code, n)	((uint8_t) ((code) << 6 | ((n) - 1)))
+
+static void tile_Put16(uint8_t *p, uint32_t v){
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+}
+
+static uint32_t tile_Get16(const uint8_t *p){
+	return p[0] | (uint32_t) p[1] << 8;
+}
+
+static int tile_PutPixel(uint8_t *p, uint32_t w){
+	p[0] = (uint8_t) w;
+	p[1] = (uint8_t) (w >> 8);
+	p[2] = (uint8_t) (w >> 16);
+	return 3;
+}
+
+// FNV-1a on the words: 64 bits, so a changed tile is never taken for the old one
+static uint64_t tile_Hash(const uint32_t *px, int n){
+	uint64_t h = 0xCBF29CE484222325ull;
+	int i;
+
+	for (i=0; i<n; i++)
+		h = (h ^ TILE_PIX(px[i])) * 0x100000001B3ull;
+	return h;
+}
+
+// Ops of the n pixels of a tile w pixels wide, prev is NULL on a key frame.
+// Greedy: the op covering the most pixels, KEEP and UP (1 byte) before RUN
+// (4 bytes), literals only for the pixels none of them covers.
+static int tile_Encode(uint8_t *out, const uint32_t *cur, const uint32_t *prev, int w, int n){
+	int p = 0, len = 0;
+
+	while (p < n){
+		int max = n - p < 64 ? n - p : 64;
+		int keep = 0, up = 0, run = 1, lit;
+
+		if (prev != NULL)
+			while (keep < max && TILE_PIX(cur[p+keep]) == TILE_PIX(prev[p+keep]))
+				keep++;
+		if (p >= w)
+			while (up < max && TILE_PIX(cur[p+up]) == TILE_PIX(cur[p+up-w]))
+				up++;
+		while (run < max && TILE_PIX(cur[p+run]) == TILE_PIX(cur[p]))
+			run++;
+
+		if (keep > 0 && keep >= up && keep >= run){
+			out[len++] = TILE_OP(TILE_OP_KEEP, keep);
+			p += keep;
+		}
+		else if (up > 0 && up >= run){
+			out[len++] = TILE_OP(TILE_OP_UP, up);
+			p += up;
+		}
+		else if (run >= 2){
+			out[len++] = TILE_OP(TILE_OP_RUN, run);
+			len += tile_PutPixel(out + len, cur[p]);
+			p += run;
+		}
+		else{
+			for (lit=1; lit<max; lit++){
+				int i = p + lit;
+				if ((prev != NULL && TILE_PIX(cur[i]) == TILE_PIX(prev[i]))
+				 || (i >= w && TILE_PIX(cur[i]) == TILE_PIX(cur[i-w]))
+				 || (i+1 < n && TILE_PIX(cur[i+1]) == TILE_PIX(cur[i])))
+					break;
+			}
+			out[len++] = TILE_OP(TILE_OP_LIT, lit);
+			while (lit-- > 0)
+				len += tile_PutPixel(out + len, cur[p++]);
+		}
+	}
+	return len;
+}
+
+bool TILE_EncInit(TILE_ENC *e, int width, int height){
+	memset(e, 0, sizeof(*e));
+	e->width = width;
+	e->height = height;
+	e->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+	e->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+	e->prev = (uint32_t *) malloc(e->tiles_x * e->tiles_y * TILE_SIZE*TILE_SIZE * sizeof(uint32_t));
+	e->hash = (uint64_t *) malloc(e->tiles_x * e->tiles_y * sizeof(uint64_t));
+	if (e->prev == NULL || e->hash == NULL || e->tiles_x * e->tiles_y >= TILE_END){
+		TILE_EncFree(e);
+		return false;
+	}
+	e->key = true;
+	return true;
+}
+
+void TILE_EncFree(TILE_ENC *e){
+	free(e->prev);
+	free(e->hash);
+	e->prev = NULL;
+	e->hash = NULL;
+}
+
+// A new viewer knows nothing: the next frame sends every tile
+void TILE_EncKey(TILE_ENC *e){
+	e->key = true;
+}
+
+int TILE_Header(uint8_t *buf, int width, int height){
+	memcpy(buf, "ESFB", 4);
+	buf[4] = TILE_VERSION;
+	buf[5] = TILE_SIZE;
+	tile_Put16(buf + 6, width);
+	tile_Put16(buf + 8, height);
+	tile_Put16(buf + 10, 0);
+	return TILE_HDR_SIZE;
+}
+
+// Encodes the tiles of fb (width*height pixels) that changed, then the end
+// record. Returns the number of tiles sent, -1 when a write failed.
+int TILE_EncFrame(TILE_ENC *e, const uint32_t *fb, uint32_t time, TILE_WRITE write, void *ctx){
+	int tx, ty, x, y, w, h, n, sent = 0;
+
+	for (ty=0; ty<e->tiles_y; ty++){
+		for (tx=0; tx<e->tiles_x; tx++){
+			int index = ty * e->tiles_x + tx;
+			uint32_t *prev = e->prev + index * TILE_SIZE*TILE_SIZE;
+			uint64_t hash;
+
+			x = tx * TILE_SIZE;
+			y = ty * TILE_SIZE;
+			w = e->width - x < TILE_SIZE ? e->width - x : TILE_SIZE;
+			h = e->height - y < TILE_SIZE ? e->height - y : TILE_SIZE;
+			// Copied first: the frame may be drawn again while it is encoded,
+			// what is sent and hashed must be the same pixels
+			for (n=0; n<h; n++)
+				memcpy(e->cur + n*w, fb + (y + n) * e->width + x, w * sizeof(uint32_t));
+			hash = tile_Hash(e->cur, w*h);
+			if (!e->key && hash == e->hash[index])
+				continue;
+
+			if (e->len + TILE_MAX_BYTES > TILE_OUT_SIZE){
+				if (!write(ctx, e->out, e->len))
+					return -1;
+				e->len = 0;
+			}
+			n = tile_Encode(e->out + e->len + TILE_REC_SIZE, e->cur, e->key ? NULL : prev, w, w*h);
+			tile_Put16(e->out + e->len, index);
+			tile_Put16(e->out + e->len + 2, n);
+			e->len += TILE_REC_SIZE + n;
+			e->bytes += TILE_REC_SIZE + n;
+			memcpy(prev, e->cur, w*h * sizeof(uint32_t));
+			e->hash[index] = hash;
+			sent++;
+		}
+	}
+
+	tile_Put16(e->out + e->len, TILE_END);
+	tile_Put16(e->out + e->len + 2, 4);
+	tile_Put16(e->out + e->len + 4, time);
+	tile_Put16(e->out + e->len + 6, time >> 16);
+	e->len += TILE_REC_SIZE + 4;
+	e->bytes += TILE_REC_SIZE + 4;
+	if (!write(ctx, e->out, e->len))
+		return -1;
+	e->len = 0;
+	e->key = false;
+	e->frames++;
+	e->tiles += sent;
+	return sent;
+}
+
+// false if hdr is not the header of a stream of this version
+bool TILE_DecInit(TILE_DEC *d, const uint8_t *hdr){
+	memset(d, 0, sizeof(*d));
+	if (memcmp(hdr, "ESFB", 4) != 0 || hdr[4] != TILE_VERSION || hdr[5] != TILE_SIZE)
+		return false;
+	d->width = tile_Get16(hdr + 6);
+	d->height = tile_Get16(hdr + 8);
+	d->tiles_x = (d->width + TILE_SIZE - 1) / TILE_SIZE;
+	d->tiles_y = (d->height + TILE_SIZE - 1) / TILE_SIZE;
+	d->fb = (uint32_t *) calloc(d->width * d->height, sizeof(uint32_t));
+	return d->fb != NULL;
+}
+
+void TILE_DecFree(TILE_DEC *d){
+	free(d->fb);
+	d->fb = NULL;
+}
+
+// Applies the ops of a tile to d->fb, false if they do not fit the tile
+bool TILE_DecTile(TILE_DEC *d, int index, const uint8_t *data, int len){
+	int x, y, w, h, p = 0, i = 0;
+
+	if (index >= d->tiles_x * d->tiles_y)
+		return false;
+	x = (index % d->tiles_x) * TILE_SIZE;
+	y = (index / d->tiles_x) * TILE_SIZE;
+	w = d->width - x < TILE_SIZE ? d->width - x : TILE_SIZE;
+	h = d->height - y < TILE_SIZE ? d->height - y : TILE_SIZE;
+
+	while (i < len){
+		int code = data[i] >> 6;
+		int n = (data[i] & 63) + 1;
+		uint32_t pixel = 0;
+
+		i++;
+		if (p + n > w*h || (code == TILE_OP_UP && p < w))
+			return false;
+		if (code == TILE_OP_RUN){
+			if (i + 3 > len)
+				return false;
+			pixel = data[i] | (uint32_t) data[i+1] << 8 | (uint32_t) data[i+2] << 16;
+			i += 3;
+		}
+		else if (code == TILE_OP_LIT && i + 3*n > len)
+			return false;
+		while (n-- > 0){
+			uint32_t *dst = d->fb + (y + p / w) * d->width + x + p % w;
+
+			if (code == TILE_OP_UP)
+				*dst = dst[-d->width];
+			else if (code == TILE_OP_RUN)
+				*dst = pixel;
+			else if (code == TILE_OP_LIT){
+				*dst = data[i] | (uint32_t) data[i+1] << 8 | (uint32_t) data[i+2] << 16;
+				i += 3;
+			}
+			p++;
+		}
+	}
+	return p == w*h;
+}
@@ -0,0 +1,85 @@
+/*
+ * tilecodec.h
+ *
+ *  Lossless codec of the screen stream, shared by the board (../src/stream.c),
+ *  the Linux host build (replay -s) and the viewer of the PC port. The frame is
+ *  cut in TILE_SIZE x TILE_SIZE tiles and only the tiles whose hash changed
+ *  since the previous frame are sent: the bandwidth follows what moves on the
+ *  screen, not its resolution.
+ *
+ *  Stream, little endian:
+ *    header	"ESFB", TILE_VERSION, TILE_SIZE, width (16 bits), height (16 bits), 0 (16 bits)
+ *    tile		index (16 bits, raster order), length (16 bits), length bytes of ops
+ *    end		TILE_END (16 bits), 4 (16 bits), time_us() of the flip (32 bits)
+ *
+ *  An op is a byte (code << 6 | count-1) for 1 to 64 pixels, in raster order
+ *  inside the tile, followed by the pixels of RUN (1) and LIT (count). A pixel
+ *  is 3 bytes (blue, green, red): the frame reader ignores the top byte of
+ *  the 32 bit words, it is not sent and the viewer gets 0x00RRGGBB.
+ */
+
+#ifndef GAME_TILECODEC_H_
+#define GAME_TILECODEC_H_
+#include "Const.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TILE_SIZE		32
+#define TILE_VERSION	1
+#define TILE_HDR_SIZE	12
+#define TILE_REC_SIZE	4				// Index and length before the ops of a tile
+#define TILE_END		0xFFFF			// Index of the record ending a frame
+#define TILE_OUT_SIZE	16384			// Records buffered before a write
+
+#define TILE_OP_KEEP	0				// Pixels as in the previous frame
+#define TILE_OP_UP		1				// Pixels as the one above, in the tile
+#define TILE_OP_RUN		2				// The pixel that follows, repeated
+#define TILE_OP_LIT		3				// Pixels that follow
+
+// Largest record of a tile: literals only
+#define TILE_MAX_BYTES	(TILE_REC_SIZE + (TILE_SIZE*TILE_SIZE/64)*(1 + 64*3))
+
+// Writes the encoded bytes, false when the viewer is gone
+typedef bool (*TILE_WRITE)(void *ctx, const uint8_t *data, int len);
+
+typedef struct{
+	int       width;
+	int       height;
+	int       tiles_x;
+	int       tiles_y;
+	uint32_t *prev;		// Tiles as last sent, TILE_SIZE*TILE_SIZE pixels each
+	uint64_t *hash;		// Hash of each tile of prev
+	bool      key;		// Next frame sends every tile
+	uint32_t  cur[TILE_SIZE*TILE_SIZE];	// Tile being encoded
+	uint8_t   out[TILE_OUT_SIZE];
+	int       len;		// Bytes in out[]
+	// Statistics
+	uint32_t  frames;
+	uint32_t  tiles;	// Tiles sent
+	uint64_t  bytes;	// Bytes sent, headers included
+}TILE_ENC;
+
+typedef struct{
+	int       width;
+	int       height;
+	int       tiles_x;
+	int       tiles_y;
+	uint32_t *fb;		// Frame rebuilt, width*height pixels
+}TILE_DEC;
+
+bool TILE_EncInit(TILE_ENC *e, int width, int height);
+void TILE_EncFree(TILE_ENC *e);
+void TILE_EncKey(TILE_ENC *e);
+int TILE_Header(uint8_t *buf, int width, int height);
+int TILE_EncFrame(TILE_ENC *e, const uint32_t *fb, uint32_t time, TILE_WRITE write, void *ctx);
+bool TILE_DecInit(TILE_DEC *d, const uint8_t *hdr);
+void TILE_DecFree(TILE_DEC *d);
+bool TILE_DecTile(TILE_DEC *d, int index, const uint8_t *data, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GAME_TILECODEC_H_ */
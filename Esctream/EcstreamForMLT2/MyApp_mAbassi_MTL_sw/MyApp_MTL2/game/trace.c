@@ -0,0 +1,94 @@
+#include <Const.h>
+#include <string.h>
+#include "terasic_includes.h"
+#include "trace.h"
+
+#include "mAbassi.h"          /* MUST include "SAL.H" and not uAbassi.h        */
+#include "SysCall.h"          /* System Call layer stuff     */
+
+// An ISR can preempt a task of its core in the middle of TRACE_Log(), so the
+// writers of a ring reserve their slot with a compare and swap on head and
+// publish it with seq. The reader prints a slot only once seq says it is complete.
+
+static TRACE_RING ring[OX_N_CORE];
+#ifdef TRACE_FILE
+static int fd = -1;
+#endif
+
+void TRACE_Log(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3){
+	TRACE_RING *r = &ring[COREgetID()];
+	uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+	TRACE_RECORD *rec;
+
+	do {
+		if (pos - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= TRACE_RECORDS) {
+			__atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while (!__atomic_compare_exchange_n(&r->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	rec = &r->rec[pos & (TRACE_RECORDS-1)];
+	rec->time = time_us();
+	rec->fmt = fmt;
+	rec->arg[0] = a0;
+	rec->arg[1] = a1;
+	rec->arg[2] = a2;
+	rec->arg[3] = a3;
+	__atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void output(const char *line, int len){
+#ifdef TRACE_FILE
+	if (fd == -1)
+		fd = open(TRACE_FILE, O_WRONLY | O_CREAT | O_APPEND, 0777);
+	if (fd != -1 && write(fd, line, len) == len)
+		return;
+#endif
+	fwrite(line, 1, len, stdout);
+}
+
+// Oldest complete record of a ring, or NULL
+static TRACE_RECORD* ready(TRACE_RING *r){
+	TRACE_RECORD *rec = &r->rec[r->tail & (TRACE_RECORDS-1)];
+	if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != r->tail + 1)
+		return NULL;
+	return rec;
+}
+
+// Print the records of every core in time order, returns the number printed.
+// Only one task may call it.
+int TRACE_Flush(void){
+	char line[160];
+	int len, core, n = 0;
+
+	for (;;) {
+		TRACE_RECORD *rec = NULL;
+		int from = 0;
+		for (core=0; core<OX_N_CORE; core++) {
+			TRACE_RECORD *p = ready(&ring[core]);
+			if (p != NULL && (rec == NULL || (int32_t) (p->time - rec->time) < 0)) {
+				rec = p;
+				from = core;
+			}
+		}
+		if (rec == NULL)
+			break;
+
+		len = snprintf(line, sizeof(line), "%10u c%d ", (unsigned) rec->time, from);
+		len += snprintf(line + len, sizeof(line) - len, rec->fmt, rec->arg[0], rec->arg[1], rec->arg[2], rec->arg[3]);
+		if (len >= (int) sizeof(line))
+			len = sizeof(line) - 1;
+		__atomic_store_n(&ring[from].tail, ring[from].tail + 1, __ATOMIC_RELEASE);
+		output(line, len);
+		n++;
+	}
+
+	for (core=0; core<OX_N_CORE; core++) {
+		uint32_t dropped = __atomic_exchange_n(&ring[core].dropped, 0, __ATOMIC_RELAXED);
+		if (dropped > 0) {
+			len = snprintf(line, sizeof(line), "TRACE - %u records lost on core %d\n", (unsigned) dropped, core);
+			output(line, len);
+		}
+	}
+	return n;
+}
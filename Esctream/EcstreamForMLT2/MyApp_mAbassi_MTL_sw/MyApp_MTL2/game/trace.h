@@ -0,0 +1,67 @@
+/*
+ * trace.h
+ *
+ *  Binary trace: ISRs and tasks store a format string and up to 4 integer
+ *  arguments in a lock-free ring of their core, a low priority task formats
+ *  them later on the UART (or in TRACE_FILE on the SD card). Messages above
+ *  TRACE_LEVEL are not compiled in.
+ */
+
+#ifndef GAME_TRACE_H_
+#define GAME_TRACE_H_
+#include "Const.h"
+
+#define TRACE_LVL_ERR		1
+#define TRACE_LVL_WARN		2
+#define TRACE_LVL_INFO		3
+#define TRACE_LVL_DEBUG		4
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL			TRACE_LVL_INFO
+#endif
+#define TRACE_RECORDS		256			// Records in the ring of a core (power of 2)
+#define TRACE_PERIOD_MS		20			// Drain period of Task_Trace
+
+typedef struct{
+	uint32_t    seq;		// Position + 1 once the record is written
+	uint32_t    time;		// time_us() when logged
+	const char *fmt;		// printf() format, also the message id
+	uint32_t    arg[4];
+}TRACE_RECORD;
+
+typedef struct{
+	uint32_t head;			// Next position to reserve, all writers of the core
+	uint32_t tail;			// Next position to print, Task_Trace only
+	uint32_t dropped;		// Records lost while full
+	TRACE_RECORD rec[TRACE_RECORDS];
+}TRACE_RING;
+
+void TRACE_Log(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+int TRACE_Flush(void);
+
+// Pads the arguments to 4, so TRACE_xxx("...") and TRACE_xxx("...", a, b) both work
+#define TRACE_ARGS(z, a, b, c, d, ...)	(uint32_t) (a), (uint32_t) (b), (uint32_t) (c), (uint32_t) (d)
+#define TRACE(fmt, ...)		TRACE_Log(fmt, TRACE_ARGS(0, ##__VA_ARGS__, 0, 0, 0, 0))
+
+#if TRACE_LEVEL >= TRACE_LVL_ERR
+#define TRACE_ERR(...)		TRACE(__VA_ARGS__)
+#else
+#define TRACE_ERR(...)		do {} while (0)
+#endif
+#if TRACE_LEVEL >= TRACE_LVL_WARN
+#define TRACE_WARN(...)		TRACE(__VA_ARGS__)
+#else
+#define TRACE_WARN(...)		do {} while (0)
+#endif
+#if TRACE_LEVEL >= TRACE_LVL_INFO
+#define TRACE_INFO(...)		TRACE(__VA_ARGS__)
+#else
+#define TRACE_INFO(...)		do {} while (0)
+#endif
+#if TRACE_LEVEL >= TRACE_LVL_DEBUG
+#define TRACE_DEBUG(...)	TRACE(__VA_ARGS__)
+#else
+#define TRACE_DEBUG(...)	do {} while (0)
+#endif
+
+#endif /* GAME_TRACE_H_ */
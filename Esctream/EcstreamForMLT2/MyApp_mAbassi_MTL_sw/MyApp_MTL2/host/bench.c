@@ -0,0 +1,96 @@
+/*
+ * bench.c
+ *
+ *  Game core benchmark: players of each level walk towards random targets,
+ *  one step at a time as on a touch, with the collision check and the
+ *  victory test after every step. A first pass without the checks gives
+ *  their cost. The sequence is seeded, so runs are comparable.
+ *
+ *  Usage: bench [moves_per_level]
+ *  (build with make PLAYERS=n to see how the cost grows with the players)
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "Const.h"
+#include "core.h"
+#include "level.h"
+
+#define BENCH_LEVELS		6
+#define BENCH_MOVES			2000000
+#define BENCH_TARGET_MOVES	64		// Steps towards the same target
+
+typedef struct{
+	uint32_t seed;
+	int      x;
+	int      y;
+}WALK;
+
+static double now_s(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rnd(WALK *w){
+	w->seed = w->seed * 1664525u + 1013904223u;
+	return w->seed >> 8;
+}
+
+static void walk(LVL *lvl, WALK *w, long i){
+	PLAYER *player = lvl->players + (i % lvl->nbr_players);
+	if ((i % BENCH_TARGET_MOVES) == 0) {
+		w->x = rnd(w) % SCREEN_WIDTH;
+		w->y = rnd(w) % SCREEN_HEIGHT;
+	}
+	apply_move(player, move_code(player, w->x, w->y));
+}
+
+// Returns the time of n moves, with the checks if bCheck
+static double run(LVL *lvl, int n, long moves, bool bCheck, long *ends){
+	WALK w = { 12345u + n, 0, 0 };
+	double start;
+
+	level(n, lvl);
+	start = now_s();
+	for (long i=0; i<moves; i++) {
+		walk(lvl, &w, i);
+		if (bCheck && (pos_correlator(lvl) | success(lvl))) {
+			reset_lvl(lvl);
+			(*ends)++;
+		}
+	}
+	return now_s() - start;
+}
+
+int main(int argc, char *argv[]){
+	long moves = (argc > 1) ? atol(argv[1]) : BENCH_MOVES;
+	LVL lvl;
+	double total_moves = 0, total_check = 0;
+	long ends;
+
+	if (moves <= 0) {
+		fprintf(stderr, "Usage: %s [moves_per_level]\n", argv[0]);
+		return 2;
+	}
+	lvl.players = (PLAYER *)malloc(GAME_PLAYERS*sizeof(PLAYER));	// Same sizes as GUI()
+	lvl.lines = (LINE *)malloc(10*sizeof(LINE));
+
+	printf("level lines players   Mmoves/s   check ns   ns/pair   ends\n");
+	for (int n=1; n<=BENCH_LEVELS; n++) {
+		ends = 0;
+		double t_move = run(&lvl, n, moves, false, &ends);
+		double t_all = run(&lvl, n, moves, true, &ends);
+		double check_ns = (t_all - t_move) * 1e9 / moves;
+		printf("%5d %5d %7d %10.2f %10.1f %9.2f %6ld\n", n, lvl.nbr_lines, lvl.nbr_players,
+			   moves / t_all * 1e-6, check_ns, check_ns / (lvl.nbr_lines * lvl.nbr_players), ends);
+		total_moves += t_move;
+		total_check += t_all - t_move;
+	}
+	printf("all   %.2f Mmoves/s, %.1f ns per check\n",
+		   BENCH_LEVELS * moves / (total_moves + total_check) * 1e-6, total_check * 1e9 / (BENCH_LEVELS * moves));
+
+	free(lvl.players);
+	free(lvl.lines);
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * host_os.c
+ *
+ *  Stand-ins for the RTOS, the frame reader and the touch panel, so GUI()
+ *  runs unchanged on a Linux host. Task_MTL2_image is emulated in SEMwait():
+ *  the level posted in the image mailbox is drawn there.
+ */
+
+#include <time.h>
+#include "terasic_includes.h"
+#include "gui.h"
+#include "replay.h"
+#include "trace.h"
+#include "host_os.h"
+
+HOST_STATS host_stats;
+void (*host_flip)(const uint32_t *frame, int width, int height);
+
+static MBX_t ImMailbox = { "ImMailbox", 0, false };
+
+MTX_t *MTXopen(const char *name){
+	static MTX_t mtx;
+	mtx.name = name;
+	return &mtx;
+}
+
+int MTXlock(MTX_t *mtx, int timeout){
+	return 0;
+}
+
+int MTXunlock(MTX_t *mtx){
+	return 0;
+}
+
+SEM_t *SEMopen(const char *name){
+	static SEM_t sem;
+	sem.name = name;
+	return &sem;
+}
+
+// Draw what GUI_Draw() posted, as Task_MTL2_image does on the board
+int SEMwait(SEM_t *sem, int timeout){
+	if (ImMailbox.full) {
+		ImMailbox.full = false;
+		GUI_DeskDraw((LVL *) ImMailbox.msg);
+	}
+	return 0;
+}
+
+int SEMpost(SEM_t *sem){
+	return 0;
+}
+
+void SEMreset(SEM_t *sem){
+}
+
+MBX_t *MBXopen(const char *name, int size){
+	return &ImMailbox;
+}
+
+int MBXput(MBX_t *mbx, intptr_t msg, int timeout){
+	mbx->msg = msg;
+	mbx->full = true;
+	return 0;
+}
+
+int MBXget(MBX_t *mbx, intptr_t *msg, int timeout){
+	if (!mbx->full)
+		return -1;
+	*msg = mbx->msg;
+	mbx->full = false;
+	return 0;
+}
+
+// No time passes while sleeping: playback runs as fast as possible.
+// The traces are printed here, as Task_Trace does on the board.
+void TSKsleep(int ticks){
+	host_stats.sleeps++;
+	TRACE_Flush();
+}
+
+// 1 kHz system tick, on the session clock so lockstep pacing is repeatable
+int host_ticks(void){
+	return (int) (REPLAY_Time() / 1000);
+}
+
+uint32_t time_us(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) (ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+void delay_us(uint32_t us){
+}
+
+// Frame reader: both frames in host memory, the displayed one is only read
+// by host_flip
+VIP_FRAME_READER* VIPFR_Init(uint32_t *VipBase, void* Frame0_Base, void* Frame1_Base, uint32_t Frame_Width, uint32_t Frame_Height){
+	VIP_FRAME_READER *p = calloc(1, sizeof(VIP_FRAME_READER));
+	p->bytes_per_pixel = 4;
+	p->color_depth = 32;
+	p->width = Frame_Width;
+	p->height = Frame_Height;
+	p->Frame0_Base = calloc(Frame_Width*Frame_Height, p->bytes_per_pixel);
+	p->Frame1_Base = calloc(Frame_Width*Frame_Height, p->bytes_per_pixel);
+	return p;
+}
+
+void VIPFR_Go(VIP_FRAME_READER* p, bool bGo){
+}
+
+void* VIPFR_GetDrawFrame(VIP_FRAME_READER* p){
+	if (p->DisplayFrame == 0)
+		return p->Frame1_Base;
+	return p->Frame0_Base;
+}
+
+void* VIPFR_GetDisplayFrame(VIP_FRAME_READER* p){
+	if (p->DisplayFrame == 0)
+		return p->Frame0_Base;
+	return p->Frame1_Base;
+}
+
+void VIPFR_ActiveDrawFrame(VIP_FRAME_READER* p){
+	p->DisplayFrame = (p->DisplayFrame+1)%2;
+	host_stats.frames++;
+	if (host_flip != NULL)
+		host_flip((const uint32_t *) VIPFR_GetDisplayFrame(p), p->width, p->height);
+}
+
+// Touches only come from the played session
+int MTC2_GetEvents(MTC2_INFO *p, MTC2_EVENT *pEvent, int nMax){
+	return 0;
+}
+
+void MTC2_Latency(MTC2_INFO *p, alt_u32 us){
+}
+
+void MTC2_ClearEvent(MTC2_INFO *p){
+}
@@ -0,0 +1,21 @@
+/*
+ * host_os.h
+ *
+ *  Counters of the host stand-ins (host_os.c).
+ */
+
+#ifndef HOST_OS_H_
+#define HOST_OS_H_
+#include <stdint.h>
+
+typedef struct{
+	uint32_t frames;		// Frames drawn (VIPFR_ActiveDrawFrame)
+	uint32_t sleeps;		// TSKsleep() calls skipped
+}HOST_STATS;
+
+extern HOST_STATS host_stats;
+
+// Called after each flip with the frame displayed (replay -s)
+extern void (*host_flip)(const uint32_t *frame, int width, int height);
+
+#endif /* HOST_OS_H_ */
@@ -0,0 +1,183 @@
+/*
+ * host_rtos.c
+ *
+ *  POSIX threads stand-ins for the mAbassi services used by the lwIP port
+ *  (see rtos/mAbassi.h), so sys_arch.c of the board runs unchanged in the
+ *  host lwIP benchmark.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include "mAbassi.h"
+
+struct _HostTsk{
+	pthread_t  thread;
+	void     (*fct)(void);
+	void      *arg;
+};
+
+MTX_t *G_OSmutex;
+
+static pthread_mutex_t IntLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int    IntOff;			// This task holds IntLock
+static __thread TSK_t *Self;
+
+static void ticks_to_abs(int ticks, struct timespec *ts){
+	clock_gettime(CLOCK_MONOTONIC, ts);
+	ts->tv_sec += ticks / OS_TICK_PER_SEC;
+	ts->tv_nsec += (long) (ticks % OS_TICK_PER_SEC) * OS_TIMER_US * 1000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+unsigned int host_ticks(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned int) ((ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000) / OS_TIMER_US);
+}
+
+void *OSalloc(size_t Size){
+	return malloc(Size);
+}
+
+// Returns 1 when this call disabled the "interrupts", as OSintBack() needs to know
+int OSintOff(void){
+	if (IntOff)
+		return 0;
+	pthread_mutex_lock(&IntLock);
+	IntOff = 1;
+	return 1;
+}
+
+void OSintBack(int State){
+	if (State != 0 && IntOff) {
+		IntOff = 0;
+		pthread_mutex_unlock(&IntLock);
+	}
+}
+
+SEM_t *SEMopen(const char *Name){
+	SEM_t *sem = calloc(1, sizeof(SEM_t));
+	pthread_condattr_t attr;
+
+	if (sem == NULL)
+		return NULL;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&sem->Lock, NULL);
+	pthread_cond_init(&sem->Cond, &attr);
+	pthread_condattr_destroy(&attr);
+	return sem;
+}
+
+int SEMpost(SEM_t *Sem){
+	pthread_mutex_lock(&Sem->Lock);
+	Sem->Value++;
+	pthread_cond_signal(&Sem->Cond);
+	pthread_mutex_unlock(&Sem->Lock);
+	return 0;
+}
+
+// Tout in ticks: < 0 forever, 0 no wait. Returns 0 when taken, non-zero on timeout
+static int sem_take(SEM_t *Sem, int Tout, int Bin){
+	struct timespec ts;
+	int err = 0;
+
+	if (Tout > 0)
+		ticks_to_abs(Tout, &ts);
+	pthread_mutex_lock(&Sem->Lock);
+	while (Sem->Value == 0 && err == 0) {
+		if (Tout == 0)
+			err = ETIMEDOUT;
+		else if (Tout < 0)
+			pthread_cond_wait(&Sem->Cond, &Sem->Lock);
+		else
+			err = pthread_cond_timedwait(&Sem->Cond, &Sem->Lock, &ts);
+	}
+	if (Sem->Value != 0) {
+		err = 0;
+		Sem->Value = Bin ? 0 : Sem->Value - 1;
+	}
+	pthread_mutex_unlock(&Sem->Lock);
+	return err != 0;
+}
+
+int SEMwait(SEM_t *Sem, int Tout){
+	return sem_take(Sem, Tout, 0);
+}
+
+int SEMwaitBin(SEM_t *Sem, int Tout){
+	return sem_take(Sem, Tout, 1);
+}
+
+MTX_t *MTXopen(const char *Name){
+	MTX_t *mtx = calloc(1, sizeof(MTX_t));
+	pthread_mutexattr_t attr;
+
+	if (mtx == NULL)
+		return NULL;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mtx->Lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+	return mtx;
+}
+
+int MTXlock(MTX_t *Mtx, int Tout){
+	if (Tout == 0)
+		return pthread_mutex_trylock(&Mtx->Lock) != 0;
+	pthread_mutex_lock(&Mtx->Lock);		// The port only waits forever or not at all
+	return 0;
+}
+
+int MTXunlock(MTX_t *Mtx){
+	pthread_mutex_unlock(&Mtx->Lock);
+	return 0;
+}
+
+// Always created suspended, as sys_thread_new() does: TSKresume() starts the thread
+TSK_t *TSKcreate(const char *Name, int Prio, int StackSize, void (*Fct)(void), int Start){
+	TSK_t *task = calloc(1, sizeof(TSK_t));
+
+	if (task != NULL)
+		task->fct = Fct;
+	return task;
+}
+
+void TSKsetArg(TSK_t *Task, void *Arg){
+	Task->arg = Arg;
+}
+
+void *TSKgetArg(void){
+	return Self != NULL ? Self->arg : NULL;
+}
+
+static void *trampoline(void *arg){
+	Self = arg;
+	Self->fct();
+	return NULL;
+}
+
+void TSKresume(TSK_t *Task){
+	pthread_create(&Task->thread, NULL, trampoline, Task);
+	pthread_detach(Task->thread);
+}
+
+void TSKselfSusp(void){
+	for (;;)
+		TSKsleep(OS_TICK_PER_SEC);
+}
+
+void TSKsleep(int Ticks){
+	struct timespec ts;
+	ts.tv_sec = Ticks / OS_TICK_PER_SEC;
+	ts.tv_nsec = (long) (Ticks % OS_TICK_PER_SEC) * OS_TIMER_US * 1000;
+	nanosleep(&ts, NULL);
+}
+
+void TSKyield(void){
+	sched_yield();
+}
@@ -0,0 +1,13 @@
+/*
+ * SysCall.h (host)
+ *
+ *  The board file system calls are the POSIX ones.
+ */
+
+#ifndef HOST_SYSCALL_H_
+#define HOST_SYSCALL_H_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#endif /* HOST_SYSCALL_H_ */
@@ -0,0 +1,21 @@
+/*
+ * hwlib.h (host)
+ *
+ *  No FPGA nor HPS registers on the host: accesses are dropped.
+ */
+
+#ifndef HOST_HWLIB_H_
+#define HOST_HWLIB_H_
+#include "mAbassi.h"
+
+#define ALT_E_SUCCESS			0
+#define ALT_LWFPGASLVS_OFST		0
+
+#define alt_write_word(addr, v)		((void) (addr), (void) (v))
+#define alt_write_hword(addr, v)	((void) (addr), (void) (v))
+#define alt_write_byte(addr, v)		((void) (addr), (void) (v))
+#define alt_read_word(addr)			((void) (addr), 0)
+#define alt_read_hword(addr)		((void) (addr), 0)
+#define alt_read_byte(addr)			((void) (addr), 0)
+
+#endif /* HOST_HWLIB_H_ */
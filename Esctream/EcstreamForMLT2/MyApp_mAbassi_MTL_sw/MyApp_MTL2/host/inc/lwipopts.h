@@ -0,0 +1,35 @@
+/*
+ * lwipopts.h (host)
+ *
+ *  lwIP 1.4.1 without an OS and with the loopback interface only, for
+ *  netsync_test.c: IPv4 and UDP, called from a single loop.
+ */
+
+#ifndef HOST_LWIPOPTS_H_
+#define HOST_LWIPOPTS_H_
+
+#define NO_SYS					1
+#define SYS_LIGHTWEIGHT_PROT	0
+
+#define MEM_ALIGNMENT			8
+#define MEM_SIZE				(256*1024)
+#define PBUF_POOL_SIZE			64
+#define MEMP_NUM_UDP_PCB		4
+
+#define LWIP_ARP				1
+#define LWIP_ICMP				1
+#define LWIP_UDP				1
+#define LWIP_TCP				0
+#define LWIP_DHCP				0
+#define LWIP_IGMP				0
+#define LWIP_DNS				0
+#define LWIP_RAW				0
+#define LWIP_NETCONN			0
+#define LWIP_SOCKET				0
+#define LWIP_STATS				0
+
+#define LWIP_HAVE_LOOPIF		1
+#define LWIP_NETIF_LOOPBACK		1
+#define LWIP_LOOPBACK_MAX_PBUFS	0			// 1.4.1 miscounts a queue of several packets
+
+#endif /* HOST_LWIPOPTS_H_ */
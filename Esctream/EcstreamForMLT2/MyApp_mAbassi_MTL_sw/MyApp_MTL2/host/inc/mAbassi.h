@@ -0,0 +1,41 @@
+/*
+ * mAbassi.h (host)
+ *
+ *  The part of the mAbassi API used by the game, implemented in host_os.c
+ *  for the Linux host build. The system timer ticks at 1 kHz.
+ */
+
+#ifndef HOST_MABASSI_H_
+#define HOST_MABASSI_H_
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct{ const char *name; }MTX_t;
+typedef struct{ const char *name; int count; }SEM_t;
+typedef struct{ const char *name; intptr_t msg; bool full; }MBX_t;
+
+MTX_t *MTXopen(const char *name);
+int MTXlock(MTX_t *mtx, int timeout);
+int MTXunlock(MTX_t *mtx);
+SEM_t *SEMopen(const char *name);
+int SEMwait(SEM_t *sem, int timeout);
+int SEMpost(SEM_t *sem);
+void SEMreset(SEM_t *sem);
+MBX_t *MBXopen(const char *name, int size);
+int MBXput(MBX_t *mbx, intptr_t msg, int timeout);
+int MBXget(MBX_t *mbx, intptr_t *msg, int timeout);
+void TSKsleep(int ticks);
+
+int host_ticks(void);
+#define G_OStimCnt				host_ticks()
+#define OS_MS_TO_TICK(ms)		(ms)
+#define OS_TICK_EXP(ticks)		(G_OStimCnt + (ticks))
+#define OS_HAS_TIMEDOUT(exp)	((G_OStimCnt - (int) (exp)) >= 0)
+
+#define OX_N_CORE				1
+#define COREgetID()				0
+
+#endif /* HOST_MABASSI_H_ */
@@ -0,0 +1 @@
+/* alt_gpio.h (host): board only, nothing needed by the game */
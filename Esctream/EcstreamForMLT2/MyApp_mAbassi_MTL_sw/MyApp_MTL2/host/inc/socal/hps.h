@@ -0,0 +1 @@
+/* hps.h (host): board only, nothing needed by the game */
@@ -0,0 +1 @@
+/* socal.h (host): board only, nothing needed by the game */
@@ -0,0 +1,540 @@
+/*
+ * lwipbench.c
+ *
+ *  Throughput and latency of the lwIP of the board built for Linux, with the
+ *  lwIP options of the board (Share/inc/lwipopts.h), its port (sys_arch.c:
+ *  mailboxes, semaphores, protection) and the netconn API. The netif stands
+ *  for the EMAC:
+ *    tcpip thread -> wire_output() -> copy in PBUF_POOL pbufs, as the EMAC
+ *    receives -> wire mailbox (WIRE_RXBUF deep, the RX ring) -> wire task
+ *    -> tcpip_input()
+ *  so the pbuf pool and the mailboxes take the load they do on the board.
+ *
+ *  Loopback: the scenarios run one after the other between two tasks on
+ *  WIRE_ADDR, and for each prints the throughput (Mbit/s) or the round trip
+ *  latency, the pbuf pool pressure (most used, failed allocations), the
+ *  packets dropped by the wire and the CPU time of the process.
+ *  TUN (-t): the wire is a TUN device and the other end is the Linux stack;
+ *  lwIP serves the same ports (sink and echo) for iperf, ping, etc. and the
+ *  figures are printed every second. Linux wants the checksums the EMAC
+ *  fills in on the board, so build with make SW_CHECKSUM=1:
+ *    ip tuntap add tun0 mode tun; ip addr add 10.0.0.2/24 dev tun0; ip link set tun0 up
+ *    lwipbench -t tun0 &  iperf -c 10.0.0.1 -p 5001
+ *
+ *  -z writes TCP with NETCONN_NOCOPY, as the web server of the board sends
+ *  its files, instead of copying the data into the segments.
+ *
+ *  Usage: lwipbench [-d seconds] [-n round_trips] [-w write_size] [-u udp_size]
+ *                   [-r udp_mbits, 0 flat out] [-t tun] [-z]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include "lwip/api.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+
+#define WIRE_ADDR		"10.0.0.1"
+#define WIRE_MTU		1500
+#define WIRE_RXBUF		64			// ETH_N_RXBUF of the cached EMAC buffers
+#define WIRE_RETRY		100			// Yields to the tcpip thread before a packet is dropped
+#define PORT_TCP_SINK	5001
+#define PORT_UDP_SINK	5002
+#define PORT_TCP_ECHO	5003
+#define PORT_UDP_ECHO	5004
+#define MAX_RTT			100000
+
+typedef struct{
+	struct netif netif;
+	sys_mbox_t   mbox;			// Packets on the wire
+	int          tun;			// TUN device, -1 for the loopback
+	uint32_t     no_pbuf;		// Dropped: pool empty when received
+	uint32_t     full;			// Dropped: RX ring full
+	uint32_t     refused;		// Dropped: tcpip mailbox full
+}WIRE;
+
+typedef struct{
+	uint64_t bytes;
+	uint32_t packets;
+	uint32_t lost;				// UDP: holes in the sequence numbers
+	uint32_t next;				// UDP: next sequence number expected
+	uint64_t first, last;		// Time of the first and last bytes (us)
+	sys_sem_t done;
+}SINK;
+
+#if MEMP_STATS
+static const char *const memp_name[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) desc,
+#include "lwip/memp_std.h"
+};
+#endif
+
+static WIRE wire;
+static SINK sink;
+static int duration = 2, round_trips = 10000, write_size = 8192, udp_size = 1472, udp_mbits = 100;
+static uint8_t buf[65536];
+static uint8_t write_flags = NETCONN_COPY;
+static uint32_t rtt[MAX_RTT];
+
+static uint64_t now_us(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static uint64_t cpu_us(void){
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* The wire																							*/
+
+// Received by the other end as the EMAC would: copied in pool pbufs, dropped when the pool or the ring is full
+static void wire_rx(struct pbuf *q){
+	if (q == NULL) {
+		wire.no_pbuf++;
+		return;
+	}
+	if (sys_mbox_trypost(&wire.mbox, q) != ERR_OK) {
+		pbuf_free(q);
+		wire.full++;
+	}
+}
+
+static err_t wire_output(struct netif *netif, struct pbuf *p, ip_addr_t *ipaddr){
+	struct pbuf *q;
+	static uint8_t frame[WIRE_MTU];
+
+	if (wire.tun >= 0) {
+		pbuf_copy_partial(p, frame, sizeof(frame), 0);
+		if (write(wire.tun, frame, p->tot_len < sizeof(frame) ? p->tot_len : sizeof(frame)) < 0)
+			wire.full++;
+		return ERR_OK;
+	}
+	q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_POOL);
+	if (q != NULL)
+		pbuf_copy(q, p);
+	wire_rx(q);
+	return ERR_OK;
+}
+
+// The input task of ethernetif.c: hands the received packets to the tcpip thread. On the board
+// the tcpip thread has the higher priority and takes each packet as it is posted; the host
+// ignores the priorities, so when its mailbox is full it is given the CPU a few times first.
+static void wire_task(void *arg){
+	void *msg;
+	int i;
+	for (;;) {
+		sys_arch_mbox_fetch(&wire.mbox, &msg, 0);
+		for (i=0; wire.netif.input(msg, &wire.netif) != ERR_OK; i++) {
+			if (i == WIRE_RETRY) {
+				pbuf_free(msg);
+				wire.refused++;
+				break;
+			}
+			TSKyield();
+		}
+	}
+}
+
+// The TUN device is read here, one packet per read()
+static void tun_task(void *arg){
+	static uint8_t frame[WIRE_MTU];
+	struct pbuf *q;
+	ssize_t len;
+	for (;;) {
+		len = read(wire.tun, frame, sizeof(frame));
+		if (len <= 0)
+			continue;
+		q = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+		if (q != NULL)
+			pbuf_take(q, frame, len);
+		wire_rx(q);
+	}
+}
+
+static err_t wire_init(struct netif *netif){
+	netif->name[0] = 'w';
+	netif->name[1] = 'r';
+	netif->mtu = WIRE_MTU;
+	netif->output = wire_output;
+	netif->flags = NETIF_FLAG_UP | NETIF_FLAG_LINK_UP;
+	return ERR_OK;
+}
+
+static int tun_open(const char *name){
+	struct ifreq ifr;
+	int fd = open("/dev/net/tun", O_RDWR);
+	if (fd < 0)
+		return -1;
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+	strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+	if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Servers																							*/
+
+static void sink_add(SINK *s, struct netbuf *nb){
+	void *data;
+	u16_t len;
+	uint64_t t = now_us();
+	do {
+		netbuf_data(nb, &data, &len);
+		s->bytes += len;
+	} while (netbuf_next(nb) >= 0);
+	if (s->first == 0)
+		s->first = t;
+	s->last = t;
+	s->packets++;
+}
+
+static void tcp_sink_task(void *arg){
+	struct netconn *listen = netconn_new(NETCONN_TCP), *conn;
+	struct netbuf *nb;
+	netconn_bind(listen, IP_ADDR_ANY, PORT_TCP_SINK);
+	netconn_listen(listen);
+	for (;;) {
+		if (netconn_accept(listen, &conn) != ERR_OK)
+			continue;
+		while (netconn_recv(conn, &nb) == ERR_OK) {
+			sink_add(&sink, nb);
+			netbuf_delete(nb);
+		}
+		netconn_close(conn);
+		netconn_delete(conn);
+		sys_sem_signal(&sink.done);
+	}
+}
+
+// The payload starts with a sequence number, holes are counted as lost
+static void udp_sink_task(void *arg){
+	struct netconn *conn = netconn_new(NETCONN_UDP);
+	struct netbuf *nb;
+	uint32_t seq;
+	netconn_bind(conn, IP_ADDR_ANY, PORT_UDP_SINK);
+	for (;;) {
+		if (netconn_recv(conn, &nb) != ERR_OK)
+			continue;
+		if (netbuf_copy(nb, &seq, sizeof(seq)) == sizeof(seq)) {
+			if (seq == 0)
+				sink.next = 0;
+			if (seq > sink.next)
+				sink.lost += seq - sink.next;
+			if (seq >= sink.next)
+				sink.next = seq + 1;
+		}
+		sink_add(&sink, nb);
+		netbuf_delete(nb);
+	}
+}
+
+static void tcp_echo_task(void *arg){
+	struct netconn *listen = netconn_new(NETCONN_TCP), *conn;
+	struct netbuf *nb;
+	void *data;
+	u16_t len;
+	netconn_bind(listen, IP_ADDR_ANY, PORT_TCP_ECHO);
+	netconn_listen(listen);
+	for (;;) {
+		if (netconn_accept(listen, &conn) != ERR_OK)
+			continue;
+		tcp_nagle_disable(conn->pcb.tcp);
+		while (netconn_recv(conn, &nb) == ERR_OK) {
+			do {
+				netbuf_data(nb, &data, &len);
+				netconn_write(conn, data, len, NETCONN_COPY);
+			} while (netbuf_next(nb) >= 0);
+			netbuf_delete(nb);
+		}
+		netconn_close(conn);
+		netconn_delete(conn);
+	}
+}
+
+static void udp_echo_task(void *arg){
+	struct netconn *conn = netconn_new(NETCONN_UDP);
+	struct netbuf *nb;
+	netconn_bind(conn, IP_ADDR_ANY, PORT_UDP_ECHO);
+	for (;;) {
+		if (netconn_recv(conn, &nb) != ERR_OK)
+			continue;
+		netconn_sendto(conn, nb, netbuf_fromaddr(nb), netbuf_fromport(nb));
+		netbuf_delete(nb);
+	}
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Scenarios																						*/
+
+typedef struct{
+	uint64_t cpu;
+	uint32_t no_pbuf, full, refused;
+}MARK;
+
+static void mark(MARK *m){
+	int i;
+	sink.bytes = 0;
+	sink.packets = 0;
+	sink.lost = 0;
+	sink.first = 0;
+	sink.last = 0;
+#if MEMP_STATS
+	for (i=0; i<MEMP_MAX; i++) {
+		lwip_stats.memp[i].max = lwip_stats.memp[i].used;
+		lwip_stats.memp[i].err = 0;
+	}
+#endif
+	m->no_pbuf = wire.no_pbuf;
+	m->full = wire.full;
+	m->refused = wire.refused;
+	m->cpu = cpu_us();
+}
+
+// Pool pressure, drops and CPU time since mark(), mbytes moved in that time
+static void report(const MARK *m, uint64_t elapsed, double mbytes){
+	uint64_t cpu = cpu_us() - m->cpu;
+	int i;
+#if MEMP_STATS
+	printf("  pbuf pool: %u of %u used at most, %u allocations failed\n",
+		(unsigned) lwip_stats.memp[MEMP_PBUF_POOL].max, (unsigned) PBUF_POOL_SIZE, (unsigned) lwip_stats.memp[MEMP_PBUF_POOL].err);
+	for (i=0; i<MEMP_MAX; i++)			// The other pools only when they ran out
+		if (i != MEMP_PBUF_POOL && lwip_stats.memp[i].err != 0)
+			printf("  %s pool: %u of %u used at most, %u allocations failed\n", memp_name[i],
+				(unsigned) lwip_stats.memp[i].max, (unsigned) lwip_stats.memp[i].avail, (unsigned) lwip_stats.memp[i].err);
+#endif
+	printf("  wire drops: %u pool empty, %u ring full, %u tcpip mailbox full\n",
+		(unsigned) (wire.no_pbuf - m->no_pbuf), (unsigned) (wire.full - m->full), (unsigned) (wire.refused - m->refused));
+	printf("  cpu: %.3f s (%.0f%%)", cpu / 1e6, elapsed ? 100.0 * cpu / elapsed : 0.0);
+	if (mbytes > 0)
+		printf(", %.0f us per MB", cpu / mbytes);
+	printf("\n");
+}
+
+static struct netconn *connect_to(enum netconn_type type, int port){
+	struct netconn *conn = netconn_new(type);
+	if (conn != NULL && netconn_connect(conn, &wire.netif.ip_addr, port) != ERR_OK) {
+		netconn_delete(conn);
+		conn = NULL;
+	}
+	if (conn == NULL)
+		printf("  cannot connect to port %d\n", port);
+	return conn;
+}
+
+// From buf, not copied: the wire has copied the datagram when netconn_send() returns
+static err_t udp_send(struct netconn *conn, int len){
+	struct netbuf *nb = netbuf_new();
+	err_t err = ERR_MEM;
+	if (nb != NULL && netbuf_ref(nb, buf, len) == ERR_OK)
+		err = netconn_send(conn, nb);
+	netbuf_delete(nb);
+	return err;
+}
+
+static void tcp_throughput(void){
+	struct netconn *conn;
+	MARK m;
+	uint64_t end;
+
+	printf("tcp throughput, %d byte writes%s, %d s\n", write_size, write_flags == NETCONN_NOCOPY ? " (no copy)" : "", duration);
+	mark(&m);
+	if ((conn = connect_to(NETCONN_TCP, PORT_TCP_SINK)) == NULL)
+		return;
+	end = now_us() + duration * 1000000ULL;
+	while (now_us() < end)
+		if (netconn_write(conn, buf, write_size, write_flags) != ERR_OK)
+			break;
+	netconn_close(conn);
+	netconn_delete(conn);
+	sys_arch_sem_wait(&sink.done, 5000);
+	printf("  %.1f Mbit/s, %llu bytes in %u netbufs\n", sink.last > sink.first ? sink.bytes * 8.0 / (sink.last - sink.first) : 0.0,
+		(unsigned long long) sink.bytes, (unsigned) sink.packets);
+	report(&m, sink.last - sink.first, sink.bytes / 1e6);
+}
+
+// Paced to udp_mbits, flat out when 0
+static void udp_throughput(void){
+	struct netconn *conn;
+	MARK m;
+	uint64_t start, end, t;
+	uint32_t seq = 0;
+	double period = udp_mbits > 0 ? udp_size * 8.0 / udp_mbits : 0;
+
+	if (udp_mbits > 0)
+		printf("udp throughput, %d byte datagrams at %d Mbit/s, %d s\n", udp_size, udp_mbits, duration);
+	else
+		printf("udp throughput, %d byte datagrams flat out, %d s\n", udp_size, duration);
+	mark(&m);
+	if ((conn = connect_to(NETCONN_UDP, PORT_UDP_SINK)) == NULL)
+		return;
+	start = now_us();
+	end = start + duration * 1000000ULL;
+	while ((t = now_us()) < end) {
+		if (period > 0 && t < start + (uint64_t) (seq * period)) {
+			usleep(start + (uint64_t) (seq * period) - t);	// Not spinning, the CPU time stays the stack's
+			continue;
+		}
+		memcpy(buf, &seq, sizeof(seq));
+		if (udp_send(conn, udp_size) == ERR_OK)
+			seq++;
+	}
+	TSKsleep(OS_MS_TO_TICK(200));		// What is still on the way
+	netconn_delete(conn);
+	printf("  %.1f Mbit/s received of %.1f sent, %u of %u datagrams lost\n",
+		sink.last > sink.first ? sink.bytes * 8.0 / (sink.last - sink.first) : 0.0, seq * udp_size * 8.0 / (end - start),
+		(unsigned) (seq - sink.packets), (unsigned) seq);
+	report(&m, end - start, sink.bytes / 1e6);
+}
+
+static int cmp(const void *a, const void *b){
+	return (int) (*(const uint32_t *) a - *(const uint32_t *) b);
+}
+
+// Round trips of 64 bytes, one at a time
+static void latency(enum netconn_type type, int port){
+	struct netconn *conn;
+	struct netbuf *nb;
+	MARK m;
+	uint64_t start, t;
+	int i, n = 0, got, lost = 0;
+
+	printf("%s latency, %d round trips of 64 bytes\n", type == NETCONN_TCP ? "tcp" : "udp", round_trips);
+	mark(&m);
+	if ((conn = connect_to(type, port)) == NULL)
+		return;
+	if (type == NETCONN_TCP)
+		tcp_nagle_disable(conn->pcb.tcp);
+	netconn_set_recvtimeout(conn, 1000);
+	start = now_us();
+	for (i=0; i<round_trips && n<MAX_RTT; i++) {
+		t = now_us();
+		if (type == NETCONN_TCP)
+			netconn_write(conn, buf, 64, NETCONN_COPY);
+		else
+			udp_send(conn, 64);
+		for (got=0; got<64; ) {
+			if (netconn_recv(conn, &nb) != ERR_OK)
+				break;
+			got += netbuf_len(nb);
+			netbuf_delete(nb);
+		}
+		if (got < 64)
+			lost++;
+		else
+			rtt[n++] = now_us() - t;
+	}
+	t = now_us() - start;
+	netconn_close(conn);
+	netconn_delete(conn);
+	qsort(rtt, n, sizeof(rtt[0]), cmp);
+	if (n > 0)
+		printf("  rtt p50 %u us, p99 %u us, max %u us, %d lost\n", (unsigned) rtt[n / 2], (unsigned) rtt[n * 99 / 100],
+			(unsigned) rtt[n - 1], lost);
+	report(&m, t, 0);
+}
+
+// Runs in the tcpip thread once it is started, as the board application brings its netif up
+static void tcpip_ready(void *arg){
+	ip_addr_t addr, mask, gw;
+
+	ipaddr_aton(WIRE_ADDR, &addr);
+	IP4_ADDR(&mask, 255, 255, 255, 0);
+	ip_addr_set_zero(&gw);
+	netif_add(&wire.netif, &addr, &mask, &gw, NULL, wire_init, tcpip_input);
+	netif_set_default(&wire.netif);
+	netif_set_up(&wire.netif);
+	sys_sem_signal((sys_sem_t *) arg);
+}
+
+int main(int argc, char *argv[]){
+	const char *tun = NULL;
+	sys_sem_t ready;
+	MARK m;
+	uint64_t t;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:n:w:u:r:t:z")) != -1) {
+		switch (opt) {
+		case 'd': duration = atoi(optarg); break;
+		case 'n': round_trips = atoi(optarg); break;
+		case 'w': write_size = atoi(optarg); break;
+		case 'u': udp_size = atoi(optarg); break;
+		case 'r': udp_mbits = atoi(optarg); break;
+		case 't': tun = optarg; break;
+		case 'z': write_flags = NETCONN_NOCOPY; break;
+		default:
+			fprintf(stderr, "Usage: %s [-d seconds] [-n round_trips] [-w write_size] [-u udp_size] [-r udp_mbits] [-t tun] [-z]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (write_size > (int) sizeof(buf) || udp_size < 4 || udp_size > WIRE_MTU - 28) {
+		fprintf(stderr, "lwipbench: -w up to %d, -u from 4 to %d\n", (int) sizeof(buf), WIRE_MTU - 28);
+		return 2;
+	}
+	wire.tun = -1;
+	if (tun != NULL && CHECKSUM_GEN_TCP == 0) {
+		fprintf(stderr, "lwipbench: -t needs the checksums in software, make clean; make SW_CHECKSUM=1\n");
+		return 2;
+	}
+	if (tun != NULL && (wire.tun = tun_open(tun)) < 0) {
+		perror("lwipbench: /dev/net/tun");
+		return 1;
+	}
+
+	G_OSmutex = MTXopen("Printf");
+	sys_sem_new(&ready, 0);
+	sys_sem_new(&sink.done, 0);
+	sys_mbox_new(&wire.mbox, WIRE_RXBUF);
+	tcpip_init(tcpip_ready, &ready);
+	sys_arch_sem_wait(&ready, 0);
+
+	sys_thread_new("Wire", wire_task, NULL, DEFAULT_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
+	sys_thread_new("TCP sink", tcp_sink_task, NULL, DEFAULT_THREAD_STACKSIZE, TCPIP_THREAD_PRIO+1);
+	sys_thread_new("UDP sink", udp_sink_task, NULL, DEFAULT_THREAD_STACKSIZE, TCPIP_THREAD_PRIO+1);
+	sys_thread_new("TCP echo", tcp_echo_task, NULL, DEFAULT_THREAD_STACKSIZE, TCPIP_THREAD_PRIO+1);
+	sys_thread_new("UDP echo", udp_echo_task, NULL, DEFAULT_THREAD_STACKSIZE, TCPIP_THREAD_PRIO+1);
+	TSKsleep(OS_MS_TO_TICK(50));
+
+	printf("lwIP %d.%d.%d, %d pbufs of %d bytes, TCP_MSS %d, TCP_WND %d, tcpip mailbox %d, recv mailboxes %d/%d (TCP/UDP)\n",
+		LWIP_VERSION_MAJOR, LWIP_VERSION_MINOR, LWIP_VERSION_REVISION, PBUF_POOL_SIZE, PBUF_POOL_BUFSIZE,
+		TCP_MSS, TCP_WND, TCPIP_MBOX_SIZE, DEFAULT_TCP_RECVMBOX_SIZE, DEFAULT_UDP_RECVMBOX_SIZE);
+
+	if (tun != NULL) {			// wire.tun is open, checked above
+		sys_thread_new("TUN", tun_task, NULL, DEFAULT_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
+		printf("%s on %s: TCP sink %d, UDP sink %d, TCP echo %d, UDP echo %d\n", WIRE_ADDR, tun,
+			PORT_TCP_SINK, PORT_UDP_SINK, PORT_TCP_ECHO, PORT_UDP_ECHO);
+		for (;;) {
+			mark(&m);
+			t = now_us();
+			TSKsleep(OS_MS_TO_TICK(1000));
+			t = now_us() - t;
+			printf("%.1f Mbit/s received\n", sink.bytes * 8.0 / t);
+			report(&m, t, sink.bytes / 1e6);
+		}
+	}
+
+	tcp_throughput();
+	udp_throughput();
+	latency(NETCONN_TCP, PORT_TCP_ECHO);
+	latency(NETCONN_UDP, PORT_UDP_ECHO);
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * netsync_test.c
+ *
+ *  Loopback test of the UDP game sync (../game/netsync.h) with the lwIP of
+ *  the board built for Linux: two boards on 127.0.0.1, on NETSYNC_PORT and
+ *  NETSYNC_PORT+1, send each other position frames and take the payload
+ *  into an SPSC_RING as the game task does. Replayed and corrupted datagrams
+ *  are injected on the way. Prints what each board got and the latency from
+ *  the building of a frame to its words in the ring.
+ *
+ *  Usage: netsync_test [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "netsync.h"
+#include "spsc.h"
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/timers.h"
+
+#define BOARDS		2
+
+typedef struct{
+	NETSYNC   ns;
+	SPSC_RING ring;
+	uint8_t   seq;
+	uint32_t  next_pos;		// Position word the next frame carries
+	uint32_t  expected;		// Position word the next received should be
+	int       frames;		// Frames left to send
+	bool      turn;			// May send one now
+	int       received;
+	int       wrong;		// Words out of order
+}BOARD;
+
+static BOARD board[BOARDS];
+static uint32_t lat[200000];
+static int nlat;
+
+static uint32_t now_us(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) (ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+u32_t sys_now(void){
+	return now_us() / 1000;
+}
+
+static bool next(BOARD *b, FRAME *f){
+	if (!b->turn || b->frames == 0)
+		return false;
+	b->turn = false;
+	b->frames--;
+	FRAME_Begin(f, b - board, FRAME_WORDS, b->seq++, now_us());
+	FRAME_Add(f, b->next_pos++);
+	FRAME_End(f);
+	return true;
+}
+
+static void received(BOARD *b, const uint32_t *word, int n, uint32_t time){
+	int i;
+	uint32_t w, t;
+	for (i=0; i<n; i++)
+		SPSC_Push(&b->ring, word[i], time);		// Sender time of the frame, to measure the latency
+	// The game task side
+	while (SPSC_Pop(&b->ring, &w, &t)) {
+		if (w != b->expected)
+			b->wrong++;
+		b->expected = w + 1;
+		b->received++;
+		if (nlat < (int) (sizeof(lat) / sizeof(lat[0])))
+			lat[nlat++] = now_us() - t;
+	}
+}
+
+static bool next0(FRAME *f){ return next(board + 0, f); }
+static bool next1(FRAME *f){ return next(board + 1, f); }
+static void received0(const uint32_t *word, int n, uint32_t time){ received(board + 0, word, n, time); }
+static void received1(const uint32_t *word, int n, uint32_t time){ received(board + 1, word, n, time); }
+
+// Raw datagram to board 1, as another host on the link could send it
+static void inject(struct udp_pcb *pcb, const FRAME *f, bool corrupt){
+	struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, f->len * 4, PBUF_RAM);
+	ip_addr_t lo;
+	IP4_ADDR(&lo, 127, 0, 0, 1);
+	memcpy(p->payload, f->word, f->len * 4);
+	if (corrupt)
+		((uint32_t *) p->payload)[1] ^= 0x100;
+	udp_sendto(pcb, p, &lo, NETSYNC_PORT + 1);
+	pbuf_free(p);
+}
+
+static int cmp(const void *a, const void *b){
+	return (int) (*(const uint32_t *) a - *(const uint32_t *) b);
+}
+
+int main(int argc, char *argv[]){
+	int frames = argc > 1 ? atoi(argv[1]) : 100000;
+	struct udp_pcb *other;
+	ip_addr_t lo;
+	FRAME old;
+	uint32_t start, elapsed;
+	int i, fails = 0;
+
+	lwip_init();
+	IP4_ADDR(&lo, 127, 0, 0, 1);
+	for (i=0; i<BOARDS; i++) {
+		SPSC_Init(&board[i].ring);
+		board[i].frames = frames;
+		board[i].next_pos = (uint32_t) i << 20;
+		board[i].expected = (uint32_t) (BOARDS - 1 - i) << 20;
+	}
+	if (!NETSYNC_Init(&board[0].ns, NETSYNC_PORT, &lo, NETSYNC_PORT + 1, next0, received0)
+	 || !NETSYNC_Init(&board[1].ns, NETSYNC_PORT + 1, &lo, NETSYNC_PORT, next1, received1)) {
+		fprintf(stderr, "netsync_test: NETSYNC_Init failed\n");
+		return 1;
+	}
+	other = udp_new();
+
+	start = now_us();
+	while (board[0].frames > 0 || board[1].frames > 0) {
+		// One frame of each board at a time, as the timer would send them
+		for (i=0; i<BOARDS; i++) {
+			board[i].turn = true;
+			NETSYNC_Poll(&board[i].ns);
+		}
+		if (board[0].frames == frames / 4 + 3)
+			old = board[0].ns.tx;			// Sent again 3 frames later
+		if (board[0].frames == frames / 4) {
+			inject(other, &old, false);		// Replay: dropped as stale
+			inject(other, &board[0].ns.tx, true);	// Dropped by the CRC
+		}
+		netif_poll_all();
+		sys_check_timeouts();
+	}
+	netif_poll_all();
+	elapsed = now_us() - start;
+
+	for (i=0; i<BOARDS; i++) {
+		BOARD *b = board + i;
+		printf("board %d: %u sent, %u send errors, %d words received, %d out of order, %u stale, %u bad, %u gathered\n",
+			i, (unsigned) b->ns.sent, (unsigned) b->ns.send_errors, b->received, b->wrong, (unsigned) b->ns.rx.stale, (unsigned) b->ns.rx.crc_errors, (unsigned) b->ns.gathered);
+		if (b->received != frames || b->wrong != 0)
+			fails++;
+	}
+	if (board[1].ns.rx.stale != 1 || board[1].ns.rx.crc_errors != 1)
+		fails++;
+	qsort(lat, nlat, sizeof(lat[0]), cmp);
+	if (nlat > 0)
+		printf("latency p50 %u us, p99 %u us, max %u us; %.0f frames/s\n",
+			(unsigned) lat[nlat / 2], (unsigned) lat[nlat * 99 / 100], (unsigned) lat[nlat - 1], 2.0 * frames * 1e6 / elapsed);
+	printf("%s\n", fails ? "FAILED" : "OK");
+	return fails ? 1 : 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * replay_main.c
+ *
+ *  Plays a session recorded on the board (GAME_REPLAY=1) through GUI() on a
+ *  Linux host. The exit status is non zero if the own flag diverged from the
+ *  recording, so sessions double as regression tests; the timings make them
+ *  repeatable benchmarks of the game logic and renderer. With -s, the frames
+ *  displayed are also encoded as the board streams them (see tilecodec.h):
+ *  the file plays in the viewer of the PC port and the bandwidth is printed.
+ *
+ *  Usage: replay [-d image_dir] [-s stream.fbs] session.rpl
+ */
+
+#include <time.h>
+#include "terasic_includes.h"
+#include "gui.h"
+#include "replay.h"
+#include "trace.h"
+#include "tilecodec.h"
+#include "host_os.h"
+
+// Globals of MyApp_MTL2.c
+uint32_t *txdata;
+SPI_EVENT *lastMsg;
+int new_lvl;
+int *flag;
+int *flag2;
+int *lvl1;
+int *lvl2;
+QUEUE_STRUCT *rxQueue;
+SPSC_RING rxRing;
+SPSC_RING txRing;
+SPSC_RING fwdRing;
+
+static FILE *stream;		// -s: tile stream of the frames displayed
+static TILE_ENC enc;
+
+static double now_s(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool replay_Write(void *ctx, const uint8_t *data, int len){
+	return fwrite(data, 1, len, (FILE *) ctx) == (size_t) len;
+}
+
+// Frames are stamped with the session clock, the viewer plays them at that pace
+static void replay_Flip(const uint32_t *frame, int width, int height){
+	uint8_t hdr[TILE_HDR_SIZE];
+
+	if (enc.prev == NULL) {
+		if (!TILE_EncInit(&enc, width, height)) {
+			fprintf(stderr, "replay: no memory for the stream encoder\n");
+			exit(2);
+		}
+		fwrite(hdr, 1, TILE_Header(hdr, width, height), stream);
+	}
+	TILE_EncFrame(&enc, frame, REPLAY_Time(), replay_Write, stream);
+}
+
+int main(int argc, char *argv[]){
+	const char *images = ".";
+	const char *session;
+	char path[256];
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:s:")) != -1) {
+		if (opt == 'd')
+			images = optarg;
+		else if (opt == 's') {
+			if ((stream = fopen(optarg, "wb")) == NULL) {
+				fprintf(stderr, "replay: cannot create %s\n", optarg);
+				return 2;
+			}
+			host_flip = replay_Flip;
+		}
+		else {
+			fprintf(stderr, "Usage: %s [-d image_dir] [-s stream.fbs] session.rpl\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc-1) {
+		fprintf(stderr, "Usage: %s [-d image_dir] [-s stream.fbs] session.rpl\n", argv[0]);
+		return 2;
+	}
+	session = argv[optind];
+	if (realpath(session, path) == NULL || chdir(images) != 0) {	// Images are opened by name
+		fprintf(stderr, "replay: cannot open %s or %s\n", session, images);
+		return 2;
+	}
+
+	// Same start-up state as Task_MTL2
+	txdata = (uint32_t *)malloc(sizeof(uint32_t));
+	lastMsg = (SPI_EVENT *)calloc(GAME_PLAYERS, sizeof(SPI_EVENT));
+	flag = (int *)malloc(sizeof(int));
+	*flag = 0x00000008;
+	flag2 = (int *)calloc(1, sizeof(int));
+	lvl1 = (int *)calloc(1, sizeof(int));
+	lvl2 = (int *)calloc(1, sizeof(int));
+	*txdata = 0;
+	rxQueue = QUEUE_New(MSG_QUEUE_SIZE);
+
+	if (!REPLAY_Open(path, REPLAY_PLAY))
+		return 2;
+
+	double start = now_s();
+	GUI(NULL);
+	double elapsed = now_s() - start;
+	uint32_t session_us = REPLAY_Time();
+	TRACE_Flush();
+	int mismatches = REPLAY_Close();
+
+	printf("replay: %.3f s of session played in %.3f s (x%.1f)\n",
+		   session_us * 1e-6, elapsed, elapsed > 0 ? session_us * 1e-6 / elapsed : 0.0);
+	printf("replay: %u frames, %.1f us per frame\n",
+		   (unsigned) host_stats.frames, host_stats.frames ? elapsed * 1e6 / host_stats.frames : 0.0);
+	if (stream != NULL) {
+		fclose(stream);
+		printf("replay: stream of %u frames, %u tiles, %.1f KB per frame, %.2f Mbit/s at the session rate\n",
+			   (unsigned) enc.frames, (unsigned) enc.tiles, enc.frames ? enc.bytes / 1024.0 / enc.frames : 0.0,
+			   session_us ? enc.bytes * 8.0 / session_us : 0.0);
+	}
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * mAbassi.h (host, lwIP benchmark)
+ *
+ *  The part of the mAbassi API used by the lwIP port (lwip-if/Abassi/sys_arch.c)
+ *  and the lwIP options of the board (Share/inc/lwipopts.h), implemented with
+ *  POSIX threads in host_rtos.c. Only for lwipbench: the game build uses
+ *  ../inc/mAbassi.h.
+ *
+ *  One "core": OSintOff() takes a process wide lock that stands for the
+ *  interrupts being disabled, so the lwIP lightweight protection and the
+ *  sys_spin_lock() sections exclude each other as on the board, while the
+ *  tasks themselves run in parallel. The timer ticks at 1 kHz. Task
+ *  priorities are ignored.
+ */
+
+#ifndef __MABASSI_H__
+#define __MABASSI_H__
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OS_N_CORE				1
+#define OX_N_CORE				1
+#define OS_TIMER_US				1000
+#define OX_TIMER_US				OS_TIMER_US
+#define OS_TICK_PER_SEC			(1000000/(OS_TIMER_US))
+#define OS_MS_TO_TICK(ms)		(((ms)*1000)/(OS_TIMER_US))
+#define OX_DO_NOTHING()			do {} while(0)
+#define LWIP_SPINLOCK			0
+
+typedef struct{							// The port sets Value, as with the mAbassi descriptors
+	pthread_mutex_t Lock;
+	pthread_cond_t  Cond;
+	int             Value;					// Count of the semaphore
+}SEM_t;
+
+typedef struct{
+	pthread_mutex_t Lock;
+	int             Value;					// Not used, the mutex is Lock
+}MTX_t;
+
+typedef struct _HostTsk TSK_t;
+
+extern MTX_t *G_OSmutex;					// Serializes the lwIP debug output
+
+void  *OSalloc(size_t Size);
+int    OSintOff(void);
+void   OSintBack(int State);
+#define COREgetID()				0
+
+SEM_t *SEMopen(const char *Name);
+int    SEMpost(SEM_t *Sem);
+int    SEMwait(SEM_t *Sem, int Tout);
+int    SEMwaitBin(SEM_t *Sem, int Tout);
+#define SEMreset(Sem)			SEMwaitBin((Sem), 0)
+
+MTX_t *MTXopen(const char *Name);
+int    MTXlock(MTX_t *Mtx, int Tout);
+int    MTXunlock(MTX_t *Mtx);
+
+TSK_t *TSKcreate(const char *Name, int Prio, int StackSize, void (*Fct)(void), int Start);
+void   TSKsetArg(TSK_t *Task, void *Arg);
+void  *TSKgetArg(void);
+void   TSKresume(TSK_t *Task);
+void   TSKselfSusp(void);
+void   TSKsleep(int Ticks);
+void   TSKyield(void);
+
+unsigned int host_ticks(void);
+#define G_OStimCnt				host_ticks()
+
+#endif /* __MABASSI_H__ */
@@ -0,0 +1,155 @@
+/*
+ * touchfilter.c
+ *
+ *  Plays a recorded touch trace through the touch filter (touch_filter.h)
+ *  in each mode, to tune it on the host. The trace is the UART output of a
+ *  board built with TRACE_LEVEL=4: its "TOUCH t id action x y" lines are the
+ *  raw FT5316 samples. For each mode it prints:
+ *    jitter	mean |second difference| of the output (px)
+ *    error		mean distance to where the finger really was once the frame
+ *				was displayed, latency later (px)
+ *
+ *  Usage: touchfilter [-l latency_us] [-c min_cutoff] [-b beta] [-d d_cutoff]
+ *                     [-A alpha] [-B ab_beta] [-p predict] trace.log
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "touch_filter.h"
+
+#define MAX_SAMPLES		200000
+#define ACTION_RELEASE	1			// MTC2_RELEASE
+
+typedef struct{
+	uint32_t t;
+	int      id;
+	int      action;
+	int      x, y;		// Raw panel coordinates
+	double   sx, sy;	// Exact screen coordinates
+}SAMPLE;
+
+typedef struct{
+	int      count;		// Outputs since the press
+	double   x[2], y[2];	// Last two outputs
+}HISTORY;
+
+static SAMPLE s[MAX_SAMPLES];
+static int n;
+
+static int load(const char *name){
+	char line[256];
+	unsigned t, id, action, x, y;
+	FILE *fp = fopen(name, "r");
+
+	if (fp == NULL)
+		return -1;
+	while (n < MAX_SAMPLES && fgets(line, sizeof(line), fp) != NULL) {
+		char *p = strstr(line, "TOUCH ");
+		if (p == NULL || sscanf(p, "TOUCH %u %u %u %u %u", &t, &id, &action, &x, &y) != 5)
+			continue;
+		s[n].t = t;
+		s[n].id = id & (TFILTER_IDS-1);
+		s[n].action = action;
+		s[n].x = x;
+		s[n].y = y;
+		s[n].sx = x * (double) TOUCH_SCREEN_WIDTH / TOUCH_PANEL_WIDTH;
+		s[n].sy = y * (double) TOUCH_SCREEN_HEIGHT / TOUCH_PANEL_HEIGHT;
+		n++;
+	}
+	fclose(fp);
+	return n;
+}
+
+// Exact position at time t of the finger of sample i, false if it was released before
+static bool truth(int i, uint32_t t, double *x, double *y){
+	int j;
+	for (j=i+1; j<n; j++) {
+		if (s[j].id != s[i].id)
+			continue;
+		if ((int32_t) (s[j].t - t) >= 0) {
+			double k = (double) (t - s[i].t) / (s[j].t - s[i].t);
+			*x = s[i].sx + k * (s[j].sx - s[i].sx);
+			*y = s[i].sy + k * (s[j].sy - s[i].sy);
+			return true;
+		}
+		if (s[j].action == ACTION_RELEASE)
+			return false;
+		i = j;
+	}
+	return false;
+}
+
+static void run(const char *label, int mode, TFILTER_PARAMS *param, uint32_t latency){
+	static TFILTER f;
+	HISTORY h[TFILTER_IDS];
+	double jitter = 0, error = 0, x, y;
+	int nj = 0, ne = 0, i;
+	uint16_t ox, oy;
+
+	TFILTER_Init(&f);
+	param->mode = mode;
+	TFILTER_SetParams(&f, param);
+	f.latency = latency;
+	memset(h, 0, sizeof(h));
+
+	for (i=0; i<n; i++) {
+		HISTORY *hp = h + s[i].id;
+		TFILTER_Apply(&f, s[i].id, s[i].t, s[i].x, s[i].y, &ox, &oy);
+		if (s[i].action == ACTION_RELEASE) {
+			TFILTER_Release(&f, s[i].id);
+			hp->count = 0;
+			continue;
+		}
+		if (hp->count >= 2) {
+			jitter += fabs(ox - 2*hp->x[1] + hp->x[0]) + fabs(oy - 2*hp->y[1] + hp->y[0]);
+			nj++;
+		}
+		hp->x[0] = hp->x[1];
+		hp->y[0] = hp->y[1];
+		hp->x[1] = ox;
+		hp->y[1] = oy;
+		hp->count++;
+
+		if (truth(i, s[i].t + latency, &x, &y)) {
+			error += sqrt((ox - x) * (ox - x) + (oy - y) * (oy - y));
+			ne++;
+		}
+	}
+	printf("%-12s jitter %6.2f px   error %6.2f px\n", label, nj ? jitter / nj : 0.0, ne ? error / ne : 0.0);
+}
+
+int main(int argc, char *argv[]){
+	static TFILTER f;
+	TFILTER_PARAMS param;
+	uint32_t latency = TFILTER_LATENCY_US;
+	int opt;
+
+	TFILTER_Init(&f);
+	param = f.param;
+	while ((opt = getopt(argc, argv, "l:c:b:d:A:B:p:")) != -1) {
+		switch (opt) {
+		case 'l': latency = atoi(optarg); break;
+		case 'c': param.min_cutoff = atoi(optarg); break;
+		case 'b': param.beta = atoi(optarg); break;
+		case 'd': param.d_cutoff = atoi(optarg); break;
+		case 'A': param.alpha = atoi(optarg); break;
+		case 'B': param.ab_beta = atoi(optarg); break;
+		case 'p': param.predict = atoi(optarg); break;
+		default:
+			fprintf(stderr, "Usage: %s [-l latency_us] [-c min_cutoff] [-b beta] [-d d_cutoff] [-A alpha] [-B ab_beta] [-p predict] trace.log\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc-1 || load(argv[optind]) < 0) {
+		fprintf(stderr, "touchfilter: cannot read the trace\n");
+		return 2;
+	}
+	printf("%d samples, latency %u us, predict %d%%\n", n, (unsigned) latency, param.predict);
+	run("off", TFILTER_OFF, &param, latency);
+	run("one-euro", TFILTER_ONE_EURO, &param, latency);
+	run("alpha-beta", TFILTER_ALPHA_BETA, &param, latency);
+	return 0;
+}
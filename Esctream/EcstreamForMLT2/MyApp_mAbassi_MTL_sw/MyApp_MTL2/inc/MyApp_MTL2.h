@@ -68,6 +68,7 @@ void *fpga_spi = ALT_LWFPGASLVS_ADDR + SPI_RASPBERRYPI_BASE;
 #define GPT_BUTTON_IRQ   ALT_INT_INTERRUPT_F2S_FPGA_IRQ0 + BUTTON_PIO_IRQ
 #define GPT_MTC2_IRQ     ALT_INT_INTERRUPT_F2S_FPGA_IRQ0 + LCD_TOUCH_INT_IRQ
 #define GPT_SPI_IRQ      ALT_INT_INTERRUPT_F2S_FPGA_IRQ0 + SPI_RASPBERRYPI_IRQ
+#define GPT_I2C_IRQ      ALT_INT_INTERRUPT_F2S_FPGA_IRQ0 + I2C_OPENCORES_0_IRQ
 
 // PIO Registers
 #define PIOdirection        1*4
@@ -97,6 +98,7 @@ void Task_MTL2_image(void);
 
 void spi_CallbackInterrupt (uint32_t icciar, void *context);
 void mtc2_CallbackInterrupt (uint32_t icciar, void *context);
+void i2c_CallbackInterrupt (uint32_t icciar, void *context);
 void button_CallbackInterrupt (uint32_t icciar, void *context);
 void button_ConfigureInterrupt( void );
 void setup_hps_gpio( void );
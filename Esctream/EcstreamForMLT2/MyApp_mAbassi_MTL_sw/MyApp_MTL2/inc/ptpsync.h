@@ -0,0 +1,67 @@
+/*
+ * ptpsync.h
+ *
+ *  Shared clock of the boards when GAME_SYNC is 1: the IEEE 1588 system time
+ *  of the EMAC of each board, disciplined to the one of player 0 (the master)
+ *  with a two-step PTP-like exchange on UDP port PTPSYNC_PORT. The time
+ *  stamps are taken by the EMAC when the frames go on and off the wire
+ *  (ETH_PTP* in dw_ethernet.c), so neither the stack nor the tasks add to the
+ *  measured path delay.
+ *
+ *  Every PTPSYNC_PERIOD_MS the master sends to one slave, in turn:
+ *    SYNC			sent at t1 (stamped by the master), received at t2
+ *    FOLLOW_UP		t1
+ *  and the slave answers:
+ *    DELAY_REQ		sent at t3 (stamped by the slave), received at t4
+ *    DELAY_RESP	t4
+ *  offset = ((t2 - t1) - (t4 - t3)) / 2 steps the slave clock when above
+ *  PTPSYNC_STEP_NS, else trims its rate (PI servo on the addend).
+ *
+ *  Message, the words in the byte order of the boards:
+ *    word 0		PTPSYNC_MAGIC [24:31], type [20:23], slave id [16:19], sequence [0:15]
+ *    word 1		seconds: of t1 or t4, the locked boards mask in SYNC, 1 in a
+ *					DELAY_REQ of a locked slave
+ *    word 2		nanoseconds
+ */
+
+#ifndef GAME_PTPSYNC_H_
+#define GAME_PTPSYNC_H_
+#include "Const.h"
+#include "lwip/udp.h"
+
+#ifndef GAME_SYNC
+#define GAME_SYNC			0		// 1: shared clock of the boards, needs GAME_NET
+#endif
+#define PTPSYNC_PORT		5571
+#define PTPSYNC_PERIOD_MS	125		// Between two exchanges of the master
+#define PTPSYNC_MAGIC		0x1B
+#define PTPSYNC_STEP_NS		20000	// Offsets above are stepped, not slewed
+#define PTPSYNC_LOCK_NS		1000	// A slave is locked within this of the master
+#define PTPSYNC_DELAY_MAX	1000000	// ns, longer path delays are dropped
+#define PTPSYNC_PPB_MAX		500000	// Rate correction, at most
+
+#define PTPSYNC_SYNC		0
+#define PTPSYNC_FOLLOW_UP	1
+#define PTPSYNC_DELAY_REQ	2
+#define PTPSYNC_DELAY_RESP	3
+#define PTPSYNC_TYPES		4
+
+typedef struct{
+	struct udp_pcb *pcb;
+	// Statistics of the slave (the master has its own clock)
+	int32_t         offset;		// ns to the master at the last exchange, before correction
+	uint32_t        delay;		// ns, path delay at the last exchange
+	int32_t         ppb;		// Rate correction applied
+	uint32_t        samples;	// Exchanges completed
+	uint32_t        steps;
+	uint32_t        dropped;	// Exchanges a time stamp or a message is missing from
+	uint32_t        locked;		// Bit i: board i within PTPSYNC_LOCK_NS of the master
+}PTPSYNC;
+
+extern PTPSYNC ptpSync;
+
+bool PTPSYNC_Start(void);
+bool PTPSYNC_Synced(int player);
+uint64_t sync_now(void);
+
+#endif /* GAME_PTPSYNC_H_ */
@@ -43,10 +43,15 @@
 #include "game.h"
 #include "queue.h"
 #include "fonts.h"
+#include "lockstep.h"
+#include "interp.h"
+#include "replay.h"
+#include "trace.h"
+#include "telemetry.h"
 
+#include "mAbassi.h"          /* MUST include "SAL.H" and not uAbassi.h        */
 #include "SysCall.h"          /* System Call layer stuff     */
 
-//#define ENALBE_TOUCH_FILTER
 #define DUAL_FRAME_BUFFER
 
 #define FR_FRAME_0  0x20000000
@@ -97,7 +102,8 @@ typedef struct{
 
 
 VIP_FRAME_READER *pReader;
-DESK_INFO *DeskInfo;
+static DESK_INFO Desk;
+DESK_INFO *DeskInfo = &Desk;
 // Lines
 IMAGE *black_up, *black_down, *black_left, *black_right;
 IMAGE *white_up, *white_down, *white_left, *white_right;
@@ -105,6 +111,18 @@ IMAGE *plyr_white, *plyr_black;
 IMAGE *back;		// Background
 IMAGE *end_white, *end_black;
 
+static RECT rcTouch;					// Drawable area, where players may be
+static uint32_t rxKnown = 0;			// Players a word was received from (one bit per id)
+static void GUI_Flipped(uint32_t start);
+#if !(GAME_LOCKSTEP)
+static INTERP smooth[GAME_PLAYERS];	// Remote player positions, only drawn
+static POINT rxPos[GAME_PLAYERS];		// Last received position of each player, used by the game rules
+static uint32_t rxMoved = 0;			// Players rxPos changed for since the last check (one bit per id)
+static POINT shown[GAME_PLAYERS];		// Where the remote players are drawn
+static uint32_t shownKnown = 0;			// Players shown is set for (one bit per id)
+static void SPI_Smooth(int id, uint32_t time, uint16_t x, uint16_t y);
+#endif
+
 
 void GUI_DeskInit( LVL *lvl){
     RectSet(&DeskInfo->rcPaint, DRAW_BORDER, pReader->width-DRAW_BORDER, DRAW_BORDER, pReader->height);
@@ -113,6 +131,7 @@ void GUI_DeskInit( LVL *lvl){
 void GUI_DeskDraw(LVL *lvl){
 	static int InitFlag = true;
 	static IMAGE *menu;
+	uint32_t start = time_us();
 	if(InitFlag){
 		menu = initimage( "menubutton.dat", 89,98);
 		InitFlag=false;
@@ -125,7 +144,7 @@ void GUI_DeskDraw(LVL *lvl){
 
     // Print level selection
     if((*flag & 0x00000008)==8){
-    	printf("GUI_DeskDraw - Print level selection\n");
+    	TRACE_INFO("GUI_DeskDraw - Print level selection\n");
     	print_lvl_selection(pReader);
     }
 
@@ -221,103 +240,81 @@ void GUI_DeskDraw(LVL *lvl){
     }
     TSKsleep(OS_MS_TO_TICK(5));
     VIPFR_ActiveDrawFrame(pReader);
+    GUI_Flipped(start);
     TSKsleep(OS_MS_TO_TICK(5));
 }
 
-bool IsContinuedPoint(POINT *ptPre, POINT *ptNew){
-    bool bYes = TRUE;
-    const int nMax = 50;
-    if (abs(ptPre->x - ptNew->x) > nMax)
-        bYes = FALSE;
-    else if (abs(ptPre->y - ptNew->y) > nMax)
-        bYes = FALSE;
-
-    return bYes;
-}
+// Frame statistics of a flip, Task_MTL2_image only: GUI() draws through GUI_Draw() (see telemetry.h)
+static void GUI_Flipped(uint32_t start){
+	uint32_t now = time_us();
 
-// Move player towards direction of touched point (X, Y) by 10px
-// (record changes in the LVL structure)
-void incrCoordinate(PLAYER *plyr, int X, int Y) {
-
-	int dist_x = (X-20)-plyr->x;
-	int dist_y = (Y-20)-plyr->y;
-
-	if (abs(dist_x) > abs(dist_y)) {
-		// Right
-		if (dist_x > 0) {
-			if(plyr->x+3<=800-40)
-				plyr->x = plyr->x+4;
-			if (dist_y > 0 && plyr->y+1<=480-40)
-				plyr->y = plyr->y+1;
-			else if(dist_y < 0 && plyr->y-1>=0)
-				plyr->y = plyr->y-1;
-		}
-		// Left
-		else {
-			if(plyr->x-3>=0)
-				plyr->x = plyr->x-4;
-			if (dist_y > 0 && plyr->y+1<=480-40)
-					plyr->y = plyr->y+1;
-				else if(dist_y < 0 && plyr->y-1>=0)
-					plyr->y = plyr->y-1;
-		}
-	}
-	// Vertical move
-	else {
-		// Down
-		if (dist_y > 0) {
-			if(plyr->y+3<=480-40)
-				plyr->y = plyr->y+4;
-			if (dist_x > 0 && plyr->x+1<=800-40)
-				plyr->x = plyr->x+1;
-			else if (dist_x < 0 && plyr->x-1>=0)
-				plyr->x = plyr->x-1;
-		}
-		// Up
-		else {
-			if(plyr->y-3>=0)
-				plyr->y = plyr->y-4;
-			if (dist_x > 0 && plyr->x+1<=800-40)
-				plyr->x = plyr->x+1;
-			else if (dist_x < 0 && plyr->x-1>=0)
-				plyr->x = plyr->x-1;
-		}
-	}
+	TELEM_Add(&gameStats.draw, now - start);
+	if (gameStats.flips != 0)
+		TELEM_Add(&gameStats.frame, now - gameStats.last_flip);
+	__atomic_store_n(&gameStats.last_flip, now, __ATOMIC_RELEASE);
+	TELEM_Count(&gameStats.flips, 1);
 }
 
 void check(LVL *lvl){
-	pos_correlator(lvl);
+	if (pos_correlator(lvl))
+		*flag = (*flag) | 0x00000002;	// Update defeat
 	if(success(lvl)){
 		*flag = (*flag) | 0x00000004;
-		printf("check - Victory detected by own player\n");
-		printf("GUI - flag = %d\n", *flag);
+		TRACE_INFO("check - Victory detected by own player\n");
+		TRACE_INFO("GUI - flag = %d\n", *flag);
 	}
 }
 
 void GUI_checkNDraw(LVL *lvl, VIP_FRAME_READER *pReader, DESK_INFO *DeskInfo) {
 	// 1. Check if player has crushed a line
 	//	 (records line changes in the LVL structure + update defeat if necessary)
-	pos_correlator(lvl);
+	if (pos_correlator(lvl))
+		*flag = (*flag) | 0x00000002;
 
 	// 2. Check if victory of both players
 	if(success(lvl)){
 		*flag = (*flag) | 0x00000004;
-		printf("GUI_checkNDraw - Victory detected by own player\n");
-		printf("GUI - flag = %d\n", *flag);
+		TRACE_INFO("GUI_checkNDraw - Victory detected by own player\n");
+		TRACE_INFO("GUI - flag = %d\n", *flag);
 	}
 
 	// 3. Redraw whole screen according to changes in the LVL structure
+	GUI_Draw(lvl);
+}
+
+// Hand the LVL structure to Task_MTL2_image and wait for the redraw
+// Task_MTL2_image only reads what it is handed: a lost or won level is reset here,
+// on the game's own LVL, once the screen showing it has been drawn
+void GUI_Draw(LVL *lvl) {
 	SEM_t    *PtrSem;
 	PtrSem = SEMopen("ImSemaphore");
 	MBX_t    *PrtMbx;
 	PrtMbx = MBXopen("ImMailbox", 1);
-
-	MBXput(PrtMbx, (intptr_t *)lvl, -1);
+	LVL      *draw = lvl;
+
+#if !(GAME_LOCKSTEP)
+	// Remote players are drawn where the smoother puts them, the rules never see it
+	static PLAYER players[GAME_PLAYERS];
+	static LVL view;
+	view = *lvl;
+	view.players = players;
+	for (int i=0; i<lvl->nbr_players; i++) {
+		players[i] = lvl->players[i];
+		if (shownKnown & (1u << i)) {
+			players[i].x = shown[i].x;
+			players[i].y = shown[i].y;
+		}
+	}
+	draw = &view;
+#endif
+	MBXput(PrtMbx, (intptr_t)draw, -1);
 
 	SEMwait(PtrSem, -1);    // -1 = Infinite blocking
 
 	SEMreset(PtrSem);
 
+	if((*flag & 0x00000006)!=0 || (*flag2 & 0x00000006)!=0)	// Lost or won
+		reset_lvl(lvl);
 }
 
 void setCoordinate(PLAYER *plyr, uint16_t X, uint16_t Y){
@@ -325,21 +322,103 @@ void setCoordinate(PLAYER *plyr, uint16_t X, uint16_t Y){
 	plyr->y = Y;
 }
 
+static uint32_t touchTime;	// Frame time of the touch being handled, 0 if played
+
+// Touch input, from the panel or from the played session, one event per GUI loop.
+// Presses and releases are taken in order (a tap is a press, then a release), the
+// driver keeps only the latest move of a finger, so a burst costs one move and one redraw.
+// A release is returned with TouchNum 0: no finger acts at X1, Y1.
+static bool GUI_GetTouch(MTC2_INFO *pTouch, alt_u8 *Event, alt_u8 *TouchNum, uint16_t *X1, uint16_t *Y1){
+	MTC2_EVENT ev;
+
+	touchTime = 0;
+	if (REPLAY_Mode() == REPLAY_PLAY)
+		return REPLAY_GetTouch(Event, TouchNum, X1, Y1);
+	if (MTC2_GetEvents(pTouch, &ev, 1) == 0)
+		return false;
+	*Event = ev.Event;
+	*TouchNum = (ev.Action == MTC2_RELEASE) ? 0 : ev.TouchNum;
+	*X1 = ev.x1;
+	*Y1 = ev.y1;
+	if (ev.Action != MTC2_RELEASE)
+		touchTime = ev.t;
+	REPLAY_Touch(*Event, *TouchNum, *X1, *Y1);
+	return true;
+}
+
+// Word sent by the SPI ISR on every transfer (single store, read by the ISR without lock)
+static void GUI_SetTxWord(uint32_t word){
+	__atomic_store_n(txdata, word, __ATOMIC_RELEASE);
+}
+
+#if (GAME_LOCKSTEP)
+// Queue a word for the SPI ISR (lvl and flag are added when it is sent)
+static void GUI_SendWord(uint32_t payload){
+	SPSC_Push(&txRing, payload & LS_WORD_PAYLOAD, 0);
+}
+
+// Queue the own inputs the other boards may have missed (they keep one per tick)
+static void GUI_Resend(LOCKSTEP *ls){
+	uint32_t words[LOCKSTEP_WINDOW];
+	int n = LOCKSTEP_Resend(ls, words);
+	for (int i=0; i<n; i++)
+		GUI_SendWord(words[i]);
+}
+
+// Exchange inputs with the other board and simulate every tick both inputs are known for
+static void GUI_Lockstep(LOCKSTEP *ls, LVL *lvl, uint8_t *pending){
+	static int nextInput = 0;
+	static int stallTime = 0;
+	static bool bStalled = false;
+	uint32_t word;
+	bool bMoved = false;
+
+	while (!QUEUE_IsEmpty(rxQueue))
+		LOCKSTEP_RemoteWord(ls, QUEUE_Pop(rxQueue));
+
+	// A new input goes with the previous ones, a lost word is in the next frame
+	if (LOCKSTEP_CanSchedule(ls) && OS_HAS_TIMEDOUT(nextInput)) {
+		LOCKSTEP_LocalInput(ls, *pending);
+		GUI_Resend(ls);
+		*pending = MOVE_NONE;
+		nextInput = OS_TICK_EXP(OS_MS_TO_TICK(LOCKSTEP_TICK_MS));
+	}
+
+	while (LOCKSTEP_Ready(ls)) {
+		if (LOCKSTEP_Step(ls, lvl, &word))
+			GUI_SendWord(word);
+		bMoved = true;
+	}
+	if (bMoved) {
+		GUI_Draw(lvl);
+		stallTime = OS_TICK_EXP(OS_MS_TO_TICK(LOCKSTEP_STALL_MS));
+		bStalled = false;
+	}
+	// Both boards wait for an input: send ours again until the other board has it
+	else if (OS_HAS_TIMEDOUT(stallTime)) {
+		if (!bStalled) {
+			ls->stalls++;
+			TRACE_WARN("GUI - Lockstep stalled at tick %u, inputs sent again\n", ls->tick);
+		}
+		bStalled = true;
+		GUI_Resend(ls);
+		stallTime = OS_TICK_EXP(OS_MS_TO_TICK(LOCKSTEP_STALL_MS));
+	}
+}
+#endif
+
 
 void GUI(MTC2_INFO *pTouch){
     // video
 	bool GO=true;
     static int InitFlag = true;
     LVL lvl;
-    lvl.players = (PLAYER *)malloc(4*sizeof(PLAYER));
+    lvl.players = (PLAYER *)malloc(GAME_PLAYERS*sizeof(PLAYER));
     lvl.lines = (LINE *)malloc(10*sizeof(LINE));
     static uint16_t X1, Y1;
-    static uint16_t XR = 1;
-    static uint16_t YR = 1;
-    static POINT Pt1, PtR;
+    static POINT Pt1;
     static alt_u8 Event, TouchNum;
     static const int nDotSize = DOT_SIZE;
-    static RECT rcTouch;
 	static RECT rcMenu;//added
 	static RECT rcPlay1;//added
 	static RECT rcLevel1,rcLevel2;//added
@@ -354,8 +433,9 @@ void GUI(MTC2_INFO *pTouch){
         #endif // DUAL_FRAME_BUFFER
         VIPFR_Go(pReader, TRUE);
 
+        init_im_lvl(1);		// Images must be loaded before the first draw
         GUI_DeskInit(&lvl); // Sets the infos inside the DESK_INFO structure (rcPaint)
-        GUI_DeskDraw(&lvl); // Draws the drawable area
+        GUI_Draw(&lvl); // Draws the drawable area
 
         DESK_INFO pDeskInfo=*DeskInfo;
         RectCopy(&rcTouch, &pDeskInfo.rcPaint);
@@ -370,7 +450,6 @@ void GUI(MTC2_INFO *pTouch){
 		RectSet(&rcReset2, 225, 554,186,236);
 		RectSet(&rcLevel2, 225, 554,277,328);
 
-		init_im_lvl(1);
         InitFlag = false;
     }
 
@@ -378,51 +457,71 @@ void GUI(MTC2_INFO *pTouch){
     int static prevflag2=0;
     int static prevlvl2=0;
     int var=0;
+    static bool running = false;			// All players in game
+#if (GAME_LOCKSTEP)
+    static LOCKSTEP ls;
+    static uint8_t pending = MOVE_NONE;		// Last own input, sent on the next tick
+#else
+    int XI, YI;
+#endif
     // While game hasn't ended
     while (GO)
     {
+    	// Words of the other boards, in order (from the file when a session is played)
+    	uint32_t word, time;
+    	REPLAY_Poll();
+    	if (REPLAY_Mode() == REPLAY_PLAY) {
+    		while (REPLAY_GetWord(&word, &time))
+    			SPI_PutWord(word, time);
+    	}
+    	else {
+    		while (SPSC_Pop(&rxRing, &word, &time))
+    			SPI_PutWord(word, time);
+    	}
+
     	//printf("GUI - flag = %d, flag2 = %d\n", *flag, *flag2);
     	if(*flag!=prevflag || *flag2!=prevflag2){
     		if (*flag!=prevflag){
-    			printf("GUI - Own player changed state from %d to %d\n", prevflag, *flag);
+    			TRACE_INFO("GUI - Own player changed state from %d to %d\n", prevflag, *flag);
     		}
     		else if (*flag2!=prevflag2){
-    			printf("GUI - Other player changed state from %d to %d\n", prevflag2, *flag2);
+    			TRACE_INFO("GUI - Other player changed state from %d to %d\n", prevflag2, *flag2);
     		}
-    		GUI_DeskDraw(&lvl);
+    		GUI_Draw(&lvl);
     		prevflag=*flag;
     		prevflag2=*flag2;
 
     	}
     	if( *lvl2!=prevlvl2 ){
-    		printf("GUI - Other player changed level from %d to %d\n", prevlvl2, *lvl2);
+    		TRACE_INFO("GUI - Other player changed level from %d to %d\n", prevlvl2, *lvl2);
     		*lvl1=*lvl2;
     		if(*lvl1!=0){
     			change_lvl(&lvl,*lvl1);
     			init_im_lvl(*lvl1);
-    			printf("GUI - Changed lvl\n");
+    			TRACE_INFO("GUI - Changed lvl\n");
     		}
     		if((*flag & 0x00000008)==8){
-    			printf("GUI - Put own flag from 8 to 0\n");
+    			TRACE_INFO("GUI - Put own flag from 8 to 0\n");
     			*flag=0;
-    			printf("GUI - flag = %d\n", *flag);
+    			TRACE_INFO("GUI - flag = %d\n", *flag);
     		}
-			GUI_DeskDraw(&lvl);
+			GUI_Draw(&lvl);
 			prevlvl2=*lvl2;
 		}
 
-    	// When touch event, moves the player 1 towards the touched position
-    	if (MTC2_GetStatus(pTouch, &Event, &TouchNum, &X1, &Y1))
+    	// When touch event, moves the player 1 towards the touched position.
+    	// A release (TouchNum 0) is taken but acts on nothing, every action is on a press or a move.
+    	if (GUI_GetTouch(pTouch, &Event, &TouchNum, &X1, &Y1) && TouchNum >= 1)
         {
             PtSet(&Pt1, X1, Y1);
 
         	// Inside level selection menu
             if((*flag & 0x00000008)==8){
-            	printf("GUI: in lvl selection\n");
+            	TRACE_INFO("GUI: in lvl selection\n");
             	in_lvl_sel_rect(&Pt1, &lvl, pReader);		// Change current level in LVL structure
-				GUI_DeskDraw(&lvl);	// Draw accordingly
+				GUI_Draw(&lvl);	// Draw accordingly
 				*flag=*flag & 0xFFFFFFF8;	// Reset the three right flags
-				printf("GUI: flag = %d\n", *flag);
+				TRACE_INFO("GUI: flag = %d\n", *flag);
 
             }
             // Inside game
@@ -431,101 +530,151 @@ void GUI(MTC2_INFO *pTouch){
             	if (TouchNum >= 1 && IsPtInRect(&Pt1, &rcMenu))
 				{
 					*flag=(*flag) | 0x00000001;	// flag = 1
-					printf("GUI: Touch event Menu Open \n");
-					printf("GUI: flag = %d\n", *flag);
-					GUI_DeskDraw(&lvl);	// Draw accordingly
+					TRACE_INFO("GUI: Touch event Menu Open \n");
+					TRACE_INFO("GUI: flag = %d\n", *flag);
+					GUI_Draw(&lvl);	// Draw accordingly
 				}
             	//if not in break
 				else if(*flag==0 && *flag2==0){
 					if (TouchNum >= 1 && IsPtInRect(&Pt1, &rcTouch))
 					{
-						PLAYER *ownPlyr = (&lvl)->players+1;	// Resp players+1 for other board
-
+						PLAYER *ownPlyr = (&lvl)->players+OWN_PLAYER;
+#if (GAME_LOCKSTEP)
+						pending = move_code(ownPlyr, X1, Y1);		// Simulated on both boards later
+#else
 						incrCoordinate(ownPlyr, X1, Y1);			// Move own player
-						GUI_checkNDraw(&lvl, pReader, &DeskInfo);	// Draw accordingly
+						GUI_checkNDraw(&lvl, pReader, DeskInfo);	// Draw accordingly
 
 						// Coordinate of our own player after touch event has been treated
 						uint32_t XS = ownPlyr->x;
 						uint32_t YS = ownPlyr->y;
 
-						MTX_t	*TMtx = MTXopen("TXData Mtx");
-						MTXlock(TMtx, -1);
-
-						*txdata =  (*lvl1<<28)|(*flag<<24) | (XS << 12) | YS;	// Warn other player
-
-						MTXunlock(TMtx);
+						GUI_SetTxWord((*lvl1<<28)|(*flag<<24) | WORD_OWN | WORD_POS(XS, YS));	// Warn other players
+#endif
 					}
 				}
 				else{
 					//if lost or win
 					if((*flag & 0x00000002)==2 || (*flag2 & 0x00000002)==2 || (*flag & 0x00000004)==4 || (*flag2 & 0x00000004)==4){
-						printf("GUI - Win or loss detected by one of players \n");
+						TRACE_INFO("GUI - Win or loss detected by one of players \n");
 						if(TouchNum >= 1 && IsPtInRect(&Pt1, &rcLevel2)){
-							printf("GUI - LEVEL selected in the menu\n");
+							TRACE_INFO("GUI - LEVEL selected in the menu\n");
 							*flag=*flag | 0x00000008;
 							*flag=*flag & 0xFFFFFFF8;	// Reset the three right flags
-							printf("GUI - flag = %d\n", *flag);
-							GUI_DeskDraw(&lvl);	// Draw accordingly
+							TRACE_INFO("GUI - flag = %d\n", *flag);
+							GUI_Draw(&lvl);	// Draw accordingly
 						    TSKsleep(OS_MS_TO_TICK(200));
 						}
 						else if(TouchNum >= 1 && IsPtInRect(&Pt1, &rcReset2)){
-							printf("GUI - RESET selected in the menu\n");
+							TRACE_INFO("GUI - RESET selected in the menu\n");
 							reset_lvl(&lvl);
-							GUI_DeskDraw(&lvl);	// Draw accordingly
+							GUI_Draw(&lvl);	// Draw accordingly
 							*flag=*flag & 0xFFFFFFF0;	// Reset the four right flags
-							printf("GUI - flag = %d\n", *flag);
+							TRACE_INFO("GUI - flag = %d\n", *flag);
 							TSKsleep(OS_MS_TO_TICK(200));
 						}
 
 					}
 					else{
-						printf("GUI - flag %d flag2 %d\n",*flag,*flag2);
+						TRACE_DEBUG("GUI - flag %d flag2 %d\n",*flag,*flag2);
 						if((*flag & 0x00000001)==1){
 							if(TouchNum >= 1 && IsPtInRect(&Pt1, &rcLevel1)){
-								printf("GUI - LEVEL selected in the menu\n");
+								TRACE_INFO("GUI - LEVEL selected in the menu\n");
 								*flag=*flag | 0x00000008;
 								*flag=*flag & 0xFFFFFFF8;	// Reset the three right flags
-								printf("GUI - flag = %d\n", *flag);
-								GUI_DeskDraw(&lvl);	// Draw accordingly
+								TRACE_INFO("GUI - flag = %d\n", *flag);
+								GUI_Draw(&lvl);	// Draw accordingly
 								TSKsleep(OS_MS_TO_TICK(200));
 							}
 							else if(TouchNum >= 1 && IsPtInRect(&Pt1, &rcReset1)){
-								printf("GUI - RESET selected in the menu\n");
+								TRACE_INFO("GUI - RESET selected in the menu\n");
 								reset_lvl(&lvl);
-								GUI_DeskDraw(&lvl);	// Draw accordingly
+								GUI_Draw(&lvl);	// Draw accordingly
 								*flag=*flag & 0xFFFFFFF0;	// Reset the four right flags
-								printf("GUI - flag = %d\n", *flag);
+								TRACE_INFO("GUI - flag = %d\n", *flag);
 								TSKsleep(OS_MS_TO_TICK(200));
 							}
 							else if(TouchNum >= 1 && IsPtInRect(&Pt1, &rcPlay1) && (*flag & 0x00000001)==1){
-								printf("GUI - PLAY selected in the menu\n");
-								GUI_DeskDraw(&lvl);	// Draw accordingly
+								TRACE_INFO("GUI - PLAY selected in the menu\n");
+								GUI_Draw(&lvl);	// Draw accordingly
 								*flag=*flag & 0xFFFFFFF0;	// Reset the four right flags
-								printf("GUI - flag = %d\n", *flag);
+								TRACE_INFO("GUI - flag = %d\n", *flag);
 								TSKsleep(OS_MS_TO_TICK(200));
 							}
 						}
 					}
 				}
-    		MTC2_ClearEvent(pTouch);
+    		if (touchTime != 0) {	// Touch handled and drawn: latency the touch filter extrapolates by
+    			MTC2_Latency(pTouch, time_us() - touchTime);
+    			uint32_t flip = __atomic_load_n(&gameStats.last_flip, __ATOMIC_ACQUIRE);
+    			if ((int32_t) (flip - touchTime) >= 0)		// Not when the touch did not redraw
+    				TELEM_Add(&gameStats.touch, flip - touchTime);
+    		}
             }
 
         }
-        // When SPI event (i.e. received msg from other board)
-    	// Moves the player 2 towards the touched position
+#if (GAME_LOCKSTEP)
+    	// All boards restart the tick count when the game (re)starts
+    	if(*flag==0 && *flag2==0){
+    		if (!running) {
+    			LOCKSTEP_Init(&ls, LOCKSTEP_INPUT_DELAY, OWN_PLAYER);
+    			pending = MOVE_NONE;
+    			running = true;
+    		}
+    		GUI_Lockstep(&ls, &lvl, &pending);
+    	}
+    	else
+    		running = false;
+#else
+        // When SPI event (i.e. received msg from other boards)
+    	// The other players are checked at their received position and drawn moving
+    	// towards it, one sample interval behind
     	if(*flag==0 && *flag2==0){
-    		if(SPI_GetStatus(&XR, &YR)){
-    			PtSet(&PtR, XR, YR);
-    			if (IsPtInRect(&PtR, &rcTouch)){
-    				PLAYER *otherPlyr = (&lvl)->players;	// Resp players for other board
-    				setCoordinate(otherPlyr, XR, YR);
-    				GUI_checkNDraw(&lvl, pReader, &DeskInfo);
+    		if (!running) {
+    			// Start again from the last known positions
+    			shownKnown = 0;
+    			for (int i=0; i<GAME_PLAYERS; i++){
+    				INTERP_Init(smooth+i);
+    				if (rxKnown & (1u << i))
+    					SPI_Smooth(i, lastMsg[i].time, lastMsg[i].xcoord, lastMsg[i].ycoord);
     			}
+    			running = true;
     		}
+    		uint32_t now = REPLAY_Time();
+    		bool bMoved = false;
+    		for (int i=0; i<lvl.nbr_players; i++){
+    			if (i == OWN_PLAYER)
+    				continue;
+    			PLAYER *otherPlyr = (&lvl)->players+i;
+    			uint32_t bit = 1u << i;
+    			if (rxMoved & bit)
+    				setCoordinate(otherPlyr, rxPos[i].x, rxPos[i].y);
+    			if (INTERP_Sample(smooth+i, now, &XI, &YI) && (!(shownKnown & bit) || XI != shown[i].x || YI != shown[i].y)){
+    				PtSet(shown+i, XI, YI);
+    				shownKnown |= bit;
+    				bMoved = true;
+    			}
+    		}
+    		// One check for every player received and one redraw for every player moved in this loop
+    		if (rxMoved) {
+    			rxMoved = 0;
+    			GUI_checkNDraw(&lvl, pReader, DeskInfo);
+    		}
+    		else if (bMoved)
+    			GUI_Draw(&lvl);
+    	}
+    	else {
+    		running = false;
+    		shownKnown = 0;			// Drawn where the rules see them until the restart
     	}
+#endif
 
-    	uint32_t pad = (uint32_t) 0xFFFFFF;
-    	*txdata =  ( (*lvl1<<28) | (*flag<<24) ) | (*txdata & pad); // Warn other player
+    	uint32_t pad = (uint32_t) 0xFFFFF;
+    	GUI_SetTxWord(( (*lvl1<<28) | (*flag<<24) ) | WORD_OWN | (*txdata & pad)); // Warn other players
+
+    	REPLAY_Flag(*flag);
+    	if (REPLAY_Done())
+    		GO = false;
 
     }
 
@@ -544,54 +693,54 @@ void in_lvl_sel_rect(POINT* Pt1, LVL* lvl ,VIP_FRAME_READER *pReader ){
 	new_lvl=1;
 	if (IsPtInRect(Pt1, &rcLevel1))
 	{
-		printf("in_lvl_sel_rect - Touch event lvl 1 selected \n");
+		TRACE_INFO("in_lvl_sel_rect - Touch event lvl 1 selected \n");
 		*flag=*flag & 0xFFFFFFF0;//reset the four right flags
-		printf("GUI - flag = %d\n", *flag);
+		TRACE_INFO("GUI - flag = %d\n", *flag);
 		change_lvl(lvl,1);
 		init_im_lvl(1);
 		*lvl1=1;
 	}
 	if (IsPtInRect(Pt1, &rcLevel2))
 		{
-			printf("in_lvl_sel_rect - Touch event lvl 2 selected \n");
+			TRACE_INFO("in_lvl_sel_rect - Touch event lvl 2 selected \n");
 			*flag=*flag & 0xFFFFFFF0;//reset the four right flags
-			printf("GUI - flag = %d\n", *flag);
+			TRACE_INFO("GUI - flag = %d\n", *flag);
 			change_lvl(lvl,2);
 			init_im_lvl(2);
 			*lvl1=2;
 		}
 	if (IsPtInRect(Pt1, &rcLevel3))
 		{
-			printf("in_lvl_sel_rect - Touch event lvl 3 selected \n");
+			TRACE_INFO("in_lvl_sel_rect - Touch event lvl 3 selected \n");
 			*flag=*flag & 0xFFFFFFF0;//reset the four right flags
-			printf("GUI - flag = %d\n", *flag);
+			TRACE_INFO("GUI - flag = %d\n", *flag);
 			change_lvl(lvl,3);
 			init_im_lvl(3);
 			*lvl1=3;
 		}
 	if (IsPtInRect(Pt1, &rcLevel4))
 		{
-			printf("in_lvl_sel_rect - Touch event lvl 4 selected \n");
+			TRACE_INFO("in_lvl_sel_rect - Touch event lvl 4 selected \n");
 			*flag=*flag & 0xFFFFFFF0;//reset the four right flags
-			printf("GUI - flag = %d\n", *flag);
+			TRACE_INFO("GUI - flag = %d\n", *flag);
 			change_lvl(lvl,4);
 			init_im_lvl(4);
 			*lvl1=4;
 		}
 	if (IsPtInRect(Pt1, &rcLevel5))
 		{
-			printf("in_lvl_sel_rect - Touch event lvl 5 selected \n");
+			TRACE_INFO("in_lvl_sel_rect - Touch event lvl 5 selected \n");
 			*flag=*flag & 0xFFFFFFF0;//reset the four right flags
-			printf("GUI - flag = %d\n", *flag);
+			TRACE_INFO("GUI - flag = %d\n", *flag);
 			change_lvl(lvl,5);
 			init_im_lvl(5);
 			*lvl1=5;
 		}
 	if (IsPtInRect(Pt1, &rcLevel6))
 		{
-			printf("in_lvl_sel_rect - Touch event lvl 6 selected \n");
+			TRACE_INFO("in_lvl_sel_rect - Touch event lvl 6 selected \n");
 			*flag=*flag & 0xFFFFFFF0;//reset the four right flags
-			printf("GUI - flag = %d\n", *flag);
+			TRACE_INFO("GUI - flag = %d\n", *flag);
 			change_lvl(lvl,6);
 			init_im_lvl(6);
 			*lvl1=6;
@@ -834,29 +983,83 @@ void init_im_lvl(int lvl){
 
 	}
 }
-// Mutex-handled access to lastMsg (returns true if other player position has changed)
-bool SPI_GetStatus(uint16_t *XR, uint16_t *YR){
-	bool bChange = false;
-
-	static uint16_t prevX = 0;
-	static uint16_t prevY = 0;
-	static int prevFlag = 0;
-
-	MTX_t *RMtx = MTXopen("RXData Mtx");
-	MTXlock(RMtx, -1);
-
-	if ((lastMsg->xcoord!=prevX)|(lastMsg->ycoord!=prevY)|*flag!=prevFlag) {
-		*XR = lastMsg->xcoord;
-		*YR = lastMsg->ycoord;
-		prevX = *XR;
-		prevY = *YR;
-		prevFlag=*flag;
-		bChange = true;
-	}
-
-	MTXunlock(RMtx);
+bool validData(uint32_t data){
+	int flag = (data>>24)&0x000F;
+	bool validFlag = (flag==1 || flag==2 || flag==4 || flag==8 || flag==0);
+	bool validId = (WORD_ID(data) < GAME_PLAYERS);
+#if (GAME_LOCKSTEP)
+	// Lower bits carry an input or a state hash, checked by lockstep.c
+	return validFlag && validId;
+#else
+	uint16_t xcoord = WORD_X(data);
+	uint16_t ycoord = WORD_Y(data);
+	bool validCoord = (xcoord <= 800 && ycoord <= 480);
+
+	return validCoord && validFlag && validId;
+#endif
+}
 
-	return bChange;
+#if !(GAME_LOCKSTEP)
+// Keep a received position of player id for the rules and the smoother (dropped if off the drawable area)
+static void SPI_Smooth(int id, uint32_t time, uint16_t x, uint16_t y){
+	POINT Pt;
+	PtSet(&Pt, x, y);
+	if (IsPtInRect(&Pt, &rcTouch)) {
+		INTERP_Push(smooth+id, time, x, y);
+		rxPos[id] = Pt;
+		rxMoved |= 1u << id;
+	}
+}
+#endif
+
+// Decode a word of another board, received at time (us), in the game task
+void SPI_PutWord(uint32_t rxdata, uint32_t time){
+	REPLAY_SpiWord(rxdata, time);
+
+	if (!validData(rxdata))
+		return;
+
+	int id = WORD_ID(rxdata);
+	uint32_t bit = 1u << id;
+	SPI_EVENT *msg = lastMsg+id;
+	// Own word back from the ring, or nothing new from this player
+	if (id == OWN_PLAYER || ((rxKnown & bit) && msg->word == rxdata))
+		return;
+#if (GAME_PLAYERS > 2)
+	if (REPLAY_Mode() != REPLAY_PLAY)
+		SPSC_Push(&fwdRing, rxdata, time);	// Pass it on to the next board
+#endif
+
+	// Convert received msg into SPI_EVENT structure
+	TRACE_DEBUG("SPI_PutWord - Valid Data from player %d\n", id);
+	if ((int) (rxdata>>28) != msg->lvl)
+		*lvl2=rxdata>>28;
+	msg->word = rxdata;
+	msg->flag = (rxdata>>24)&0xF;
+	msg->lvl = rxdata>>28;
+	rxKnown |= bit;
+
+	// Other players' flags merged: anyone in break, lost or won stops the game
+	*flag2 = 0;
+	for (int i=0; i<GAME_PLAYERS; i++) {
+		if (rxKnown & (1u << i))
+			*flag2 |= lastMsg[i].flag;
+	}
+	TRACE_DEBUG("lvl2 :%d\n",*lvl2);
+#if (GAME_LOCKSTEP)
+	// Every input is needed, keep them all for the game task
+	if(!QUEUE_IsFull(rxQueue))
+		QUEUE_Push(rxQueue, rxdata & LS_WORD_PAYLOAD);
+#else
+	// Every position is buffered, none is overwritten before it is drawn
+	if(*flag2==0 && *flag==0){
+		msg->xcoord = WORD_X(rxdata);
+		msg->ycoord = WORD_Y(rxdata);
+		msg->time = time;
+		SPI_Smooth(id, time, msg->xcoord, msg->ycoord);
+	}
+#endif
+	TRACE_DEBUG("SPI_PutWord - flag = %d, flag2 = %d\n", *flag, *flag2);
 }
 
 void print_lvl_selection(VIP_FRAME_READER *pReader ){
@@ -880,28 +1083,26 @@ void print_selection_menu(RECT rc,VIP_FRAME_READER *pReader, LVL *lvl){
 		InitFlag=false;
 	}
 	if((*flag2 & 0x00000001)==1  ){
-			printf("print_selection_menu -  Draw waiting for other player case\n");
+			TRACE_INFO("print_selection_menu -  Draw waiting for other player case\n");
 			displayimage(wait, 174, 79, pReader);
 	}
 
 	if((*flag & 0x00000001)==1){
-		printf("print_selection_menu - Draw break case case\n");
+		TRACE_INFO("print_selection_menu - Draw break case case\n");
 		displayimage(menu,  174, 79, pReader);
 	}
 
 
 
 	if((*flag & 0x00000002)==2 || (*flag2 & 0x00000002)==2){
-		printf("print_selection_menu - Draw lost case\n");
+		TRACE_INFO("print_selection_menu - Draw lost case\n");
 		displayimage(lost, 174, 79, pReader);
-		reset_lvl(lvl);
 	    TSKsleep(OS_MS_TO_TICK(200));
 	}
 
 	if((*flag & 0x00000004)==4 || (*flag2 & 0x00000004)==4){
-		printf("print_selection_menu - Draw win case\n");
+		TRACE_INFO("print_selection_menu - Draw win case\n");
 		displayimage(win, 174, 79, pReader);
-		reset_lvl(lvl);
 	    TSKsleep(OS_MS_TO_TICK(200));
 
 	}
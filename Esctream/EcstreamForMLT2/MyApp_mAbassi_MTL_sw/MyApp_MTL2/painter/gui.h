@@ -8,29 +8,52 @@
 #include "queue.h"
 #include "Const.h"
 #include "geometry.h"
+#include "spsc.h"
 
 void GUI(MTC2_INFO *pTouch);
-bool SPI_GetStatus(uint16_t *XR, uint16_t *YR);//added
+bool validData(uint32_t data);
+void SPI_PutWord(uint32_t rxdata, uint32_t time);
 void print_selection_menu(RECT rc,VIP_FRAME_READER *pReader, LVL *lvl);
 void print_lvl_selection(VIP_FRAME_READER *pReader );
 void init_im_lvl(int lvl);
 void in_lvl_sel_rect(POINT* Pt1, LVL* lvl ,VIP_FRAME_READER *pReader );
-void GUI_DeskDraw(LVL *lvl);
+void GUI_DeskDraw(LVL *lvl);			// Task_MTL2_image only, the others call GUI_Draw()
+void GUI_Draw(LVL *lvl);
 void level(int lvl_number, LVL *lvl);
 
+// Structure of SPI_RXDATA / SPI_TXDATA (see lockstep.h when GAME_LOCKSTEP),
+// carried in frames (see frame.h):
+// bits [28:31]		level
+// bits [24:27]		flag
+// bits [20:23]		player id of the sender (WORD_ID)
+// bits [10:19]		x coordinate of player
+// bits [0 : 9]		y coordinate of player
+#define WORD_X(w)		(((w) >> 10) & 0x3FF)
+#define WORD_Y(w)		((w) & 0x3FF)
+#define WORD_POS(x, y)	((((uint32_t) (x) & 0x3FF) << 10) | ((uint32_t) (y) & 0x3FF))
+#define WORD_OWN		(((uint32_t) OWN_PLAYER << WORD_ID_SHIFT))
+
 // ***ADDED
 typedef struct{
     uint16_t xcoord;
     uint16_t ycoord;
+    uint32_t time;		// Reception time (us)
+    uint32_t word;		// Last word received from this player
+    int      flag;
+    int      lvl;
 }SPI_EVENT;
 
 extern uint32_t *txdata;
-extern SPI_EVENT *lastMsg;
+extern SPI_EVENT *lastMsg;		// One per player id
 extern int *flag;
 extern int *flag2;
 extern int *lvl1;
 extern int *lvl2;
 extern int new_lvl;
+extern QUEUE_STRUCT *rxQueue;	// Lockstep words received from the other boards (game task only)
+extern SPSC_RING rxRing;		// SPI ISR -> game task: words received
+extern SPSC_RING txRing;		// Game task -> SPI ISR: lockstep words to send
+extern SPSC_RING fwdRing;		// Game task -> SPI ISR: words to pass on in a ring of boards
 
 // ***ADDED
 #define MSG_QUEUE_SIZE		32
@@ -31,6 +31,7 @@
 // --------------------------------------------------------------------
 #include "terasic_includes.h"
 #include "I2C.h"
+#include "I2C_core.h"
 
 // Note. Remember to reset device befroe acceess I2C interface
 #ifdef DEBUG_I2C
@@ -491,3 +492,178 @@ bool  OC_I2CL_Read(alt_32 i2c_base,alt_u8 device_address,int sub_address, alt_u8
 }
 
 
+// Interrupt driven transfers
+
+// Control (2), command (4 write) and status (4 read) register bits of the OpenCores I2C master
+#define OC_CTR_EN       0x80
+#define OC_CTR_IEN      0x40
+#define OC_CR_STA       0x80
+#define OC_CR_STO       0x40
+#define OC_CR_RD        0x20
+#define OC_CR_WR        0x10
+#define OC_CR_ACK       0x08    // NACK the byte read (last one)
+#define OC_CR_IACK      0x01
+#define OC_SR_RXACK     0x80    // no ACK from the device
+#define OC_SR_AL        0x20
+
+// Step of a transfer the next interrupt completes
+enum { XFER_ADDR_W, XFER_SUB, XFER_ADDR_R, XFER_WRITE, XFER_READ, XFER_STOP };
+
+// The submitting tasks are serialized by mtx. Whoever sets busy (a task in
+// kick(), then the ISR) owns the bus and is the only one to take from the queue.
+static struct{
+    alt_32     base;
+    MTX_t     *mtx;
+    I2C_XFER  *queue[I2C_XFER_QUEUE];
+    alt_u32    head;            // next slot to fill, submitters
+    alt_u32    tail;            // next transfer to start, owner of the bus
+    alt_u32    busy;
+    I2C_XFER  *cur;             // transfer on the bus
+}oc;
+
+void OC_I2C_AsyncInit(alt_32 i2c_base){
+    memset(&oc, 0, sizeof(oc));
+    oc.base = i2c_base;
+    oc.mtx = MTXopen("I2C Mtx");
+    IOWR(i2c_base, 2, OC_CTR_EN|OC_CTR_IEN);
+}
+
+static void next(void);
+
+static void finish(I2C_XFER *x, int status){
+    __atomic_store_n(&x->status, status, __ATOMIC_RELEASE);
+    if (x->done != NULL)
+        x->done(x);
+    if (x->pSem != NULL)
+        SEMpost(x->pSem);
+    next();
+}
+
+// Start the next queued transfer, or release the bus (owner of the bus only)
+static void next(void){
+    alt_u32 idle;
+    for(;;){
+        if (oc.tail != __atomic_load_n(&oc.head, __ATOMIC_ACQUIRE)){
+            oc.cur = oc.queue[oc.tail & (I2C_XFER_QUEUE-1)];
+            __atomic_store_n(&oc.tail, oc.tail+1, __ATOMIC_RELEASE);
+            oc.cur->state = XFER_ADDR_W;
+            __sync_synchronize();   // the ISR may run on the other core
+            IOWR(oc.base, 3, oc.cur->device_address);
+            IOWR(oc.base, 4, OC_CR_STA|OC_CR_WR|OC_CR_IACK);
+            return;
+        }
+        oc.cur = NULL;
+        __atomic_store_n(&oc.busy, 0, __ATOMIC_RELEASE);
+        // A transfer queued while the bus was being released must not wait forever
+        idle = 0;
+        if (oc.tail == __atomic_load_n(&oc.head, __ATOMIC_ACQUIRE) ||
+            !__atomic_compare_exchange_n(&oc.busy, &idle, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+bool OC_I2C_Submit(I2C_XFER *pXfer){
+    alt_u32 idle = 0;
+
+    if (pXfer->nLength < 1)      // the stop is sent with the last byte
+        return FALSE;
+    pXfer->index = 0;
+    pXfer->status = I2C_XFER_PENDING;
+
+    MTXlock(oc.mtx, -1);
+    if (oc.head - __atomic_load_n(&oc.tail, __ATOMIC_ACQUIRE) >= I2C_XFER_QUEUE){
+        MTXunlock(oc.mtx);
+        return FALSE;
+    }
+    oc.queue[oc.head & (I2C_XFER_QUEUE-1)] = pXfer;
+    __atomic_store_n(&oc.head, oc.head+1, __ATOMIC_RELEASE);
+    MTXunlock(oc.mtx);
+
+    if (__atomic_compare_exchange_n(&oc.busy, &idle, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        next();
+    return TRUE;
+}
+
+// Abort the transfer on the bus when its interrupt did not come: the core is
+// disabled and enabled again, the transfer ends with I2C_XFER_ERROR and the
+// queued ones go on (task only, see Task_Touch)
+void OC_I2C_Reset(void){
+    I2C_XFER *x;
+
+    IOWR(oc.base, 2, 0);                // no interrupt while the bus changes hands
+    x = oc.cur;
+    IOWR(oc.base, 2, OC_CTR_EN|OC_CTR_IEN);
+    if (x != NULL)
+        finish(x, I2C_XFER_ERROR);
+}
+
+static void write_byte(I2C_XFER *x){
+    IOWR(oc.base, 3, x->pData[x->index]);
+    IOWR(oc.base, 4, OC_CR_WR|OC_CR_IACK|((x->index+1 == x->nLength)?OC_CR_STO:0));
+}
+
+static void read_byte(I2C_XFER *x){
+    IOWR(oc.base, 4, OC_CR_RD|OC_CR_IACK|((x->index+1 == x->nLength)?(OC_CR_ACK|OC_CR_STO):0));
+}
+
+// I2C core interrupt: a byte (and the stop condition after the last one) is done
+void OC_I2C_Interrupt(void){
+    I2C_XFER *x = oc.cur;
+    alt_32 status = IORD(oc.base, 4);
+
+    if (x == NULL){
+        IOWR(oc.base, 4, OC_CR_IACK);
+        return;
+    }
+    if (x->state == XFER_STOP){
+        // stop of a failed transfer done, the bus is free for the next one
+        IOWR(oc.base, 4, OC_CR_IACK);
+        finish(x, I2C_XFER_ERROR);
+        return;
+    }
+    if ((status & OC_SR_AL) || (x->state != XFER_READ && (status & OC_SR_RXACK))){
+        IOWR(oc.base, 4, OC_CR_STO|OC_CR_IACK);
+        x->state = XFER_STOP;
+        return;
+    }
+
+    switch(x->state){
+    case XFER_ADDR_W:
+        IOWR(oc.base, 3, x->sub_address);
+        IOWR(oc.base, 4, OC_CR_WR|OC_CR_IACK);
+        x->state = XFER_SUB;
+        break;
+    case XFER_SUB:
+        if (x->bRead){
+            IOWR(oc.base, 3, x->device_address|0x01);
+            IOWR(oc.base, 4, OC_CR_STA|OC_CR_WR|OC_CR_IACK);
+            x->state = XFER_ADDR_R;
+        }
+        else{
+            write_byte(x);
+            x->state = XFER_WRITE;
+        }
+        break;
+    case XFER_ADDR_R:
+        read_byte(x);
+        x->state = XFER_READ;
+        break;
+    case XFER_WRITE:
+        if (++x->index < x->nLength)
+            write_byte(x);
+        else{
+            IOWR(oc.base, 4, OC_CR_IACK);
+            finish(x, I2C_XFER_OK);
+        }
+        break;
+    case XFER_READ:
+        x->pData[x->index] = IORD(oc.base, 3) & 0xff;
+        if (++x->index < x->nLength)
+            read_byte(x);
+        else{
+            IOWR(oc.base, 4, OC_CR_IACK);
+            finish(x, I2C_XFER_OK);
+        }
+        break;
+    }
+}
@@ -9,6 +9,7 @@
 #define I2C_OCRE_H_
 
 #include "terasic_includes.h"
+#include "mAbassi.h"
 
 
 bool  oc_i2c_init(alt_32 i2c_base);
@@ -20,4 +21,34 @@ bool  OC_I2C_Read(alt_32 i2c_base,alt_u8 device_address,alt_u8 sub_address, alt_
 bool  OC_I2CL_Write(alt_32 i2c_base,alt_u8 device_address,int sub_address,alt_u8 *pData, int nWriteLength);
 bool  OC_I2CL_Read(alt_32 i2c_base,alt_u8 device_address,int sub_address, alt_u8 *pData8);
 
+// Interrupt driven transfers: OC_I2C_Submit() queues a transfer and returns at once,
+// the I2C core interrupt (OC_I2C_Interrupt) moves it on byte by byte.
+// The polling functions above must not be used once OC_I2C_AsyncInit() is called.
+#define I2C_XFER_QUEUE      8       // transfers waiting for the bus (power of 2)
+#define I2C_XFER_TIMEOUT_MS 20      // far longer than a touch frame at 400 kHz, then OC_I2C_Reset()
+
+#define I2C_XFER_PENDING    0
+#define I2C_XFER_OK         1
+#define I2C_XFER_ERROR      2       // no ACK from the device or arbitration lost
+
+typedef struct I2C_XFER{
+    alt_u8  device_address;
+    alt_u8  sub_address;
+    bool    bRead;                  // read nLength bytes from sub_address, else write them
+    alt_u8 *pData;
+    int     nLength;                // 1 at least
+    SEM_t  *pSem;                   // posted when done, may be NULL
+    void  (*done)(struct I2C_XFER *pXfer);  // called by the ISR when done, may be NULL
+    void   *context;
+    // Set by the engine
+    int     state;
+    int     index;
+    int     status;                 // I2C_XFER_xxx
+}I2C_XFER;
+
+void  OC_I2C_AsyncInit(alt_32 i2c_base);
+bool  OC_I2C_Submit(I2C_XFER *pXfer);
+void  OC_I2C_Interrupt(void);
+void  OC_I2C_Reset(void);
+
 #endif /* I2C_OCRE_H_ */
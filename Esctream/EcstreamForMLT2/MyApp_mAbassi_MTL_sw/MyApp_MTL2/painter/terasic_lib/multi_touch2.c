@@ -2,40 +2,116 @@
 #include "multi_touch2.h"
 #include "I2C_core.h"
 #include "I2C.h"
+#include "trace.h"
+
+#include "mAbassi.h"          /* MUST include "SAL.H" and not uAbassi.h        */
 
 #define TRUE 1
 
+// The queue and the pool are shared by the touch task and GUI()
+static MTX_t *TouchMtx;
 
-void mtc2_QueryData(MTC2_INFO *p){
-    MTC2_EVENT *pEvent, *pOldEvent;
-    unsigned char reg_data[31];
-    unsigned long x1,y1,x2,y2,x3,y3,x4,y4,x5,y5;
-    if(OC_I2C_Read(p->TOUCH_I2C_BASE,I2C_FT5316_ADDR,0x00,reg_data,31))
-        {
- //   			if(reg_data[1]>0)
-//    				printf("reg_data[1]=%x\n",reg_data[1]);
-    			 pEvent = (MTC2_EVENT *)malloc(sizeof(MTC2_EVENT));
-    			 pEvent->Event=reg_data[1];
-        		 pEvent->TouchNum = reg_data[2];
-        		 x1 = ((reg_data[3]&0x0f)<<8)|reg_data[4];
-        		 y1 = ((reg_data[5]&0x0f)<<8)|reg_data[6];
-				 //the register value (1024,600)
-				 //change the value to (800,480)
-        		 pEvent->x1=(x1*800)>>10;
-        		 pEvent->y1=(y1/10)<<3;
+// Start the read of a touch frame and return, p->Xfer.pSem is posted when it is done
+bool mtc2_QueryData(MTC2_INFO *p){
+    p->FrameTime = time_us();
+    return OC_I2C_Submit(&p->Xfer);
+}
 
+// Queue an event (TouchMtx locked). A move replaces the queued move of the same
+// finger, unless the finger was pressed or released after it: GUI() only needs
+// the latest position, but every press and release. A full queue drops its
+// oldest move, or the new event when it only holds presses and releases.
+static void mtc2_PushEvent(MTC2_INFO *p, MTC2_EVENT *pNew){
+    MTC2_EVENT *pEvent;
+    int i, n;
+    if (pNew->Action == MTC2_MOVE){
+        for(i=QUEUE_Count(p->pQueue)-1;i>=0;i--){
+            pEvent = (MTC2_EVENT *)QUEUE_Peek(p->pQueue, i);
+            if (pEvent->Id != pNew->Id)
+                continue;
+            if (pEvent->Action == MTC2_MOVE){
+                *pEvent = *pNew;
+                return;
+            }
+            break;
         }
-    if((pEvent->TouchNum>0)&&(pEvent->TouchNum<=5))
-    {
-		if (QUEUE_IsFull(p->pQueue)){
-					  // remove the old one
-		  pOldEvent = (MTC2_EVENT *)QUEUE_Pop(p->pQueue);
-		  free(pOldEvent);
-		 }
-		 QUEUE_Push(p->pQueue, (alt_u32)pEvent);
     }
-    else
-    	free(pEvent);
+    if (QUEUE_IsFull(p->pQueue)){
+        n = QUEUE_Count(p->pQueue);
+        for(i=0;i<n;i++){
+            if (((MTC2_EVENT *)QUEUE_Peek(p->pQueue, i))->Action == MTC2_MOVE)
+                break;
+        }
+        if (i == n){
+            TRACE_WARN("TOUCH - Queue full of presses and releases, event dropped\n");
+            return;
+        }
+        // remove the oldest move, the others go back in the same order
+        while(n--){
+            pEvent = (MTC2_EVENT *)QUEUE_Pop(p->pQueue);
+            if (i-- == 0)
+                POOL_Put(p->pPool, (void *)pEvent);
+            else
+                QUEUE_Push(p->pQueue, (alt_u32)pEvent);
+        }
+    }
+    pEvent = (MTC2_EVENT *)POOL_Get(p->pPool);
+    *pEvent = *pNew;
+    QUEUE_Push(p->pQueue, (alt_u32)pEvent);
+}
+
+static int mtc2_CountDown(alt_u16 Down){
+    int n = 0;
+    for(;Down;Down&=Down-1)
+        n++;
+    return n;
+}
+
+// Queue the touches of the frame read by mtc2_QueryData() (touch task)
+void mtc2_ParseData(MTC2_INFO *p){
+    MTC2_EVENT Event;
+    alt_u8 *reg_data = p->reg_data;
+    alt_u8 *pt;
+    alt_u16 bit;
+    unsigned long x1,y1;
+    int i;
+    if(p->Xfer.status != I2C_XFER_OK)
+        return;
+    if((reg_data[2]&0x0f)>TOUCH_MAX_POINTS)
+        return;
+    Event.Event=reg_data[1];
+    Event.t = p->FrameTime;
+
+    MTXlock(TouchMtx, -1);
+    // 6 registers per point from 0x03: XH (action, X 11:8), XL, YH (id, Y 11:8), YL, 2 reserved
+    for(i=0;i<TOUCH_MAX_POINTS;i++){
+        pt = reg_data+3+6*i;
+        Event.Action = pt[0]>>6;
+        Event.Id = pt[2]>>4;
+        if (Event.Action == MTC2_NONE)
+            continue;
+        bit = 1<<Event.Id;
+        if (Event.Action == MTC2_RELEASE){
+            if ((p->Down & bit) == 0)
+                continue;
+            p->Down &= ~bit;
+        }
+        else{
+            // A finger in contact the press was not seen of is pressed now
+            Event.Action = (p->Down & bit)?MTC2_MOVE:MTC2_PRESS;
+            p->Down |= bit;
+        }
+        Event.TouchNum = mtc2_CountDown(p->Down);
+        //the register value (1024,600), filtered and scaled to (800,480)
+        x1 = ((pt[0]&0x0f)<<8)|pt[1];
+        y1 = ((pt[2]&0x0f)<<8)|pt[3];
+        TRACE_DEBUG("TOUCH %u %u %u %u %u\n", Event.t, Event.Id, Event.Action, x1, y1);  // see host/touchfilter.c
+        TFILTER_Apply(&p->Filter, Event.Id, Event.t, x1, y1, &Event.x1, &Event.y1);
+        if (Event.Action == MTC2_RELEASE)
+            TFILTER_Release(&p->Filter, Event.Id);
+        mtc2_PushEvent(p, &Event);
+    }
+    MTXunlock(TouchMtx);
 }
 
 
@@ -73,6 +149,17 @@ MTC2_INFO* MTC2_Init(alt_u32 TOUCH_I2C_BASE,alt_u32 TOUCH_INT_BASE, alt_u32 INT_
 
     p->INT_IRQ_NUM = INT_IRQ_NUM;
     p->pQueue = QUEUE_New(TOUCH_QUEUE_SIZE);
+    p->pPool = POOL_New(TOUCH_QUEUE_SIZE, sizeof(MTC2_EVENT));   // the queue holds one less
+    memset(&p->Xfer, 0, sizeof(I2C_XFER));
+    p->Xfer.device_address = I2C_FT5316_ADDR;
+    p->Xfer.sub_address = 0x00;
+    p->Xfer.bRead = TRUE;
+    p->Xfer.pData = p->reg_data;
+    p->Xfer.nLength = TOUCH_FRAME_SIZE;
+    p->Xfer.pSem = SEMopen("Touch I2C Sem");
+    p->Down = 0;
+    TFILTER_Init(&p->Filter);
+    TouchMtx = MTXopen("Touch Mtx");
 
 /*
 //    // enable interrupt
@@ -104,6 +191,7 @@ MTC2_INFO* MTC2_Init(alt_u32 TOUCH_I2C_BASE,alt_u32 TOUCH_INT_BASE, alt_u32 INT_
 void MTC2_UnInit(MTC2_INFO *p){
     if (p){
         QUEUE_Delete(p->pQueue);
+        POOL_Delete(p->pPool);
         free(p);
     }
 }
@@ -113,6 +201,7 @@ bool MTC2_GetStatus(MTC2_INFO *p, alt_u8 *Event, alt_u8 *TouchNum, uint16_t *X1,
 {
     bool bFind;
     MTC2_EVENT *pEvent;
+    MTXlock(TouchMtx, -1);
     bFind = QUEUE_IsEmpty(p->pQueue)?FALSE:TRUE;
     if (bFind){
         pEvent = (MTC2_EVENT *)QUEUE_Pop(p->pQueue);
@@ -120,14 +209,46 @@ bool MTC2_GetStatus(MTC2_INFO *p, alt_u8 *Event, alt_u8 *TouchNum, uint16_t *X1,
         *TouchNum = pEvent->TouchNum;
         *X1 = pEvent->x1;
         *Y1 = pEvent->y1;
-        free(pEvent);
+        POOL_Put(p->pPool, pEvent);
     }
+    MTXunlock(TouchMtx);
     return bFind;
 }
 
 
+// Take up to nMax events at once, oldest first. Returns the number taken.
+int MTC2_GetEvents(MTC2_INFO *p, MTC2_EVENT *pEvent, int nMax){
+    MTC2_EVENT *pQueued;
+    int n = 0;
+    MTXlock(TouchMtx, -1);
+    while (n < nMax && !QUEUE_IsEmpty(p->pQueue)){
+        pQueued = (MTC2_EVENT *)QUEUE_Pop(p->pQueue);
+        pEvent[n++] = *pQueued;
+        POOL_Put(p->pPool, pQueued);
+    }
+    MTXunlock(TouchMtx);
+    return n;
+}
+
+// Change the touch filter while running (see touch_filter.h)
+void MTC2_SetFilter(MTC2_INFO *p, const TFILTER_PARAMS *pParam){
+    MTXlock(TouchMtx, -1);
+    TFILTER_SetParams(&p->Filter, pParam);
+    MTXunlock(TouchMtx);
+}
+
+// Time from a touch frame to the display of its effect, measured by the GUI
+void MTC2_Latency(MTC2_INFO *p, alt_u32 us){
+    MTXlock(TouchMtx, -1);
+    TFILTER_Latency(&p->Filter, us);
+    MTXunlock(TouchMtx);
+}
+
 void MTC2_ClearEvent(MTC2_INFO *p){
-    QUEUE_Empty(p->pQueue);
+    MTXlock(TouchMtx, -1);
+    while (!QUEUE_IsEmpty(p->pQueue))
+        POOL_Put(p->pPool, (void *)QUEUE_Pop(p->pQueue));
+    MTXunlock(TouchMtx);
 }
 
 
@@ -2,8 +2,18 @@
 #define MULTI_TOUCH2_H_
 
 #include "queue.h"
+#include "I2C_core.h"
+#include "touch_filter.h"
 
 #define TOUCH_QUEUE_SIZE    32
+#define TOUCH_FRAME_SIZE    31      // FT5316 registers read per touch
+#define TOUCH_MAX_POINTS    5       // fingers reported in a frame
+
+// Finger actions (bits 7:6 of the X high register of a point)
+#define MTC2_PRESS          0
+#define MTC2_RELEASE        1
+#define MTC2_MOVE           2
+#define MTC2_NONE           3
 
 ////////////////////////////////////
 //
@@ -25,23 +35,37 @@ typedef struct{
     alt_u32 TOUCH_INT_BASE;
     alt_u32 INT_IRQ_NUM;
     QUEUE_STRUCT *pQueue;
+    POOL_STRUCT *pPool;     // MTC2_EVENT blocks of pQueue
+    I2C_XFER Xfer;          // read of the touch frame, Xfer.pSem posted when done
+    alt_u16 Down;           // fingers pressed, bit per touch id
+    alt_u32 FrameTime;      // time_us() when the read of the frame started
+    TFILTER Filter;         // scaling, smoothing and extrapolation of the points
+    alt_u8 reg_data[TOUCH_FRAME_SIZE];
 }MTC2_INFO;
 
 
+// One finger pressed, moved or released
 typedef struct{
 //getture not support this version
     alt_u8 Event;
-    alt_u8 TouchNum;
+    alt_u8 TouchNum;        // fingers down once the event is applied
+    alt_u8 Id;              // touch id of the finger (0 to 15)
+    alt_u8 Action;          // MTC2_PRESS, MTC2_RELEASE or MTC2_MOVE
     alt_u16 x1;
     alt_u16 y1;
+    alt_u32 t;              // time_us() of the frame
 }MTC2_EVENT;
 
 
-void mtc2_QueryData(MTC2_INFO *p);
+bool mtc2_QueryData(MTC2_INFO *p);
+void mtc2_ParseData(MTC2_INFO *p);
 MTC2_INFO* MTC2_Init(alt_u32 TOUCH_I2C_BASE,alt_u32 TOUCH_INT_BASE, alt_u32 INT_IRQ_NUM);
 void MTC2_UnInit(MTC2_INFO *p);
 //,int X3,int Y3,int X4,int Y4,int X5,int Y5
 bool MTC2_GetStatus(MTC2_INFO *p,alt_u8 *Event, alt_u8 *TouchNum, uint16_t *X1, uint16_t *Y1);
+int MTC2_GetEvents(MTC2_INFO *p, MTC2_EVENT *pEvent, int nMax);
+void MTC2_SetFilter(MTC2_INFO *p, const TFILTER_PARAMS *pParam);
+void MTC2_Latency(MTC2_INFO *p, alt_u32 us);
 //void MTC2_ShowEventText(alt_u8 Event);
 void MTC2_ClearEvent(MTC2_INFO *p);
 
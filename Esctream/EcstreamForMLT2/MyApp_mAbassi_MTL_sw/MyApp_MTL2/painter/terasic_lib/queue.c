@@ -52,3 +52,41 @@ void QUEUE_Empty(QUEUE_STRUCT *pQueue){
     pQueue->rear = 0;
 }
 
+int QUEUE_Count(QUEUE_STRUCT *pQueue){
+    return (pQueue->front+pQueue->num-pQueue->rear)%pQueue->num;
+}
+
+// nIndex-th oldest item (0 <= nIndex < QUEUE_Count), left in the queue
+alt_u32 QUEUE_Peek(QUEUE_STRUCT *pQueue, int nIndex){
+    return pQueue->data[(pQueue->rear+nIndex)%pQueue->num];
+}
+
+POOL_STRUCT* POOL_New(int nBlockNum, int nBlockSize){
+    int i;
+    POOL_STRUCT *pPool;
+    pPool = (POOL_STRUCT *)malloc(sizeof(POOL_STRUCT));
+    pPool->size = nBlockSize;
+    pPool->pBlock = (alt_u8 *)malloc(nBlockNum*nBlockSize);
+    pPool->pFree = QUEUE_New(nBlockNum+1);   // a queue holds num-1 items
+    for(i=0;i<nBlockNum;i++)
+        QUEUE_Push(pPool->pFree, i);
+    return pPool;
+}
+
+void POOL_Delete(POOL_STRUCT *pPool){
+    QUEUE_Delete(pPool->pFree);
+    free(pPool->pBlock);
+    free(pPool);
+}
+
+// NULL when every block is in use
+void* POOL_Get(POOL_STRUCT *pPool){
+    if (QUEUE_IsEmpty(pPool->pFree))
+        return NULL;
+    return pPool->pBlock + QUEUE_Pop(pPool->pFree)*pPool->size;
+}
+
+void POOL_Put(POOL_STRUCT *pPool, void *pBlock){
+    QUEUE_Push(pPool->pFree, ((alt_u8 *)pBlock - pPool->pBlock)/pPool->size);
+}
+
@@ -6,8 +6,7 @@ typedef struct{
     alt_u32 num;
     alt_u32 front;
     alt_u32 rear;
-    alt_u32 data[0];
-    alt_u32 mydata[2]; // custom data
+    alt_u32 data[];         // num words, allocated with the structure
 }QUEUE_STRUCT;
 
 QUEUE_STRUCT* QUEUE_New(int nQueueNum);
@@ -17,5 +16,19 @@ bool QUEUE_IsFull(QUEUE_STRUCT *pQueue);
 bool QUEUE_Push(QUEUE_STRUCT *pQueue, alt_u32 data32);
 alt_u32 QUEUE_Pop(QUEUE_STRUCT *pQueue);
 void QUEUE_Empty(QUEUE_STRUCT *pQueue);
+int QUEUE_Count(QUEUE_STRUCT *pQueue);
+alt_u32 QUEUE_Peek(QUEUE_STRUCT *pQueue, int nIndex);
+
+// Fixed-size blocks allocated once, for events passed through a queue
+typedef struct{
+    alt_u32 size;           // bytes per block
+    alt_u8 *pBlock;
+    QUEUE_STRUCT *pFree;    // indexes of the free blocks
+}POOL_STRUCT;
+
+POOL_STRUCT* POOL_New(int nBlockNum, int nBlockSize);
+void POOL_Delete(POOL_STRUCT *pPool);
+void* POOL_Get(POOL_STRUCT *pPool);
+void POOL_Put(POOL_STRUCT *pPool, void *pBlock);
 
 #endif /*QUEUE_H_*/
@@ -60,6 +60,7 @@
 #define alt_8   int8_t
 
 void delay_us(uint32_t us);
+uint32_t time_us(void);
 
 #define usleep(x) delay_us(x * 2)
 #define IOWR(address, offset, data) alt_write_word(address + (offset*4), data)
@@ -0,0 +1,122 @@
+#include <string.h>
+#include "touch_filter.h"
+
+// Positions are kept in 1/16 pixel, speeds in 1/16 pixel per second and the
+// filter gains in 1/65536, so the RTOS tasks do not need the FPU.
+#define Q               16
+#define GAIN_ONE        65536
+#define TFILTER_MIN_DT_US   1000    // closer samples are filtered as 1 ms apart
+
+static int32_t iabs(int32_t v){
+    return v < 0 ? -v : v;
+}
+
+// Gain of a first order low-pass of this cutoff (mHz) for a sample dt (us) after the last one
+static int32_t lowpass_gain(int32_t cutoff, uint32_t dt){
+    int64_t tau;
+    if (cutoff <= 0)
+        return 0;
+    tau = 159154943 / cutoff;       // 1 / (2 pi fc) in us
+    return (int32_t) (((int64_t) dt * GAIN_ONE) / (dt + tau));
+}
+
+static int32_t blend(int32_t from, int32_t to, int32_t gain){
+    return from + (int32_t) (((int64_t) (to - from) * gain) / GAIN_ONE);
+}
+
+// One axis of the one-euro filter (Casiez et al.): the cutoff rises with the speed
+static void one_euro(const TFILTER_PARAMS *p, int32_t *pos, int32_t *speed, int32_t raw, uint32_t dt){
+    int32_t v = (int32_t) (((int64_t) (raw - *pos) * 1000000) / dt);
+    *speed = blend(*speed, v, lowpass_gain(p->d_cutoff, dt));
+    *pos = blend(*pos, raw, lowpass_gain(p->min_cutoff + p->beta * (iabs(*speed) / Q), dt));
+}
+
+// One axis of the alpha-beta filter: constant speed model corrected by the residual
+static void alpha_beta(const TFILTER_PARAMS *p, int32_t *pos, int32_t *speed, int32_t raw, uint32_t dt){
+    int32_t predicted = *pos + (int32_t) (((int64_t) *speed * dt) / 1000000);
+    int32_t r = raw - predicted;
+    *pos = predicted + (r * p->alpha) / 256;
+    *speed += (int32_t) (((int64_t) r * p->ab_beta * 1000000) / (256 * (int64_t) dt));
+}
+
+static int clamp(int v, int lo, int hi){
+    if (v < lo)
+        return lo;
+    if (v > hi)
+        return hi;
+    return v;
+}
+
+void TFILTER_Init(TFILTER *f){
+    memset(f, 0, sizeof(TFILTER));
+    f->param.mode = TFILTER_MODE;
+    f->param.min_cutoff = TFILTER_MIN_CUTOFF;
+    f->param.beta = TFILTER_BETA;
+    f->param.d_cutoff = TFILTER_D_CUTOFF;
+    f->param.alpha = TFILTER_ALPHA;
+    f->param.ab_beta = TFILTER_AB_BETA;
+    f->param.predict = TFILTER_PREDICT;
+    f->param.max_predict_us = TFILTER_MAX_PREDICT_US;
+    f->latency = TFILTER_LATENCY_US;
+}
+
+// May be called at any time, the fingers in contact restart from their next sample
+void TFILTER_SetParams(TFILTER *f, const TFILTER_PARAMS *p){
+    int i;
+    f->param = *p;
+    for (i=0; i<TFILTER_IDS; i++)
+        f->finger[i].valid = false;
+}
+
+// Screen position (px) of finger id for a panel sample taken at time t (us)
+void TFILTER_Apply(TFILTER *f, int id, uint32_t t, int raw_x, int raw_y, uint16_t *x, uint16_t *y){
+    TFILTER_FINGER *fg = f->finger + (id & (TFILTER_IDS-1));
+    const TFILTER_PARAMS *p = &f->param;
+    int32_t sx, sy, ahead;
+    uint32_t dt = t - fg->t;
+
+    // Full precision scaling, rounded to 1/16 px
+    sx = (raw_x * TOUCH_SCREEN_WIDTH * Q + TOUCH_PANEL_WIDTH/2) / TOUCH_PANEL_WIDTH;
+    sy = (raw_y * TOUCH_SCREEN_HEIGHT * Q + TOUCH_PANEL_HEIGHT/2) / TOUCH_PANEL_HEIGHT;
+
+    if (!fg->valid || dt > TFILTER_RESET_US || p->mode == TFILTER_OFF) {
+        fg->x = sx;
+        fg->y = sy;
+        fg->vx = 0;
+        fg->vy = 0;
+    }
+    else {
+        if (dt < TFILTER_MIN_DT_US)
+            dt = TFILTER_MIN_DT_US;
+        if (p->mode == TFILTER_ALPHA_BETA) {
+            alpha_beta(p, &fg->x, &fg->vx, sx, dt);
+            alpha_beta(p, &fg->y, &fg->vy, sy, dt);
+        }
+        else {
+            one_euro(p, &fg->x, &fg->vx, sx, dt);
+            one_euro(p, &fg->y, &fg->vy, sy, dt);
+        }
+    }
+    fg->t = t;
+    fg->valid = true;
+
+    // Where the finger will be once the frame is displayed
+    ahead = (int32_t) (((int64_t) f->latency * p->predict) / 100);
+    if (ahead > p->max_predict_us)
+        ahead = p->max_predict_us;
+    sx = fg->x + (int32_t) (((int64_t) fg->vx * ahead) / 1000000);
+    sy = fg->y + (int32_t) (((int64_t) fg->vy * ahead) / 1000000);
+
+    *x = clamp((sx + Q/2) / Q, 0, TOUCH_SCREEN_WIDTH-1);
+    *y = clamp((sy + Q/2) / Q, 0, TOUCH_SCREEN_HEIGHT-1);
+}
+
+void TFILTER_Release(TFILTER *f, int id){
+    f->finger[id & (TFILTER_IDS-1)].valid = false;
+}
+
+// One measure of the time from a touch sample to the display of its effect (us)
+void TFILTER_Latency(TFILTER *f, uint32_t us){
+    if (us < 1000000)
+        f->latency += ((int32_t) us - (int32_t) f->latency) / 8;
+}
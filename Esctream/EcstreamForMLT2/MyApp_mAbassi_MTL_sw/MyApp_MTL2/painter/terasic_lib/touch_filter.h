@@ -0,0 +1,72 @@
+/*
+ * touch_filter.h
+ *
+ *  Touch filter stage between the FT5316 frames and the touch queue: the
+ *  1024x600 panel coordinates are scaled to the 800x480 screen without losing
+ *  precision, smoothed (one-euro or alpha-beta filter) and extrapolated by the
+ *  measured latency from the touch to the display. Integer only, also built
+ *  on the host (../../host/touchfilter.c plays recorded traces through it).
+ */
+
+#ifndef TOUCH_FILTER_H_
+#define TOUCH_FILTER_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TOUCH_PANEL_WIDTH       1024
+#define TOUCH_PANEL_HEIGHT      600
+#define TOUCH_SCREEN_WIDTH      800
+#define TOUCH_SCREEN_HEIGHT     480
+
+#define TFILTER_OFF             0       // scaling only
+#define TFILTER_ONE_EURO        1
+#define TFILTER_ALPHA_BETA      2
+
+#define TFILTER_IDS             16      // FT5316 touch ids
+#define TFILTER_RESET_US        100000  // a longer gap restarts the finger
+#define TFILTER_LATENCY_US      30000   // latency assumed before the first measure
+
+// Start-up parameters, see TFILTER_PARAMS. Not tuned on a recorded trace yet:
+// log one with TRACE_LEVEL=4 and play it with ../../host/touchfilter
+#ifndef TFILTER_MODE
+#define TFILTER_MODE            TFILTER_ALPHA_BETA
+#endif
+#define TFILTER_MIN_CUTOFF      1000
+#define TFILTER_BETA            30
+#define TFILTER_D_CUTOFF        1000
+#define TFILTER_ALPHA           96
+#define TFILTER_AB_BETA         32
+#define TFILTER_PREDICT         80
+#define TFILTER_MAX_PREDICT_US  50000
+
+typedef struct{
+    int mode;               // TFILTER_OFF, TFILTER_ONE_EURO or TFILTER_ALPHA_BETA
+    int min_cutoff;         // one-euro: cutoff at rest (mHz), lower = less jitter
+    int beta;               // one-euro: cutoff increase with speed (mHz per px/s), higher = less lag
+    int d_cutoff;           // one-euro: cutoff of the speed estimate (mHz)
+    int alpha;              // alpha-beta: position gain (1/256)
+    int ab_beta;            // alpha-beta: speed gain (1/256)
+    int predict;            // share of the latency the finger is extrapolated by (%)
+    int max_predict_us;     // extrapolation limit
+}TFILTER_PARAMS;
+
+typedef struct{
+    int32_t  x, y;          // filtered position (1/16 px)
+    int32_t  vx, vy;        // speed (1/16 px per s)
+    uint32_t t;             // time of the last sample (us)
+    bool     valid;
+}TFILTER_FINGER;
+
+typedef struct{
+    TFILTER_PARAMS param;
+    uint32_t latency;       // smoothed touch to display latency (us)
+    TFILTER_FINGER finger[TFILTER_IDS];
+}TFILTER;
+
+void TFILTER_Init(TFILTER *f);
+void TFILTER_SetParams(TFILTER *f, const TFILTER_PARAMS *p);
+void TFILTER_Apply(TFILTER *f, int id, uint32_t t, int raw_x, int raw_y, uint16_t *x, uint16_t *y);
+void TFILTER_Release(TFILTER *f, int id);
+void TFILTER_Latency(TFILTER *f, uint32_t us);
+
+#endif /* TOUCH_FILTER_H_ */
@@ -62,6 +62,11 @@ void* VIPFR_GetDrawFrame(VIP_FRAME_READER* p){
             return p->Frame1_Base;
         return p->Frame0_Base;
 }
+void* VIPFR_GetDisplayFrame(VIP_FRAME_READER* p){
+        if (p->DisplayFrame == 0)
+            return p->Frame0_Base;
+        return p->Frame1_Base;
+}
 void VIPFR_ActiveDrawFrame(VIP_FRAME_READER* p){
      p->DisplayFrame =  (p->DisplayFrame+1)%2;
      FrameReader_SelectFrame(p->VipBase, p->DisplayFrame);
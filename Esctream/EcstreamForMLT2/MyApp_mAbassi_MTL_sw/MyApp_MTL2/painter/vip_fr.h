@@ -25,6 +25,7 @@ VIP_FRAME_READER* VIPFR_Init(uint32_t *VipBase, void* Frame0_Base, void* Frame1_
 void VIPFR_UnInit(VIP_FRAME_READER* p);
 void VIPFR_Go(VIP_FRAME_READER* p, bool bGo);
 void* VIPFR_GetDrawFrame(VIP_FRAME_READER* p);
+void* VIPFR_GetDisplayFrame(VIP_FRAME_READER* p);
 void VIPFR_ActiveDrawFrame(VIP_FRAME_READER* p);
 void VIPFR_ReserveBackground(VIP_FRAME_READER* p);
 void VIPFR_SetFrameSize(VIP_FRAME_READER* p, int width, int height);
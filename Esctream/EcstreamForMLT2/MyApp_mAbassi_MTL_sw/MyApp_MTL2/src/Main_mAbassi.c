@@ -29,6 +29,11 @@ extern void Task_FPGA_Button(void);
 extern void Task_MTL2(void);
 extern void Task_MTL2_image(void);
 extern void Task_DisplayFile(void);
+extern void Task_Trace(void);
+extern void Task_Touch(void);
+#if (GAME_WEB)
+extern void web_Tick(void);
+#endif
 
 /* ------------------------------------------------------------------------------------------------ */
 
@@ -238,6 +243,12 @@ uint32_t    ACPwrt;
 
     Task = TSKcreate("App Display File", 4, 8192, &Task_DisplayFile, 0);
     TSKresume(Task);
+
+    Task = TSKcreate("App Touch", 2, 8192, &Task_Touch, 0);	/* Above the game tasks, see Task_Touch()	*/
+    TSKresume(Task);
+
+    Task = TSKcreate("App Trace", OX_PRIO_MIN-1, 8192, &Task_Trace, 0);	/* Below the app tasks, above idle	*/
+    TSKresume(Task);
     
 #if defined(USE_SHELL)
     TSKcreate("Shell", OX_PRIO_MIN, 16384, OSshell, 1);
@@ -252,10 +263,13 @@ uint32_t    ACPwrt;
 }
 
 /* ------------------------------------------------------------------------------------------------ */
-/* Not used but needed to build uAbassi																*/
+/* Called on every timer tick, samples the task running on each core for /telemetry.json			*/
 
 void TIMcallBack(void)
 {
+  #if (GAME_WEB)
+	web_Tick();
+  #endif
 	return;
 }
 
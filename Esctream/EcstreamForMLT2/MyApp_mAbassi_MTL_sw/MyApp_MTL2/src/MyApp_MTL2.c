@@ -20,14 +20,42 @@
 #include "alt_gpio.h"
 
 #include "gui.h"
+#include "frame.h"
+#if (GAME_NET)
+#include "netsync.h"
+#include "netif_setup.h"
+#endif
+#if (GAME_WEB)
+#include "WebServer.h"
+#endif
+#if (GAME_STREAM)
+void stream_Start(void);
+#endif
+#if (GAME_SYNC)
+#include "ptpsync.h"
+#endif
 #include "game.h"
+#include "lockstep.h"
+#include "replay.h"
+#include "trace.h"
+#include "telemetry.h"
 #include "stdbool.h" // added by simon to print boolean values
 MTC2_INFO *myTouch;
+static SEM_t *TouchSem;		// Touch panel interrupt -> Task_Touch
 VIP_FRAME_READER *myReader;
 uint32_t  *myFrameBuffer;
 uint32_t *txdata;			// ***ADDED (global variable for msg to send)
 SPI_EVENT *lastMsg;			// ***ADDED (global variable for rcvd msg)
 int new_lvl;			// ***ADDED
+QUEUE_STRUCT *rxQueue;		// Lockstep words received
+SPSC_RING rxRing;			// Words received by the SPI ISR
+SPSC_RING txRing;			// Lockstep words to send
+SPSC_RING fwdRing;			// Words of the other boards to pass on
+FRAME_RX spiRx;				// Frames received on the SPI link, and their statistics
+#if (GAME_NET)
+NETSYNC netSync;			// UDP link to the next board, replaces the SPI
+static void net_Start(void *arg);
+#endif
 
 int *flag;						// ***ADDED (global variable for break event)
 int *flag2;						// ***ADDED (global variable for break event of the other player)
@@ -40,12 +68,13 @@ void Task_MTL2_image(void)
 {
     MBX_t    *PrtMbx;
     PrtMbx = MBXopen("ImMailbox", 128);
-    intptr_t *PtrMsg;
+    intptr_t  Msg;
     SEM_t    *PtrSem;
     PtrSem = SEMopen("ImSemaphore");
+    // Every draw of GUI() comes here (GUI_Draw), the frame statistics have one writer
     while(1){
-    	if (MBXget(PrtMbx, PtrMsg, -1) == 0) {  // -1 = always blocks
-    		GUI_DeskDraw((LVL*) *PtrMsg);
+    	if (MBXget(PrtMbx, &Msg, -1) == 0) {  // -1 = always blocks
+    		GUI_DeskDraw((LVL*) Msg);
     		SEMpost(PtrSem);
 		}
     }
@@ -67,15 +96,23 @@ void Task_MTL2(void)
     printf("Starting MTL2 initialization\n");
 
     oc_i2c_init(fpga_i2c);
+    OC_I2C_AsyncInit(fpga_i2c);
     myTouch = MTC2_Init(fpga_i2c, fpga_mtc2, LCD_TOUCH_INT_IRQ);
 
     // Enable IRQ for SPI & MTL
 
+#if (GAME_NET)
+    Eth_ISR_Setup();
+#else
     OSisrInstall(GPT_SPI_IRQ, (void *) &spi_CallbackInterrupt);
     GICenable(GPT_SPI_IRQ, 128, 1);
     alt_write_word(SPI_CONTROL, SPI_CONTROL_IRRDY + SPI_CONTROL_IE);
+#endif
+    TouchSem = SEMopen("TouchSemaphore");		// Opened once, posted by mtc2_CallbackInterrupt
     OSisrInstall(GPT_MTC2_IRQ, (void *) &mtc2_CallbackInterrupt);
     GICenable(GPT_MTC2_IRQ, 128, 1);
+    OSisrInstall(GPT_I2C_IRQ, (void *) &i2c_CallbackInterrupt);
+    GICenable(GPT_I2C_IRQ, 128, 0);		// Level: the I2C core holds its interrupt until acknowledged
 
     // Enable interruptmask and edgecapture of PIO core for mtc2 irq
     alt_write_word(PIOinterruptmask_fpga_MTL, 0x3);
@@ -89,15 +126,16 @@ void Task_MTL2(void)
     // List the current directory contents
     cmd_ls();
 
+    // Record or play a session (see replay.h)
+    REPLAY_Open(REPLAY_FILE, GAME_REPLAY);
+
     printf("\nMTL2 initialization completed\n");
     MTXunlock(PrtMtx);
 
     bool GO = true;		//***ADDED
     printf("Go is true? : %d\n", GO);
     txdata = (uint32_t *)malloc(sizeof(uint32_t));		//***ADDED
-    lastMsg = (SPI_EVENT *)malloc(sizeof(SPI_EVENT));	//***ADDED
-    lastMsg->xcoord = 0;
-    lastMsg->ycoord = 0;
+    lastMsg = (SPI_EVENT *)calloc(GAME_PLAYERS, sizeof(SPI_EVENT));	//***ADDED (one per player)
     flag=(int *)malloc(sizeof(int));						//***ADDED by martin
     *flag=0x00000008;
     flag2=(int *)malloc(sizeof(int));						//***ADDED by martin
@@ -106,9 +144,25 @@ void Task_MTL2(void)
     *lvl1=0;
     lvl2=(int *)malloc(sizeof(int));
     *lvl2=0;
+    *txdata=0;
+    rxQueue = QUEUE_New(MSG_QUEUE_SIZE);
+#if (GAME_NET)
+    char addr[16];
+    sprintf(addr, NETSYNC_NET "%d", NETSYNC_HOST0 + OWN_PLAYER);
+    LwIP_Init(addr, NETSYNC_NETMASK, NETSYNC_GATEWAY);
+    tcpip_callback(net_Start, NULL);
+#endif
+#if (GAME_WEB)
+    http_server_init();		// Low priority task serving the files of the SD card on port 80
+#endif
+#if (GAME_STREAM)
+    stream_Start();			// Low priority task streaming the screen to a viewer (see stream.c)
+#endif
     while(GO)
     {
     	GUI(myTouch);
+    	if (REPLAY_Mode() == REPLAY_PLAY)	// Session over, back to live play
+    		REPLAY_Close();
     }
     free(txdata);
     free(lastMsg);
@@ -116,6 +170,7 @@ void Task_MTL2(void)
     free(flag2);
     free(lvl1);
     free(lvl2);
+    QUEUE_Delete(rxQueue);
 }
 
 // Used by i2C_core.c
@@ -132,6 +187,18 @@ void delay_us(uint32_t us) {
     while(alt_globaltmr_get64() < end_time);
 }
 
+// Free running microsecond time (wraps every ~71 minutes, compare with differences)
+uint32_t time_us(void) {
+    static uint32_t ticks_per_us = 0;
+    alt_freq_t timer_clock;
+
+    if (ticks_per_us == 0) {
+        assert(ALT_E_SUCCESS == alt_clk_freq_get(ALT_CLK_MPU_PERIPH, &timer_clock));
+        ticks_per_us = (timer_clock / (alt_globaltmr_prescaler_get() + 1)) / ALT_MICROSECS_IN_A_SEC;
+    }
+    return (uint32_t) (alt_globaltmr_get64() / ticks_per_us);
+}
+
 /*-----------------------------------------------------------*/
 
 /* Align on cache lines if cached transfers */
@@ -177,59 +244,139 @@ void Task_DisplayFile(void)
     }
 }
 
-bool validData(uint32_t data){
-	int flag = (data>>24)&0x000F;
-	bool validFlag = (flag==1 || flag==2 || flag==4 || flag==8 || flag==0);
-	uint32_t padder_12 = 0xFFF;
-	uint16_t xcoord = (uint16_t) ((data >> 12)& padder_12);
-	uint16_t ycoord = (uint16_t) (data & padder_12);
-	bool validCoord = (xcoord <= 800 && xcoord >= 0 && ycoord <= 480 && ycoord>=0);
-
-	return validCoord && validFlag;
+// Lowest application priority: prints the trace records (see trace.h)
+// while the game and the ISRs only store them
+void Task_Trace(void)
+{
+    for( ;; )
+    {
+        TRACE_Flush();
+        TSKsleep(OS_MS_TO_TICK(TRACE_PERIOD_MS));
+    }
 }
 
-/*-----------------------------------------------------------*/
+// Structure of SPI_RXDATA / SPI_TXDATA: see gui.h (lockstep.h when GAME_LOCKSTEP),
+// the words are carried in frames (see frame.h), over UDP when GAME_NET (see netsync.h).
+// No lock nor print here (TRACE only): the payload of each received frame is
+// timestamped and handed to GUI() through rxRing, the own word is read with a
+// single load and sent in a frame with everything GUI() queued since the last one.
+// With more than 2 boards, they are linked in a ring and GUI() queues in fwdRing
+// the words of the other boards to pass on.
 
-// Structure of SPI_RXDATA / SPI_TXDATA:
-// bits [16: 32]		x coordinate of player
-// bits [0 : 15]		y coordinate of player
-// xxxxxxxxxxxxxxxxyyyyyyyyyyyyyyyy
-void spi_CallbackInterrupt (uint32_t icciar, void *context)
+// Build the next frame to send, false when there is nothing new to send
+static bool link_NextFrame(FRAME *tx)
 {
-    uint32_t status = alt_read_word(SPI_STATUS);
-    uint32_t rxdata = alt_read_word(SPI_RXDATA);
-    // ***ADDED - RECEIVE OTHER PLAYER'S POSITION
-    // Empty msg queue if full
-	static uint32_t prevrxdata = 0;
-
-    if(prevrxdata != rxdata){ // ***ADDED - TRANSMIT OWN PLAYER'S POSITION
-    	printf("SPI_Interrupt - rxdata!=prevrxdata\n");
-    	uint32_t padder_12 = 0xFFF;
-		MTX_t *RMtx = MTXopen("RXData Mtx");
-		MTXlock(RMtx, -1);
-
-		// Convert received msg into SPI_EVENT structure
-		if (validData(rxdata)){
-			printf("SPI_Interrupt - Valid Data\n");
-			*flag2=(rxdata>>24)&0xF;
-			*lvl2=rxdata>>28;
-			printf("lvl2 :%d\n",*lvl2);
-			if(*flag2==0 && *flag==0){
-				lastMsg->xcoord = (uint16_t) ((rxdata >> 12)& padder_12);
-				lastMsg->ycoord = (uint16_t) (rxdata & padder_12);
-			}
-	    	printf("SPI_Interrupt - flag = %d, flag2 = %d\n", *flag, *flag2);
+	static uint8_t seq = 0;
+	static uint32_t sent = 0, sentTime = 0;
+	uint32_t own = __atomic_load_n(txdata, __ATOMIC_ACQUIRE);
+	uint32_t now = time_us();
+	uint32_t word;
+#if (GAME_LOCKSTEP)
+	// One word per queued input or hash, lvl and flag are kept up to date by GUI()
+	static uint32_t payload = 0;
+	bool bQueued = !SPSC_IsEmpty(&txRing);
+	own = (own & ~LS_WORD_PAYLOAD) | payload;
+#else
+	bool bQueued = false;
+#endif
+
+	if (own == sent && now - sentTime < FRAME_REFRESH_US && !bQueued && SPSC_IsEmpty(&fwdRing))
+		return false;
+
+#if (GAME_SYNC)
+	FRAME_Begin(tx, OWN_PLAYER, FRAME_WORDS, seq++, (uint32_t) (sync_now() / 1000));
+#else
+	FRAME_Begin(tx, OWN_PLAYER, FRAME_WORDS, seq++, now);
+#endif
+#if (GAME_LOCKSTEP)
+	while (!FRAME_FULL(tx) && SPSC_Pop(&txRing, &payload, NULL))
+		FRAME_Add(tx, (own & ~LS_WORD_PAYLOAD) | payload);
+	own = (own & ~LS_WORD_PAYLOAD) | payload;
+	if (!bQueued)
+#endif
+		FRAME_Add(tx, own);
+	// Passed on words fill the rest, what does not fit goes in the next frame
+	while (!FRAME_FULL(tx) && SPSC_Pop(&fwdRing, &word, NULL))
+		FRAME_Add(tx, word);
+	FRAME_End(tx);
+	TELEM_Count(&gameStats.link_tx, 1);
+
+	sent = own;
+	sentTime = now;
+	return true;
+}
+
+// Payload of a new frame of the previous board, built at time on its clock
+static void link_Received(const uint32_t *word, int n, uint32_t time)
+{
+	uint32_t now;
+	int i;
+
+	// While a session is played the other boards are ignored
+	if (REPLAY_Mode() == REPLAY_PLAY)
+		return;
+	TELEM_Count(&gameStats.link_rx, 1);
+	TELEM_Count(&gameStats.link_words, n);
+#if (GAME_SYNC)
+	// Both clocks follow the master: the time in the frame is on this clock too
+	if (PTPSYNC_Synced((OWN_PLAYER + GAME_PLAYERS - 1) % GAME_PLAYERS)) {
+		uint32_t latency = (uint32_t) (sync_now() / 1000) - time;
+		if (latency < 1000000)
+			TELEM_Add(&gameStats.link, latency);
+	}
+#endif
+	now = time_us();
+	for (i=0; i<n; i++) {
+		if (!SPSC_Push(&rxRing, word[i], now)) {
+			TRACE_WARN("LINK - Receive ring full, %d words dropped\n", n - i);
+			break;
 		}
-		MTXunlock(RMtx);
-		prevrxdata = rxdata;
-    }
+	}
+}
 
-	MTX_t *TMtx = MTXopen("TXData Mtx");
-	MTXlock(TMtx, -1);
+#if (GAME_NET)
+// Runs in the lwIP thread, the frames go to the next board of the ring
+static void net_Start(void *arg)
+{
+	ip_addr_t peer;
+	char addr[16];
+
+	sprintf(addr, NETSYNC_NET "%d", NETSYNC_HOST0 + (OWN_PLAYER + 1) % GAME_PLAYERS);
+	peer.addr = inet_addr(addr);
+	if (!NETSYNC_Init(&netSync, NETSYNC_PORT, &peer, NETSYNC_PORT, link_NextFrame, link_Received))
+		TRACE_ERR("NET - Cannot open the UDP port of the game sync\n");
+#if (GAME_SYNC)
+	if (!PTPSYNC_Start())
+		TRACE_ERR("NET - No shared clock, the EMAC does not time stamp\n");
+#endif
+}
+#endif
 
-	alt_write_word(SPI_TXDATA, *txdata);
+void spi_CallbackInterrupt (uint32_t icciar, void *context)
+{
+    static FRAME tx;
+    uint32_t rxdata = alt_read_word(SPI_RXDATA);
+	uint32_t word;
+
+    // ***ADDED - RECEIVE OTHER PLAYERS' POSITION
+	switch (FRAME_RxWord(&spiRx, rxdata)) {
+	case FRAME_RX_OK:
+		if (FRAME_TYPE(&spiRx.frame) == FRAME_WORDS)
+			link_Received(FRAME_PAYLOAD(&spiRx.frame), FRAME_COUNT(&spiRx.frame), FRAME_TIME(&spiRx.frame));
+		break;
+	case FRAME_RX_CRC:
+		TRACE_WARN("SPI - Frame dropped, bad CRC (%u so far)\n", spiRx.crc_errors);
+		break;
+	}
 
-	MTXunlock(TMtx);
+    // ***ADDED - TRANSMIT OWN PLAYER'S POSITION
+	if (!FRAME_NextWord(&tx, &word)) {
+		if (link_NextFrame(&tx))
+			FRAME_NextWord(&tx, &word);
+		else
+			word = FRAME_IDLE;
+	}
+	alt_write_word(SPI_TXDATA, word);
 
     // Clear the status of SPI core
     alt_write_word(SPI_STATUS, 0x00);
@@ -237,17 +384,46 @@ void spi_CallbackInterrupt (uint32_t icciar, void *context)
 
 /*-----------------------------------------------------------*/
 
-void mtc2_CallbackInterrupt (uint32_t icciar, void *context)
+// Moves the I2C transfers on (see I2C_core.h)
+void i2c_CallbackInterrupt (uint32_t icciar, void *context)
 {
+    OC_I2C_Interrupt();
+}
 
-    // Clear the interruptmask of PIO core
+// The touch frame is read over I2C by Task_Touch, not here
+void mtc2_CallbackInterrupt (uint32_t icciar, void *context)
+{
+    // Clear the interruptmask and edge register of PIO core until the task has read the frame
     alt_write_word(PIOinterruptmask_fpga_MTL, 0x0);
+    alt_write_word(PIOedgecapture_fpga_MTL, 0x1);
+
+    SEMpost(TouchSem);
+}
 
-    mtc2_QueryData(myTouch);
+// Highest application priority, a touch is read as soon as the panel signals it
+void Task_Touch(void)
+{
+    SEM_t    *PtrSem;
+    PtrSem = SEMopen("TouchSemaphore");
 
-    // Enable the interruptmask and edge register of PIO core for new interrupt
-    alt_write_word(PIOinterruptmask_fpga_MTL, 0x1);
-    alt_write_word(PIOedgecapture_fpga_MTL, 0x1);
+    for( ;; )
+    {
+        SEMwait(PtrSem, -1);    // -1 = Infinite blocking
+        if (mtc2_QueryData(myTouch)) {
+            // The CPU is free while the frame is read. Without the I2C interrupt the
+            // core is reset (the read ends in error) and the frame is read again.
+            if (SEMwait(myTouch->Xfer.pSem, OS_MS_TO_TICK(I2C_XFER_TIMEOUT_MS)) != 0) {
+                TRACE_WARN("TOUCH - No I2C interrupt, core reset\n");
+                OC_I2C_Reset();
+                SEMwait(myTouch->Xfer.pSem, 0);
+                SEMpost(PtrSem);
+            }
+            mtc2_ParseData(myTouch);	// Nothing if the read failed
+        }
+
+        // Enable the interruptmask of PIO core for new interrupt (an edge seen meanwhile fires now)
+        alt_write_word(PIOinterruptmask_fpga_MTL, 0x1);
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -0,0 +1,291 @@
+/*
+ * ptpsync.c
+ *
+ *  Shared clock of the boards when GAME_SYNC is 1 (see ../inc/ptpsync.h).
+ *  The EMAC time stamps the frames: ethernetif asks ptpsync_TxSel() which
+ *  ones to stamp when sent and hands ptpsync_RxStamp() the time each one was
+ *  received, both in the Ethernet tasks with the EMAC locked. The exchange
+ *  and the servo run in the lwIP thread, on a 1 ms timer.
+ */
+
+#include <string.h>
+#include "mAbassi.h"
+#include "Platform.h"
+#include "dw_ethernet.h"
+#include "ethernetif.h"
+#include "lwip/timers.h"
+#include "netsync.h"
+#include "ptpsync.h"
+#include "trace.h"
+
+#define PTPSYNC_WORD(type, id, seq)	((uint32_t) PTPSYNC_MAGIC << 24 | (type) << 20 | (id) << 16 | (seq))
+#define PTPSYNC_TYPE(w)		(((w) >> 20) & 0xF)
+#define PTPSYNC_ID(w)		(((w) >> 16) & 0xF)
+#define PTPSYNC_SEQ(w)		((w) & 0xFFFF)
+#define PTPSYNC_NS(sec, ns)	((uint64_t) (sec) * 1000000000u + (ns))
+#define PTPSYNC_TIMEOUT		(8 * PTPSYNC_PERIOD_MS)	// ms without exchange before a slave is unlocked
+
+typedef struct{
+	uint32_t seq;		// Of the message stamped, ~0 while written
+	uint32_t sec;
+	uint32_t nsec;
+}PTPSYNC_STAMP;
+
+PTPSYNC ptpSync;
+
+// Receive time stamps of the SYNC and DELAY_REQ, by slave id
+static PTPSYNC_STAMP ptpsync_Rx[PTPSYNC_TYPES][GAME_PLAYERS];
+
+static struct{
+	uint16_t seq;		// Of the exchange in progress
+	int      slave;		// Master: the slave of the exchange
+	bool     follow;	// Master: FOLLOW_UP to send once t1 is known
+	int      state;		// Slave: 1 t2 known, 2 t1 known and DELAY_REQ sent
+	uint64_t t1, t2;
+	int      ticks;		// ms since the last exchange started (master) or completed (slave)
+	int64_t  drift;		// ppb, integral of the servo
+}ptpsync_St;
+
+// Header of a message of the Ethernet frame p (source port when sent,
+// destination port when received), 0 when it is not one
+static uint32_t ptpsync_Parse(struct pbuf *p, bool tx){
+	uint8_t h[14 + 60 + 8 + 4];
+	uint32_t word;
+	int ihl, port;
+
+	if (pbuf_copy_partial(p, h, 14 + 20, 0) != 14 + 20
+	 || h[12] != 0x08 || h[13] != 0x00 || h[14+9] != IP_PROTO_UDP
+	 || (h[14+6] & 0x3F) != 0 || h[14+7] != 0)		// IPv4, not a fragment
+		return 0;
+	ihl = (h[14] & 0xF) * 4;
+	if (ihl < 20 || pbuf_copy_partial(p, h, 14 + ihl + 8 + 4, 0) != 14 + ihl + 8 + 4)
+		return 0;
+	port = tx ? h[14+ihl] << 8 | h[14+ihl+1] : h[14+ihl+2] << 8 | h[14+ihl+3];
+	memcpy(&word, h + 14 + ihl + 8, 4);
+	if (port != PTPSYNC_PORT || word >> 24 != PTPSYNC_MAGIC)
+		return 0;
+	return word;
+}
+
+// SYNC and DELAY_REQ are time stamped when sent
+static int ptpsync_TxSel(struct pbuf *p){
+	uint32_t word = ptpsync_Parse(p, true);
+
+	return word != 0 && (PTPSYNC_TYPE(word) == PTPSYNC_SYNC || PTPSYNC_TYPE(word) == PTPSYNC_DELAY_REQ);
+}
+
+static void ptpsync_RxStamp(struct pbuf *p, u32_t sec, u32_t nsec){
+	uint32_t word = ptpsync_Parse(p, false);
+	PTPSYNC_STAMP *s;
+
+	if (word == 0 || PTPSYNC_ID(word) >= GAME_PLAYERS
+	 || (PTPSYNC_TYPE(word) != PTPSYNC_SYNC && PTPSYNC_TYPE(word) != PTPSYNC_DELAY_REQ))
+		return;
+	s = &ptpsync_Rx[PTPSYNC_TYPE(word)][PTPSYNC_ID(word)];
+	__atomic_store_n(&s->seq, ~0u, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&s->sec, sec, __ATOMIC_RELAXED);
+	__atomic_store_n(&s->nsec, nsec, __ATOMIC_RELAXED);
+	__atomic_store_n(&s->seq, PTPSYNC_SEQ(word), __ATOMIC_RELEASE);
+}
+
+// Receive time of a message, false when it was not stamped or was overwritten
+static bool ptpsync_RxTime(uint32_t word, uint64_t *t){
+	PTPSYNC_STAMP *s = &ptpsync_Rx[PTPSYNC_TYPE(word)][PTPSYNC_ID(word)];
+	uint32_t sec, nsec;
+
+	if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != PTPSYNC_SEQ(word))
+		return false;
+	sec = __atomic_load_n(&s->sec, __ATOMIC_RELAXED);
+	nsec = __atomic_load_n(&s->nsec, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != PTPSYNC_SEQ(word))
+		return false;
+	*t = PTPSYNC_NS(sec, nsec);
+	return true;
+}
+
+// To the slave id from the master, to the master from a slave
+static void ptpsync_Send(int type, int id, uint32_t sec, uint32_t nsec){
+	uint32_t word[3] = { PTPSYNC_WORD(type, id, ptpsync_St.seq), sec, nsec };
+	struct pbuf *p;
+	ip_addr_t to;
+	char addr[16];
+	u32_t s, ns;
+
+	if (type == PTPSYNC_SYNC || type == PTPSYNC_DELAY_REQ)
+		ethernetif_tx_stamp(EMAC_DEV, &s, &ns);		// Drops a stamp not read, never taken for this one
+	p = pbuf_alloc(PBUF_TRANSPORT, sizeof(word), PBUF_RAM);
+	if (p == NULL)
+		return;
+	memcpy(p->payload, word, sizeof(word));
+	sprintf(addr, NETSYNC_NET "%d", NETSYNC_HOST0 + (OWN_PLAYER == 0 ? id : 0));
+	to.addr = ipaddr_addr(addr);
+	udp_sendto(ptpSync.pcb, p, &to, PTPSYNC_PORT);
+	pbuf_free(p);
+}
+
+static int64_t ptpsync_Clamp(int64_t v, int64_t max){
+	return v > max ? max : v < -max ? -max : v;
+}
+
+// Steps the clock of the slave or trims its rate, from the 4 time stamps of
+// an exchange. PI gains as ptp4l for a 125 ms interval.
+static void ptpsync_Servo(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4){
+	int64_t offset = ((int64_t) (t2 - t1) - (int64_t) (t4 - t3)) / 2;
+	int64_t delay = ((int64_t) (t2 - t1) + (int64_t) (t4 - t3)) / 2;
+	int64_t ppb;
+	uint32_t own = 1u << OWN_PLAYER;
+
+	if (delay < 0 || delay > PTPSYNC_DELAY_MAX){
+		ptpSync.dropped++;		// A frame queued on the way, the path is not symmetric
+		return;
+	}
+	ptpSync.samples++;
+	ptpSync.delay = (uint32_t) delay;
+	ptpSync.offset = (int32_t) ptpsync_Clamp(offset, INT32_MAX);
+	ptpsync_St.ticks = 0;
+
+	if (offset > PTPSYNC_STEP_NS || offset < -PTPSYNC_STEP_NS){
+		if (ETH_PTPstep(EMAC_DEV, -offset) != 0)
+			TRACE_WARN("SYNC - Clock step of %d ns failed\n", (int) ptpSync.offset);
+		ptpSync.steps++;
+		ptpSync.locked &= ~own;
+		return;
+	}
+	ptpsync_St.drift = ptpsync_Clamp(ptpsync_St.drift + offset * 13 / 100, PTPSYNC_PPB_MAX);
+	ppb = ptpsync_Clamp(offset * 13 / 10 + ptpsync_St.drift, PTPSYNC_PPB_MAX);
+	ptpSync.ppb = (int32_t) -ppb;
+	ETH_PTPadjFreq(EMAC_DEV, ptpSync.ppb);
+	if (offset < PTPSYNC_LOCK_NS && offset > -PTPSYNC_LOCK_NS)
+		ptpSync.locked |= own;
+	else
+		ptpSync.locked &= ~own;
+}
+
+static void ptpsync_Recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port){
+	uint32_t word[3];
+	u32_t sec, nsec;
+	uint64_t t;
+
+	if (pbuf_copy_partial(p, word, sizeof(word), 0) != sizeof(word) || word[0] >> 24 != PTPSYNC_MAGIC
+	 || PTPSYNC_ID(word[0]) >= GAME_PLAYERS){
+		pbuf_free(p);
+		return;
+	}
+	pbuf_free(p);
+
+	if (OWN_PLAYER == 0){
+		if (PTPSYNC_TYPE(word[0]) != PTPSYNC_DELAY_REQ)
+			return;
+		if (word[1] != 0)
+			ptpSync.locked |= 1u << PTPSYNC_ID(word[0]);
+		else
+			ptpSync.locked &= ~(1u << PTPSYNC_ID(word[0]));
+		if (PTPSYNC_SEQ(word[0]) == ptpsync_St.seq && ptpsync_RxTime(word[0], &t))
+			ptpsync_Send(PTPSYNC_DELAY_RESP, PTPSYNC_ID(word[0]), (uint32_t) (t / 1000000000u), (uint32_t) (t % 1000000000u));
+		return;
+	}
+
+	if (PTPSYNC_ID(word[0]) != OWN_PLAYER)
+		return;
+	switch (PTPSYNC_TYPE(word[0])){
+	case PTPSYNC_SYNC:
+		if (ptpsync_St.state != 0)
+			ptpSync.dropped++;		// The previous exchange did not complete
+		ptpsync_St.seq = PTPSYNC_SEQ(word[0]);
+		ptpsync_St.state = ptpsync_RxTime(word[0], &ptpsync_St.t2) ? 1 : 0;
+		ptpSync.locked = (word[1] & ~(1u << OWN_PLAYER)) | (ptpSync.locked & (1u << OWN_PLAYER));
+		break;
+	case PTPSYNC_FOLLOW_UP:
+		if (ptpsync_St.state != 1 || PTPSYNC_SEQ(word[0]) != ptpsync_St.seq)
+			break;
+		ptpsync_St.t1 = PTPSYNC_NS(word[1], word[2]);
+		ptpsync_Send(PTPSYNC_DELAY_REQ, OWN_PLAYER, (ptpSync.locked >> OWN_PLAYER) & 1, 0);
+		ptpsync_St.state = 2;
+		break;
+	case PTPSYNC_DELAY_RESP:
+		if (ptpsync_St.state != 2 || PTPSYNC_SEQ(word[0]) != ptpsync_St.seq)
+			break;
+		ptpsync_St.state = 0;
+		// The answer is back: the DELAY_REQ left long ago and its stamp is there
+		if (ethernetif_tx_stamp(EMAC_DEV, &sec, &nsec) != 0){
+			ptpSync.dropped++;
+			break;
+		}
+		ptpsync_Servo(ptpsync_St.t1, ptpsync_St.t2, PTPSYNC_NS(sec, nsec), PTPSYNC_NS(word[1], word[2]));
+		break;
+	}
+}
+
+// The master starts an exchange with the next slave every PTPSYNC_PERIOD_MS
+// and sends the FOLLOW_UP once the SYNC left, a slave unlocks itself when the
+// master is gone
+static void ptpsync_Timer(void *arg){
+	u32_t sec, nsec;
+
+	ptpsync_St.ticks++;
+	if (OWN_PLAYER == 0){
+		if (ptpsync_St.follow){
+			switch (ethernetif_tx_stamp(EMAC_DEV, &sec, &nsec)){
+			case 0:
+				ptpsync_Send(PTPSYNC_FOLLOW_UP, ptpsync_St.slave, sec, nsec);
+				ptpsync_St.follow = false;
+				break;
+			case -1:						// Not sent (waiting for ARP) or not stamped
+				ptpSync.dropped++;
+				ptpsync_St.follow = false;
+				break;
+			}
+		}
+		if (ptpsync_St.ticks >= PTPSYNC_PERIOD_MS / (GAME_PLAYERS - 1)){
+			ptpsync_St.ticks = 0;
+			ptpsync_St.slave = ptpsync_St.slave % (GAME_PLAYERS - 1) + 1;
+			ptpsync_St.seq++;
+			ptpsync_Send(PTPSYNC_SYNC, ptpsync_St.slave, ptpSync.locked, 0);
+			ptpsync_St.follow = true;
+		}
+	}
+	else if (ptpsync_St.ticks > PTPSYNC_TIMEOUT){
+		ptpsync_St.ticks = 0;
+		ptpSync.locked = 0;
+	}
+	sys_timeout(1, ptpsync_Timer, NULL);
+}
+
+// Must be called in the lwIP thread once the netif is up, false when the
+// EMAC cannot time stamp or out of UDP pcbs
+bool PTPSYNC_Start(void){
+	memset(&ptpSync, 0, sizeof(ptpSync));
+	memset(&ptpsync_St, 0, sizeof(ptpsync_St));
+	memset(ptpsync_Rx, 0xFF, sizeof(ptpsync_Rx));
+	ptpSync.pcb = udp_new();
+	if (ptpSync.pcb == NULL)
+		return false;
+	if (udp_bind(ptpSync.pcb, IP_ADDR_ANY, PTPSYNC_PORT) != ERR_OK
+	 || ethernetif_timestamp(EMAC_DEV, ptpsync_TxSel, ptpsync_RxStamp) != 0){
+		udp_remove(ptpSync.pcb);
+		ptpSync.pcb = NULL;
+		return false;
+	}
+	udp_recv(ptpSync.pcb, ptpsync_Recv, NULL);
+	if (OWN_PLAYER == 0)
+		ptpSync.locked = 1;			// The reference
+	sys_timeout(1, ptpsync_Timer, NULL);
+	return true;
+}
+
+// true when the clocks of the board of player and of this one both follow the master
+bool PTPSYNC_Synced(int player){
+	uint32_t locked = __atomic_load_n(&ptpSync.locked, __ATOMIC_RELAXED);
+
+	return (locked >> player & 1) != 0 && (locked >> OWN_PLAYER & 1) != 0;
+}
+
+// Shared clock in ns, the EMAC system time (the same on every locked board)
+uint64_t sync_now(void){
+	uint32_t sec, nsec;
+
+	ETH_PTPgetTime(EMAC_DEV, &sec, &nsec);
+	return PTPSYNC_NS(sec, nsec);
+}
@@ -0,0 +1,100 @@
+/*
+ * stream.c
+ *
+ *  Spectator stream of the screen when GAME_STREAM is 1: a viewer connecting
+ *  on TCP port STREAM_PORT gets the tiles of the displayed frame that changed
+ *  since the previous one (see ../game/tilecodec.h), the viewer.c of the PC
+ *  port shows them. One viewer at a time, the next one waits in the backlog.
+ *
+ *  The encoder is a low priority task on core #0: the game runs on core #1 and
+ *  is never waited for, the encoder only reads the frame it displays, after
+ *  each flip and at most STREAM_FPS times per second. The frame may be drawn
+ *  again while it is read: the tile is then sent torn, its hash changes and it
+ *  is sent again with the next encode. A frame flipped during its encode is
+ *  encoded again right away, and an idle game still has its frame encoded every
+ *  STREAM_REFRESH_MS: a torn tile never stays on the viewer (only the tiles
+ *  that changed are sent, an unchanged frame costs an end record).
+ */
+
+#include "mAbassi.h"
+#include "lwip/api.h"
+#include "telemetry.h"
+#include "tilecodec.h"
+#include "trace.h"
+#include "vip_fr.h"
+
+#define STREAM_PORT		5900
+#define STREAM_FPS		30			// Frames encoded per second, at most
+#define STREAM_REFRESH_MS	500		// Encode period when no frame is flipped
+#define STREAM_CORE		0			// The game runs on core #1
+#define STREAM_PRIO		(OX_PRIO_MIN-1)
+#define STREAM_STACK	8192
+
+extern VIP_FRAME_READER *pReader;
+
+static TILE_ENC stream_Enc;
+
+static bool stream_Write(void *ctx, const uint8_t *data, int len){
+	return netconn_write((struct netconn *) ctx, data, len, NETCONN_COPY) == ERR_OK;
+}
+
+// Sends the frames to a viewer until it goes away
+static void stream_Serve(struct netconn *conn){
+	VIP_FRAME_READER *reader;
+	uint8_t hdr[TILE_HDR_SIZE];
+	uint32_t seen, flips, last;
+	bool torn = false;
+
+	while ((reader = __atomic_load_n(&pReader, __ATOMIC_ACQUIRE)) == NULL)
+		TSKsleep(OS_MS_TO_TICK(100));	// GUI() not started yet
+	if (stream_Enc.prev == NULL && !TILE_EncInit(&stream_Enc, reader->width, reader->height)){
+		TRACE_ERR("stream - No memory for the encoder\n");
+		return;
+	}
+	TILE_EncKey(&stream_Enc);
+	TILE_Header(hdr, reader->width, reader->height);
+	if (!stream_Write(conn, hdr, sizeof(hdr)))
+		return;
+
+	seen = TELEM_Read(&gameStats.flips) - 1;	// Send the frame displayed now
+	last = G_OStimCnt;
+	for (;;){
+		flips = TELEM_Read(&gameStats.flips);
+		if (flips == seen && !torn && (int32_t) (G_OStimCnt - last) < OS_MS_TO_TICK(STREAM_REFRESH_MS)){
+			TSKsleep(OS_MS_TO_TICK(1000 / STREAM_FPS / 4));
+			continue;
+		}
+		seen = flips;
+		last = G_OStimCnt;
+		if (TILE_EncFrame(&stream_Enc, (const uint32_t *) VIPFR_GetDisplayFrame(reader),
+		                  __atomic_load_n(&gameStats.last_flip, __ATOMIC_ACQUIRE), stream_Write, conn) < 0)
+			return;
+		torn = TELEM_Read(&gameStats.flips) != seen;	// Flipped while read, some tiles may be torn
+		TSKsleep(OS_MS_TO_TICK(1000 / STREAM_FPS));
+	}
+}
+
+static void stream_Task(void *arg){
+	struct netconn *listen, *conn;
+
+	TSKsetCore(TSKmyID(), STREAM_CORE);
+	listen = netconn_new(NETCONN_TCP);
+	if (listen == NULL || netconn_bind(listen, NULL, STREAM_PORT) != ERR_OK || netconn_listen(listen) != ERR_OK){
+		TRACE_ERR("stream - Cannot listen on port %d\n", STREAM_PORT);
+		return;
+	}
+	for (;;){
+		if (netconn_accept(listen, &conn) != ERR_OK)
+			continue;
+		TRACE_INFO("stream - Viewer connected\n");
+		stream_Serve(conn);
+		TRACE_INFO("stream - Viewer gone, %u frames, %u tiles sent\n",
+		           (unsigned) stream_Enc.frames, (unsigned) stream_Enc.tiles);
+		netconn_close(conn);
+		netconn_delete(conn);
+	}
+}
+
+void stream_Start(void){
+	sys_thread_new("App Stream", stream_Task, NULL, STREAM_STACK, STREAM_PRIO);
+}
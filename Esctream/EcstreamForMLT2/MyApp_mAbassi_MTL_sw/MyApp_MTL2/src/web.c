@@ -0,0 +1,199 @@
+/*
+ * web.c
+ *
+ *  Hooks of the Code-Time web server (Share/src/WebServer.c) when GAME_WEB is 1.
+ *  The server sends the files of the SD card as they are (assets, replays,
+ *  traces) and generates /telemetry.json, the live state of the game: latency
+ *  histograms, link counters, per task CPU load and stack, heap and assets.
+ *  "/telemetry.json?stream[=ms]" (or an EventSource) gets it as server-sent
+ *  events, one JSON object per line. No CGI, no POST handler, no SSI variable.
+ */
+
+#include "WebApp.h"
+#include <malloc.h>
+#include <stdarg.h>
+#include "telemetry.h"
+#include "frame.h"
+#include "spsc.h"
+#if (GAME_NET)
+#include "netsync.h"
+#endif
+#if (GAME_SYNC)
+#include "ptpsync.h"
+#endif
+#if LWIP_STATS
+#include "lwip/stats.h"
+#endif
+
+#define WEB_CPU_TASKS		32		// Tasks the CPU load is measured for
+#define WEB_CPU_WINDOW		OS_TICK_PER_SEC		// Ticks in a measurement window
+
+// The kernel library is built without its performance monitor, so the CPU
+// load is sampled: on every tick, the task running on each core is charged
+// with it. Tasks running less than a tick at a time may be missed.
+typedef struct{
+	TSK_t   *task;
+	uint32_t ticks[OX_N_CORE];	// Ticks seen running in the current window
+	uint32_t load[OX_N_CORE];	// Ticks of the last complete window
+}WEB_CPU;
+
+// Counter and its increase over the last window
+typedef struct{
+	uint32_t prev;
+	uint32_t rate;
+}WEB_RATE;
+
+extern TSK_t *g_TaskList;
+extern SPSC_RING rxRing;
+extern SPSC_RING txRing;
+extern SPSC_RING fwdRing;
+extern FRAME_RX spiRx;
+#if (GAME_NET)
+extern NETSYNC netSync;
+#endif
+extern uint32_t time_us(void);
+
+static WEB_CPU  web_Cpu[WEB_CPU_TASKS];
+static int      web_Window;
+static WEB_RATE web_Flips, web_Tx, web_Rx, web_Words;
+
+static int web_Telemetry(char *buf, int size);
+
+void CGIinit(void){
+	PAGEnewHandler("/telemetry.json", web_Telemetry);
+}
+
+void POSTinit(void){
+}
+
+void SSIinit(void){
+}
+
+static void web_Rate(WEB_RATE *r, const uint32_t *counter){
+	uint32_t now = TELEM_Read(counter);
+
+	r->rate = now - r->prev;
+	r->prev = now;
+}
+
+// Called by TIMcallBack() on every tick of core #0
+void web_Tick(void){
+	int core, i;
+
+	if (COREgetID() != 0)
+		return;
+	for (core=0; core<OX_N_CORE; core++){
+		TSK_t *task = G_OStaskNow[core];
+		for (i=0; i<WEB_CPU_TASKS && web_Cpu[i].task != NULL && web_Cpu[i].task != task; i++)
+			;
+		if (i < WEB_CPU_TASKS){
+			web_Cpu[i].task = task;
+			web_Cpu[i].ticks[core]++;
+		}
+	}
+	if (++web_Window < WEB_CPU_WINDOW)
+		return;
+	web_Window = 0;
+	for (i=0; i<WEB_CPU_TASKS && web_Cpu[i].task != NULL; i++){
+		for (core=0; core<OX_N_CORE; core++){
+			web_Cpu[i].load[core] = web_Cpu[i].ticks[core];
+			web_Cpu[i].ticks[core] = 0;
+		}
+	}
+	web_Rate(&web_Flips, &gameStats.flips);
+	web_Rate(&web_Tx, &gameStats.link_tx);
+	web_Rate(&web_Rx, &gameStats.link_rx);
+	web_Rate(&web_Words, &gameStats.link_words);
+}
+
+// snprintf() appending at buf[len], returns the new length (clipped to size-1)
+static int web_Printf(char *buf, int size, int len, const char *fmt, ...){
+	va_list args;
+
+	if (len >= size - 1)
+		return len;
+	va_start(args, fmt);
+	len += vsnprintf(buf + len, size - len, fmt, args);
+	va_end(args);
+	return len < size ? len : size - 1;
+}
+
+static int web_Hist(char *buf, int size, int len, const char *name, const TELEM_HIST *h){
+	len = web_Printf(buf, size, len, "\"%s\":", name);
+	if (len < size - 1)
+		len += TELEM_Json(buf + len, size - len, h);
+	return len;
+}
+
+static uint32_t web_Load(const TSK_t *task, int core){
+	int i;
+
+	for (i=0; i<WEB_CPU_TASKS && web_Cpu[i].task != NULL; i++)
+		if (web_Cpu[i].task == task)
+			return web_Cpu[i].load[core] * 100 / WEB_CPU_WINDOW;
+	return 0;
+}
+
+// Page generator of /telemetry.json, a single line (server-sent events)
+static int web_Telemetry(char *buf, int size){
+	struct mallinfo heap = mallinfo();
+	TSK_t *task;
+	int len, i, core;
+
+	len = web_Printf(buf, size, 0, "{\"time_us\":%u,\"uptime_s\":%u,\"bins_us\":[",
+	                 (unsigned) time_us(), (unsigned) (G_OStimCnt / OS_TICK_PER_SEC));
+	for (i=0; i<TELEM_BINS-1; i++)
+		len = web_Printf(buf, size, len, i == 0 ? "%u" : ",%u", TELEM_BIN0_US << i);
+	len = web_Printf(buf, size, len, "],");
+	len = web_Hist(buf, size, len, "frame", &gameStats.frame);
+	len = web_Printf(buf, size, len, ",");
+	len = web_Hist(buf, size, len, "draw", &gameStats.draw);
+	len = web_Printf(buf, size, len, ",");
+	len = web_Hist(buf, size, len, "touch_to_flip", &gameStats.touch);
+	len = web_Printf(buf, size, len, ",\"flips\":%u,\"fps\":%u",
+	                 (unsigned) TELEM_Read(&gameStats.flips), (unsigned) web_Flips.rate);
+
+	len = web_Printf(buf, size, len, ",\"link\":{\"tx\":%u,\"rx\":%u,\"words\":%u,\"tx_per_s\":%u,\"rx_per_s\":%u,\"words_per_s\":%u",
+	                 (unsigned) TELEM_Read(&gameStats.link_tx), (unsigned) TELEM_Read(&gameStats.link_rx),
+	                 (unsigned) TELEM_Read(&gameStats.link_words), (unsigned) web_Tx.rate, (unsigned) web_Rx.rate,
+	                 (unsigned) web_Words.rate);
+	len = web_Printf(buf, size, len, ",\"good\":%u,\"crc_errors\":%u,\"stale\":%u,\"dropped\":{\"rx\":%u,\"tx\":%u,\"fwd\":%u}}",
+	                 (unsigned) spiRx.good, (unsigned) spiRx.crc_errors, (unsigned) spiRx.stale,
+	                 (unsigned) rxRing.dropped, (unsigned) txRing.dropped, (unsigned) fwdRing.dropped);
+#if (GAME_NET)
+	len = web_Printf(buf, size, len, ",\"net\":{\"sent\":%u,\"send_errors\":%u,\"gathered\":%u,\"good\":%u,\"crc_errors\":%u,\"stale\":%u",
+	                 (unsigned) netSync.sent, (unsigned) netSync.send_errors, (unsigned) netSync.gathered,
+	                 (unsigned) netSync.rx.good, (unsigned) netSync.rx.crc_errors, (unsigned) netSync.rx.stale);
+#if LWIP_STATS && LINK_STATS
+	len = web_Printf(buf, size, len, ",\"eth\":{\"xmit\":%u,\"recv\":%u,\"drop\":%u,\"err\":%u}",
+	                 (unsigned) lwip_stats.link.xmit, (unsigned) lwip_stats.link.recv,
+	                 (unsigned) lwip_stats.link.drop, (unsigned) lwip_stats.link.err);
+#endif
+	len = web_Printf(buf, size, len, "}");
+#endif
+#if (GAME_SYNC)
+	len = web_Printf(buf, size, len, ",");
+	len = web_Hist(buf, size, len, "link_latency", &gameStats.link);
+	len = web_Printf(buf, size, len, ",\"sync\":{\"offset_ns\":%d,\"delay_ns\":%u,\"ppb\":%d,\"samples\":%u,\"steps\":%u,\"dropped\":%u,\"locked\":%u}",
+	                 (int) ptpSync.offset, (unsigned) ptpSync.delay, (int) ptpSync.ppb, (unsigned) ptpSync.samples,
+	                 (unsigned) ptpSync.steps, (unsigned) ptpSync.dropped, (unsigned) ptpSync.locked);
+#endif
+
+	len = web_Printf(buf, size, len, ",\"tasks\":[");
+	for (task=g_TaskList; task != NULL; task=task->TaskNext){
+		len = web_Printf(buf, size, len, "%s{\"name\":\"%s\",\"prio\":%d,\"core\":%d,\"cpu\":[",
+		                 task == g_TaskList ? "" : ",", task->TskName, task->Prio, task->MyCore);
+		for (core=0; core<OX_N_CORE; core++)
+			len = web_Printf(buf, size, len, core == 0 ? "%u" : ",%u", (unsigned) web_Load(task, core));
+#if ((OX_STACK_CHECK) != 0)
+		len = web_Printf(buf, size, len, "],\"stack_free\":%d}", TSKstkChk(task, 0));
+#else
+		len = web_Printf(buf, size, len, "]}");
+#endif
+	}
+	// newlib: usmblks is the most the heap ever took from sbrk(), its high-water
+	len = web_Printf(buf, size, len, "],\"heap\":{\"arena\":%u,\"used\":%u,\"peak\":%u},\"assets\":{\"images\":%u,\"bytes\":%u}}",
+	                 (unsigned) heap.arena, (unsigned) heap.uordblks, (unsigned) heap.usmblks,
+	                 (unsigned) TELEM_Read(&gameStats.images), (unsigned) TELEM_Read(&gameStats.image_bytes));
+	return len;
+}
@@ -129,6 +129,10 @@ extern "C"
  #endif
 #endif
 
+#ifndef ETH_PTP_REF_CLK								/* Frequency of the IEEE 1588 reference clock	*/
+  #define ETH_PTP_REF_CLK		25000000			/* Cyclone V: osc1_clk unless set to the FPGA	*/
+#endif
+
 #if ((ETH_RX_BUFSIZE) > 0x1FFF)
 	#error "ETH_RX_BUFSIZE exceeds the DMA maximum transfer size" 
 #endif
@@ -269,6 +273,26 @@ extern const int                 G_EMACreMap[];
 #define EMAC_MMC_RX_INT_MASK_REG		(0x0110/4)
 #define EMAC_MMC_CKS_INT_MASK_REG		(0x0200/4)
 #define EMAC_MMC_CKS_INT_STAT_REG		(0x0208/4)
+#define EMAC_TS_CTL_REG					(0x0700/4)
+  #define EMAC_TS_CTL_TSENA				  (1<<0)
+  #define EMAC_TS_CTL_TSCFUPDT			  (1<<1)
+  #define EMAC_TS_CTL_TSINIT			  (1<<2)
+  #define EMAC_TS_CTL_TSUPDT			  (1<<3)
+  #define EMAC_TS_CTL_TSTRIG			  (1<<4)
+  #define EMAC_TS_CTL_TSADDREG			  (1<<5)
+  #define EMAC_TS_CTL_TSENALL			  (1<<8)
+  #define EMAC_TS_CTL_TSCTRLSSR			  (1<<9)
+  #define EMAC_TS_CTL_TSVER2ENA			  (1<<10)
+  #define EMAC_TS_CTL_TSIPENA			  (1<<11)
+  #define EMAC_TS_CTL_TSIPV4ENA			  (1<<13)
+  #define EMAC_TS_CTL_TSEVNTENA			  (1<<14)
+#define EMAC_TS_SUBSEC_INC_REG			(0x0704/4)
+#define EMAC_TS_SEC_REG					(0x0708/4)
+#define EMAC_TS_NSEC_REG				(0x070C/4)
+#define EMAC_TS_SEC_UPD_REG				(0x0710/4)
+#define EMAC_TS_NSEC_UPD_REG			(0x0714/4)
+  #define EMAC_TS_NSEC_UPD_ADDSUB		  (1U<<31)
+#define EMAC_TS_ADDEND_REG				(0x0718/4)
 #define EMAC_DMA_BUS_REG				(0x1000/4)
   #define EMAC_DMA_BUS_SWR				  (1<<0)
   #define EMAC_DMA_BUS_DSL				  (0x1F<<2)
@@ -430,6 +454,9 @@ void        mETH_PowerUp                         (int Dev, int PHYaddr);	/* ***
 int          ETH_Prepare_Multi_Transmit          (int Dev, int Len, int IsFirst, int IsLast);
 int          ETH_Prepare_Transmit_Descriptors    (int Dev, int Len);
 void         ETH_Release_Received                (int Dev);
+#if ((ETH_IS_BUF_PBUF) != 0)
+void        *ETH_Reclaim_Transmit                (int Dev);
+#endif
 void         ETH_ResetEMAC                       (int Dev);
 void         ETH_ResetEMACs                      (void);
 void         ETH_Restart                         (int Dev);
@@ -437,6 +464,9 @@ void         ETH_RestartNegotiation              (int Dev);					/* *** SEE NOTE
 void        mETH_RestartNegotiation              (int Dev, int PHYaddr);	/* *** SEE NOTE ABOVE	*/
 void         ETH_RXdisable                       (int Dev);
 void         ETH_RXenable                        (int Dev);
+#if ((ETH_IS_BUF_PBUF) != 0)
+void        *ETH_Set_Transmit_Buffer             (int Dev, void *Buff, void *Pbuf);
+#endif
 void         ETH_Start                           (int Dev);
 void         ETH_Stop                            (int Dev);
 void         ETH_TXdisable                       (int Dev);
@@ -472,6 +502,20 @@ void         ETH_MMCtxDisable                    (int Dev, uint32_t IRQflags);
 void         ETH_MMCtxEnable                     (int Dev, uint32_t IRQflags);
 uint32_t     ETH_MMCtxStat                       (int Dev);
 
+/* ------------------------------------------------------------------------------------------------ */
+/* EMAC IEEE 1588 time stamping function prototypes													*/
+/*																									*/
+/* NOTE:																							*/
+/*		Need USE_ENHANCED_DMA_DESCRIPTORS, the time stamps are in the descriptors					*/
+
+void         ETH_PTPadjFreq                      (int Dev, int32_t Ppb);
+void         ETH_PTPgetTime                      (int Dev, uint32_t *Sec, uint32_t *Nsec);
+int          ETH_PTPinit                         (int Dev);
+int          ETH_PTPrxStamp                      (int Dev, uint32_t *Sec, uint32_t *Nsec);
+int          ETH_PTPstep                         (int Dev, int64_t Nsec);
+void         ETH_PTPtxArm                        (int Dev);
+int          ETH_PTPtxStamp                      (int Dev, uint32_t *Sec, uint32_t *Nsec);
+
 /* ------------------------------------------------------------------------------------------------ */
 /* External PHY I/F stuff																			*/
 
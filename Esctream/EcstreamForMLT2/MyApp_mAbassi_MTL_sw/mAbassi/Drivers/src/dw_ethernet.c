@@ -152,6 +152,26 @@
 /*	}																								*/
 /*																									*/
 /* ------------------------------------------------------------------------------------------------ */
+/* TX without copy (ETH_BUFFER_PBUF): the descriptors point to the pbuf payloads					*/
+/*																									*/
+/*	while ((Pbuf = ETH_Reclaim_Transmit(Dev)) != NULL) {											*/
+/*		pbuf_free(Pbuf);																			*/
+/*	}																								*/
+/*	for each segment of the packet {																*/
+/*		do {																						*/
+/*			DMAbuf = ETH_Get_Transmit_Buffer();														*/
+/*		} while (DMAbuf == NULL);																	*/
+/*		pbuf_ref(Segment);																			*/
+/*		Old = ETH_Set_Transmit_Buffer(Dev, Segment->payload, Segment);								*/
+/*		if (Old != NULL) {																			*/
+/*			pbuf_free(Old);																			*/
+/*		}																							*/
+/*		ETH_Prepare_Multi_Transmit(Dev, Segment->len, IsFirst, IsLast);								*/
+/*	}																								*/
+/*																									*/
+/* ETH_Set_Transmit_Buffer(Dev, NULL, NULL) puts back the descriptor own buffer						*/
+/*																									*/
+/* ------------------------------------------------------------------------------------------------ */
 
 #if defined(_STANDALONE_)
   #include "mAbassi.h"
@@ -550,6 +570,9 @@ const int G_EMACreMap[] = { ETH_IDX_0
   #define ETH_DMATxDesc_TBS1	((uint32_t)0x00001FFF)		/* Transmit Buffer1 Size				*/
   #define ETH_DMARxDesc_RCH		((uint32_t)0x00004000)		/* Second Address Chained				*/
   #define ETH_DMATxDesc_TCH		((uint32_t)0x00100000)		/* Second Address Chained				*/
+  #define ETH_DMARxDesc_TSA		((uint32_t)0x00000080)		/* Time stamp available (last segment)	*/
+  #define ETH_DMATxDesc_TTSE	((uint32_t)0x02000000)		/* Time stamp the frame (first segment)	*/
+  #define ETH_DMATxDesc_TTSS	((uint32_t)0x00020000)		/* Time stamp captured (last segment)	*/
 #else
   #define ETH_DMARxDesc_RBS1	((uint32_t)0x000007FF)		/* Receive Buffer1 Size					*/
   #define ETH_DMATxDesc_FS		((uint32_t)0x20000000)		/* First Segment						*/
@@ -739,10 +762,21 @@ typedef struct {									/* Per device: configuration & state			*/
 	         ETH_DMAdesc_t   *TxDesc;				/* Pointer to this device TX descriptors		*/
 	volatile ETH_DMAdesc_t   *TxDescToSet;			/* Next descriptor to use						*/
 	volatile ETH_DMAdesc_t   *TxDescToStart;		/* First frame in a packet						*/
+  #if ((ETH_IS_BUF_PBUF) != 0)
+	volatile ETH_DMAdesc_t   *TxDescToFree;			/* Next descriptor to reclaim the pbuf from		*/
+  #endif
   #if ((ETH_IS_BUF_CACHED) != 0)
 	int                       Idx2Flush;			/* Index where the next to flush is				*/
 	ETH_DMAdesc_t            *Desc2Flush[ETH_N_RXBUF];	/* Descriptors to flush once all read		*/
   #endif
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	uint32_t                  PTPaddend;			/* Addend at the nominal rate, 0: stamping off	*/
+	int                       TxStampArm;			/* Time stamp the next frame to transmit		*/
+	volatile ETH_DMAdesc_t   *TxDescStamp;			/* Last segment of the frame time stamped		*/
+	int                       RxStamped;			/* If the last packet RXed was time stamped		*/
+	uint32_t                  RxStampSec;			/* and when										*/
+	uint32_t                  RxStampNsec;
+  #endif
 } EMACcfg_t;
 
 static EMACcfg_t    g_EMACcfg[ETH_NMB_DEVICES];		/* Device configuration							*/
@@ -761,6 +795,9 @@ static int  ETH_RdPhyRegExt (int PHYid, int Dev, int PHYaddr, int PHYreg);
 static int  ETH_WrtPhyReg   (int Dev, int PHYaddr, int PHYreg, int PHYval);
 static int  ETH_WrtPhyRegExt(int PHYid, int Dev, int PHYaddr, int PHYreg, int PHYval);
 static void uDelay          (int Time);
+#ifdef USE_ENHANCED_DMA_DESCRIPTORS
+  static int  ETH_PTPwait   (volatile uint32_t *Reg, uint32_t Bit);
+#endif
 
 /* ------------------------------------------------------------------------------------------------ */
 /* Rough delay of N us																				*/
@@ -885,6 +922,12 @@ FrameTypeDef  Frame;
 			Frame.length     = ((MyCfg->RxDescToGet->Status & ETH_DMARxDesc_FL) >> 16)
 			                 - 4					/* Don't include the CRC						*/
 			                 - MyCfg->RxByteCnt;
+		  #ifdef USE_ENHANCED_DMA_DESCRIPTORS		/* Memo the time stamp (ETH_PTPrxStamp()), the	*/
+			MyCfg->RxStamped   = (MyCfg->PTPaddend != 0)	/* status is lost when not the first segment	*/
+			                  && ((MyCfg->RxDescToGet->Status & ETH_DMARxDesc_TSA) != 0);
+			MyCfg->RxStampSec  = MyCfg->RxDescToGet->TimeStampHigh;
+			MyCfg->RxStampNsec = MyCfg->RxDescToGet->TimeStampLow;
+		  #endif
 		}
 		else {
 			Frame.length     = MyCfg->RxDescToGet->ControlBufferSize
@@ -1046,6 +1089,15 @@ volatile uint32_t *Reg;
 
 		MyCfg->TxDescToSet->ControlBufferSize = (Len & ETH_DMATxDesc_TBS1);
 
+	  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+		MyCfg->TxDescToSet->Status &= ~(ETH_DMATxDesc_TTSE|ETH_DMATxDesc_TTSS);
+		if (MyCfg->TxStampArm != 0) {				/* Armed by ETH_PTPtxArm()						*/
+			MyCfg->TxStampArm           = 0;
+			MyCfg->TxDescStamp          = MyCfg->TxDescToSet;
+			MyCfg->TxDescToSet->Status |= ETH_DMATxDesc_TTSE;
+		}
+	  #endif
+
 		MyCfg->TxDescToSet->Status |= ETH_DMATxDesc_OWN
 		                           |  ETH_DMATxDesc_IC
 		                           |  ETH_DMATxDesc_FS	/* Set first segment						*/
@@ -1126,6 +1178,18 @@ volatile uint32_t *Reg;
   #endif
 
 	MyCfg->TxDescToSet->Status &= ~(ETH_DMATxDesc_FS|ETH_DMATxDesc_LS|ETH_DMATxDesc_IC);
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	MyCfg->TxDescToSet->Status &= ~(ETH_DMATxDesc_TTSE|ETH_DMATxDesc_TTSS);
+	if (MyCfg->TxStampArm != 0) {
+		if (IsFirst != 0) {							/* The EMAC looks at TTSE in the first segment	*/
+			MyCfg->TxDescToSet->Status |= ETH_DMATxDesc_TTSE;
+		}											/* and writes the time stamp in the last one	*/
+		if (IsLast != 0) {
+			MyCfg->TxStampArm  = 0;
+			MyCfg->TxDescStamp = MyCfg->TxDescToSet;
+		}
+	}
+  #endif
 
 	if (IsFirst != 0) {
 		MyCfg->TxDescToStart = MyCfg->TxDescToSet;	/* Will be DMA owned when all programmed		*/
@@ -1184,6 +1248,75 @@ volatile uint32_t *Reg;
 	return(0);
 }
 
+/* ------------------------------------------------------------------------------------------------ */
+/* Attach a buffer and its pbuf to the next TX descriptor (ETH_BUFFER_PBUF)							*/
+/* Must be called once ETH_Get_Transmit_Buffer() reported the descriptor is free and before			*/
+/* ETH_Prepare_Multi_Transmit(). Buff == NULL puts back the descriptor own DMA buffer				*/
+/* Returns the pbuf previously attached to the descriptor (NULL if none), the caller releases it	*/
+/* ------------------------------------------------------------------------------------------------ */
+
+#if ((ETH_IS_BUF_PBUF) != 0)
+
+void *ETH_Set_Transmit_Buffer(int Dev, void *Buff, void *Pbuf)
+{
+EMACcfg_t     *MyCfg;								/* Configuration / state of this device			*/
+int            ReMap;
+void          *RetVal;
+
+	ReMap = G_EMACreMap[Dev];
+	MyCfg = &g_EMACcfg[ReMap];
+
+	if (Buff == NULL) {								/* Back to the static buffer of this descriptor	*/
+		Buff = &G_EthTXbuf[ReMap][MyCfg->TxDescToSet-MyCfg->TxDesc][0];
+	}
+
+	RetVal = MyCfg->TxDescToSet->PbufPtr;			/* Left by an unterminated packet or not yet	*/
+													/* reclaimed (ring full): hand it back			*/
+
+	MyCfg->TxDescToSet->Buff    = (uint32_t)Buff;
+	MyCfg->TxDescToSet->PbufPtr = Pbuf;
+													/* Prepare invalidates the descriptor			*/
+	DCacheFlushRange((void *)MyCfg->TxDescToSet, sizeof(*MyCfg->TxDescToSet));
+
+	return(RetVal);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Get back a pbuf the DMA is done transmitting (ETH_BUFFER_PBUF)									*/
+/* Returns NULL when none left, otherwise the caller releases the pbuf								*/
+/* ------------------------------------------------------------------------------------------------ */
+
+void *ETH_Reclaim_Transmit(int Dev)
+{
+EMACcfg_t     *MyCfg;								/* Configuration / state of this device			*/
+volatile ETH_DMAdesc_t *Desc;
+void          *RetVal;
+
+	MyCfg  = &g_EMACcfg[G_EMACreMap[Dev]];
+	RetVal = NULL;
+
+	for (Desc=MyCfg->TxDescToFree ; (RetVal == NULL) && (Desc != MyCfg->TxDescToSet) ; ) {
+		if (Desc == MyCfg->TxDescToStart) {			/* Packet not fully programmed yet				*/
+			break;
+		}
+		DCacheInvalRange((void *)Desc, sizeof(*Desc));	/* Make sure to get updated desc from DMA	*/
+		if ((Desc->Status & ETH_DMATxDesc_OWN) != 0) {	/* The DMA still using it, so are all the ones	*/
+			break;									/* after it										*/
+		}
+		RetVal = Desc->PbufPtr;
+		if (RetVal != NULL) {						/* Flushed as the pbuf must not be seen again	*/
+			Desc->PbufPtr = NULL;					/* after a later invalidate of the descriptor	*/
+			DCacheFlushRange((void *)Desc, sizeof(*Desc));
+		}
+		Desc = Desc->NextDesc;
+	}
+	MyCfg->TxDescToFree = Desc;
+
+	return(RetVal);
+}
+
+#endif
+
 /* ------------------------------------------------------------------------------------------------ */
 /* Init the RX DMA descriptor chain																	*/
 /* ------------------------------------------------------------------------------------------------ */
@@ -1272,6 +1405,13 @@ uint8_t       *TxBuff;
 
 	MyCfg->TXstate       = 0;						/* All OK, ready for a new packet				*/
 	MyCfg->TxDescToStart = NULL;					/* Tag the DMA does not own any descriptor		*/
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	MyCfg->TxStampArm    = 0;
+	MyCfg->TxDescStamp   = NULL;
+  #endif
+  #if ((ETH_IS_BUF_PBUF) != 0)						/* Pbufs still attached are returned by			*/
+	MyCfg->TxDescToFree  = MyCfg->TxDesc;			/* ETH_Set_Transmit_Buffer() when reused		*/
+  #endif
 
 	return;
 }
@@ -1355,6 +1495,224 @@ int ii;
 	return;
 }
 
+/* ------------------------------------------------------------------------------------------------ */
+/* ------------------------------------------------------------------------------------------------ */
+/* IEEE 1588 time stamping																			*/
+/*																									*/
+/* The system time counts nanoseconds (digital rollover) and is updated with the fine method: at	*/
+/* each ETH_PTP_REF_CLK cycle the addend is accumulated and every overflow of the 32 bit			*/
+/* accumulator adds SUBSEC_INC ns, so the rate of the clock is trimmed through the addend.			*/
+/* Every frame received is time stamped, only the armed ones when transmitted.						*/
+/* The time stamps are in the (enhanced) DMA descriptors, written back by the DMA.					*/
+/* ------------------------------------------------------------------------------------------------ */
+
+#ifdef USE_ENHANCED_DMA_DESCRIPTORS
+
+static int ETH_PTPwait(volatile uint32_t *Reg, uint32_t Bit)
+{
+int ii;
+
+	for (ii=1000 ; ii>0 ; ii--) {					/* The EMAC clears the bit once the update is	*/
+		if ((Reg[EMAC_TS_CTL_REG] & Bit) == 0) {	/* done, a few reference clock cycles later		*/
+			return(0);
+		}
+		uDelay(1);
+	}
+
+	return(-1);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Start the system time at 0 and the time stamping of the frames									*/
+/* To call once the device is initialized: ETH_MacConfigDMA() resets the time stamping unit			*/
+/* Returns 0 when OK, -1 when the EMAC did not take the settings									*/
+/* ------------------------------------------------------------------------------------------------ */
+
+int ETH_PTPinit(int Dev)
+{
+EMACcfg_t         *MyCfg;							/* Configuration / state of this device			*/
+volatile uint32_t *Reg;								/* uint32_t pointer to access EMAC registers	*/
+uint32_t           SubSec;							/* ns added at each overflow of the accumulator	*/
+
+	MyCfg = &g_EMACcfg[G_EMACreMap[Dev]];
+	Reg   = MyCfg->HW;
+
+	SubSec = 2000000000U / (ETH_PTP_REF_CLK);		/* Twice the reference clock period: overflows	*/
+													/* every other cycle, at the nominal addend		*/
+
+													/* Fine update, nanoseconds roll over at 10^9	*/
+													/* and every frame received is time stamped		*/
+	Reg[EMAC_TS_CTL_REG]        = EMAC_TS_CTL_TSENA
+	                            | EMAC_TS_CTL_TSCFUPDT
+	                            | EMAC_TS_CTL_TSCTRLSSR
+	                            | EMAC_TS_CTL_TSENALL;
+	Reg[EMAC_TS_SUBSEC_INC_REG] = SubSec;
+
+	MyCfg->PTPaddend            = (uint32_t)((1000000000ULL << 32)
+	                            / ((uint64_t)SubSec * (ETH_PTP_REF_CLK)));
+	Reg[EMAC_TS_ADDEND_REG]     = MyCfg->PTPaddend;
+	Reg[EMAC_TS_CTL_REG]       |= EMAC_TS_CTL_TSADDREG;
+	if (ETH_PTPwait(Reg, EMAC_TS_CTL_TSADDREG) != 0) {
+		MyCfg->PTPaddend = 0;
+		return(-1);
+	}
+
+	Reg[EMAC_TS_SEC_UPD_REG]    = 0;
+	Reg[EMAC_TS_NSEC_UPD_REG]   = 0;
+	Reg[EMAC_TS_CTL_REG]       |= EMAC_TS_CTL_TSINIT;
+	if (ETH_PTPwait(Reg, EMAC_TS_CTL_TSINIT) != 0) {
+		MyCfg->PTPaddend = 0;
+		return(-1);
+	}
+
+	return(0);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Read the system time																				*/
+/* Only reads registers: can be used on any core and in interrupts									*/
+/* ------------------------------------------------------------------------------------------------ */
+
+void ETH_PTPgetTime(int Dev, uint32_t *Sec, uint32_t *Nsec)
+{
+volatile uint32_t *Reg;								/* uint32_t pointer to access EMAC registers	*/
+uint32_t           Sec2;
+
+	Reg = g_EMACcfg[G_EMACreMap[Dev]].HW;
+
+	do {											/* Read again if the seconds rolled over in		*/
+		*Sec  = Reg[EMAC_TS_SEC_REG];				/* between										*/
+		*Nsec = Reg[EMAC_TS_NSEC_REG];
+		Sec2  = Reg[EMAC_TS_SEC_REG];
+	} while (*Sec != Sec2);
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Step the system time by Nsec nanoseconds (negative goes back in time)							*/
+/* Returns 0 when OK, -1 when the EMAC did not take the update										*/
+/* ------------------------------------------------------------------------------------------------ */
+
+int ETH_PTPstep(int Dev, int64_t Nsec)
+{
+volatile uint32_t *Reg;								/* uint32_t pointer to access EMAC registers	*/
+uint64_t           Mag;
+uint32_t           Ns;
+
+	Reg = g_EMACcfg[G_EMACreMap[Dev]].HW;
+	Mag = (Nsec < 0) ? (uint64_t)(-Nsec) : (uint64_t)Nsec;
+	Ns  = (uint32_t)(Mag % 1000000000U);
+
+	Reg[EMAC_TS_SEC_UPD_REG] = (uint32_t)(Mag / 1000000000U);
+	if (Nsec < 0) {
+		if (Ns != 0) {								/* With the digital rollover, a subtraction is	*/
+			Ns = 1000000000U - Ns;					/* programmed as 10^9 - ns						*/
+		}
+		Ns |= EMAC_TS_NSEC_UPD_ADDSUB;
+	}
+	Reg[EMAC_TS_NSEC_UPD_REG] = Ns;
+	Reg[EMAC_TS_CTL_REG]     |= EMAC_TS_CTL_TSUPDT;
+
+	return(ETH_PTPwait(Reg, EMAC_TS_CTL_TSUPDT));
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Trim the rate of the system time: Ppb parts per billion faster (negative: slower)				*/
+/* The correction is from the nominal rate, not cumulative											*/
+/* ------------------------------------------------------------------------------------------------ */
+
+void ETH_PTPadjFreq(int Dev, int32_t Ppb)
+{
+EMACcfg_t         *MyCfg;							/* Configuration / state of this device			*/
+volatile uint32_t *Reg;								/* uint32_t pointer to access EMAC registers	*/
+
+	MyCfg = &g_EMACcfg[G_EMACreMap[Dev]];
+	Reg   = MyCfg->HW;
+
+	if (MyCfg->PTPaddend != 0) {					/* ETH_PTPinit() not done or failed				*/
+		Reg[EMAC_TS_ADDEND_REG] = MyCfg->PTPaddend
+		                        + (int32_t)(((int64_t)MyCfg->PTPaddend * Ppb) / 1000000000);
+		Reg[EMAC_TS_CTL_REG]   |= EMAC_TS_CTL_TSADDREG;
+		ETH_PTPwait(Reg, EMAC_TS_CTL_TSADDREG);
+	}
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Time stamp the next frame given to ETH_Prepare_Transmit_Descriptors() or							*/
+/* ETH_Prepare_Multi_Transmit(), called with the same protection as them							*/
+/* ------------------------------------------------------------------------------------------------ */
+
+void ETH_PTPtxArm(int Dev)
+{
+	g_EMACcfg[G_EMACreMap[Dev]].TxStampArm = 1;
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Time of transmission of the frame armed with ETH_PTPtxArm()										*/
+/* To call before ETH_N_TXBUF more frames are transmitted, as the descriptor is then reused			*/
+/* Returns  0 when the time is in *Sec & *Nsec														*/
+/*          1 when the frame is not transmitted yet													*/
+/*         -1 when no frame was armed or it was not time stamped									*/
+/* ------------------------------------------------------------------------------------------------ */
+
+int ETH_PTPtxStamp(int Dev, uint32_t *Sec, uint32_t *Nsec)
+{
+EMACcfg_t              *MyCfg;						/* Configuration / state of this device			*/
+volatile ETH_DMAdesc_t *Desc;
+
+	MyCfg = &g_EMACcfg[G_EMACreMap[Dev]];
+	Desc  = MyCfg->TxDescStamp;
+
+	if (Desc == NULL) {
+		return(-1);
+	}
+
+  #if ((ETH_IS_BUF_CACHED) != 0)					/* Make sure to get updated desc from DMA		*/
+	DCacheInvalRange((void *)Desc, sizeof(*Desc));
+  #endif
+
+	if ((Desc->Status & ETH_DMATxDesc_OWN) != 0) {	/* The DMA still using it						*/
+		return(1);
+	}
+
+	MyCfg->TxDescStamp = NULL;
+	if ((Desc->Status & ETH_DMATxDesc_TTSS) == 0) {
+		return(-1);
+	}
+	*Sec  = Desc->TimeStampHigh;
+	*Nsec = Desc->TimeStampLow;
+
+	return(0);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Time of reception of the last packet extracted with ETH_Get_Received_Multi()						*/
+/* Returns 0 when the time is in *Sec & *Nsec, -1 when the packet was not time stamped				*/
+/* ------------------------------------------------------------------------------------------------ */
+
+int ETH_PTPrxStamp(int Dev, uint32_t *Sec, uint32_t *Nsec)
+{
+EMACcfg_t *MyCfg;									/* Configuration / state of this device			*/
+
+	MyCfg = &g_EMACcfg[G_EMACreMap[Dev]];
+
+	if (MyCfg->RxStamped == 0) {
+		return(-1);
+	}
+	*Sec  = MyCfg->RxStampSec;
+	*Nsec = MyCfg->RxStampNsec;
+
+	return(0);
+}
+
+#endif
+
+
 /* ------------------------------------------------------------------------------------------------ */
 /* ------------------------------------------------------------------------------------------------ */
 /* ------------------------------------------------------------------------------------------------ */
@@ -3013,6 +3371,9 @@ int                ReMap;
   #endif
 
 	EMAC_RESET(Dev);								/* Reset this EMAC device						*/
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	MyCfg->PTPaddend = 0;							/* The time stamping unit is reset too			*/
+  #endif
 
 	uDelay(PHY_RESET_DELAY);						/* Small delay to allow it to start-up			*/
 
@@ -301,6 +301,9 @@ void PrtAddr(char *Str, u32_t Addr);
 							*(Nread) = 0;															\
 						}
   #define F_PATCH_OPEN(F_Dsc)					do {(F_Dsc)->index = 0;} while(0)
+  #define F_INFO(F_Dsc, F_Name, Size, Stamp)	do {*(Size)=(F_Dsc)->len; *(Stamp)=0U;} while(0)
+  #define F_DATA(F_Dsc)							((const void *)(F_Dsc)->data)
+  #define F_HDR(F_Dsc)							((F_Dsc)->http_header_included)
 #endif
 
 /* ------------------------------------------------------------------------------------------------ */
@@ -317,13 +320,22 @@ void PrtAddr(char *Str, u32_t Addr);
   #define F_CLOSE(F_Dsc)						f_close(&(F_Dsc))
   #define F_READ(F_Dsc, Buf, BufSize, Nrd)  	f_read(&(F_Dsc),(void *)(Buf),(BufSize),(UINT *)(Nrd))
   #define F_PATCH_OPEN(F_Dsc)					do{int _=0;_=_;}while(0)
+  #define F_INFO(F_Dsc, F_Name, Size, Stamp)														\
+						do {FILINFO _Finfo;															\
+							*(Size)  = (int)f_size(&(F_Dsc));										\
+							*(Stamp) = (FR_OK == f_stat((F_Name), &_Finfo))							\
+							         ? ((((uint32_t)_Finfo.fdate)<<16) | _Finfo.ftime) : 0U;		\
+						} while(0)
+  #define F_DATA(F_Dsc)							NULL
+  #define F_HDR(F_Dsc)							0
 #endif
 
 /* ------------------------------------------------------------------------------------------------ */
 /* Uses System Layer call for standard UNIX style I/O API											*/
 
-#if (((((OS_DEMO) >=  14) && ((OS_DEMO) <=   19)) ||  ((OS_DEMO) >=  114) && ((OS_DEMO) <=  119))	\
- ||  ((((OS_DEMO) <= -14) && ((OS_DEMO) >= -119)) ||  ((OS_DEMO) <= -114) && ((OS_DEMO) >= -119)))
+#if ((((((OS_DEMO) >=  14) && ((OS_DEMO) <=   19)) ||  ((OS_DEMO) >=  114) && ((OS_DEMO) <=  119))	\
+ ||   ((((OS_DEMO) <= -14) && ((OS_DEMO) >= -119)) ||  ((OS_DEMO) <= -114) && ((OS_DEMO) >= -119)))	\
+ &&  (!defined(WEBS_FILE_FD) || ((WEBS_FILE_FD) == 0)))
   #include "SysCall.h"								/* File systen accessed with system call layer	*/
   typedef FILE *FILE_DSC_t;
 
@@ -333,6 +345,47 @@ void PrtAddr(char *Str, u32_t Addr);
   #define F_CLOSE(F_Dsc)						fclose((F_Dsc))
   #define F_READ(F_Dsc, Buf, BufSize, Nread)	(*(Nread))=fread((void *)(Buf),1,(BufSize),(F_Dsc))
   #define F_PATCH_OPEN(F_Dsc)					do{int _=0;_=_;}while(0)
+  #define F_INFO(F_Dsc, F_Name, Size, Stamp)														\
+						do {struct stat _Finfo;														\
+							*(Size)  = -1;															\
+							*(Stamp) = 0U;															\
+							if (0 == stat((F_Name), &_Finfo)) {										\
+								*(Size)  = (int)_Finfo.st_size;										\
+								*(Stamp) = (uint32_t)_Finfo.st_mtime;								\
+							}																		\
+						} while(0)
+  #define F_DATA(F_Dsc)							NULL
+  #define F_HDR(F_Dsc)							0
+#endif
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Uses System Layer call with file descriptors, for an application not built as a web demo that	*/
+/* mounts the file system itself: set WEBS_FILE_FD to non-zero										*/
+
+#if (defined(WEBS_FILE_FD) && ((WEBS_FILE_FD) != 0))
+  #include "SysCall.h"								/* File systen accessed with system call layer	*/
+  typedef int FILE_DSC_t;
+
+  #define F_INIT_FDSC(x)						((x)=-1)
+  #define F_MNT()								0	/* The application mounts the file system		*/
+  #define F_OPEN(F_Dsc, F_Name)					(0 <= ((F_Dsc) = open((F_Name), O_RDONLY, 0)))
+  #define F_CLOSE(F_Dsc)						close((F_Dsc))
+  #define F_READ(F_Dsc, Buf, BufSize, Nread)														\
+						if (0 > (*(Nread)=read((F_Dsc), (void *)(Buf), (BufSize)))) {				\
+							*(Nread) = 0;															\
+						}
+  #define F_PATCH_OPEN(F_Dsc)					do{int _=0;_=_;}while(0)
+  #define F_INFO(F_Dsc, F_Name, Size, Stamp)														\
+						do {struct stat _Finfo;														\
+							*(Size)  = -1;															\
+							*(Stamp) = 0U;															\
+							if (0 == fstat((F_Dsc), &_Finfo)) {										\
+								*(Size)  = (int)_Finfo.st_size;										\
+								*(Stamp) = (uint32_t)_Finfo.st_mtime;								\
+							}																		\
+						} while(0)
+  #define F_DATA(F_Dsc)							NULL
+  #define F_HDR(F_Dsc)							0
 #endif
 
 #ifdef __cplusplus
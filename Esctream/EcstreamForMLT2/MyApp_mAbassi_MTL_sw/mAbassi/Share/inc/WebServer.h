@@ -58,6 +58,7 @@
 
 typedef uint16_t    (*SSIhandler_t)(int Index, char *Insert, int InsertLen);
 typedef const char *(*CGIhandler_t)(int NumParams, char *Param[], char *Value[]);
+typedef int         (*PAGEhandler_t)(char *Buf, int Size);	/* Returns the page length, < 0 on error	*/
 
 /* ------------------------------------------------------------------------------------------------ */
 /* File system used (needed by the SSI #include directive)											*/
@@ -75,6 +76,7 @@ char *CGIprocess(char *buf);
 int   CGInewHandler(const char *Fname, const CGIhandler_t Handler);
 void  http_server_init(void);
 void  LCDputs(char *Line_1, char *Line_2);
+int   PAGEnewHandler(const char *Fname, const PAGEhandler_t Handler);
 void  POSTinit(void);
 int   POSTnewHandler(const char *Fname, const CGIhandler_t Handler);
 char *POSTprocess(char *uri, char *Data);
@@ -87,6 +89,8 @@ int   SSInewVar(const char *Name, char *Value, char *(*Command)(char *, int));
 int   SSIvarUpdate(void);
 void  WebServerInit(void);
 
+PAGEhandler_t PAGEfind(const char *URI);
+
 #if ((OS_PLATFORM) == 0x1032F407)
   void ETH_BSP_Config(void);
 #endif
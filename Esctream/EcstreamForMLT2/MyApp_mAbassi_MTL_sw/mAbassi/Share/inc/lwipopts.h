@@ -292,14 +292,10 @@
 #endif
 
 #ifndef MEMP_NUM_PBUF							/* Alike PBUF_POOL_SIZE but this defines it for		*/
- #ifdef _STANDALONE_							/* set to != 1 to add exclusive access			*/
-  #if LWIP_LOTS_OF_MEMORY						/* pBuf located in ROM / read-only memory			*/
-   #define MEMP_NUM_PBUF				(512)
-  #else
-   #define MEMP_NUM_PBUF				(16)
-  #endif
- #else
-  #define MEMP_NUM_PBUF					0
+ #if LWIP_LOTS_OF_MEMORY						/* pBuf located in ROM / read-only memory			*/
+  #define MEMP_NUM_PBUF				(512)		/* Needed by NETCONN_NOCOPY and netbuf_ref(): one	*/
+ #else											/* per TCP segment / datagram pointing to the data	*/
+  #define MEMP_NUM_PBUF				(16)
  #endif
 #endif
 
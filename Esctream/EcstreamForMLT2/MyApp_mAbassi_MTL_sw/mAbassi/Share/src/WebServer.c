@@ -58,6 +58,10 @@
   #define WEBS_MAX_CGI_POST_PARAM	-1				/* Maximum number of Param=Value in a request	*/
 #endif												/* <= 0 uses dynamic memory allocation			*/
 
+#ifndef WEBS_MAX_PAGE
+  #define WEBS_MAX_PAGE				-1				/* Maximum number of generated pages		*/
+#endif												/* <= 0 uses dynamic memory allocation		*/
+
 #ifndef WEBS_MAX_SSI
   #define WEBS_MAX_SSI				-1				/* Maximum number of SSI update functions		*/
 #endif												/* <= 0 uses dynamic memory allocation			*/
@@ -147,6 +151,18 @@ int    g_nCGIspec;									/* Number of CGIs attached						*/
 #endif
 int    g_nPOSTspec;									/* Number of POSTs attached						*/
 
+typedef struct {
+    const char   *Name;
+    PAGEhandler_t Handler;
+} PAGE_t;
+
+#if ((WEBS_MAX_PAGE) > 0)
+  PAGE_t  g_PAGEspec[WEBS_MAX_PAGE];				/* Specifications on the generated pages	*/
+#else
+  PAGE_t  *g_PAGEspec;								/* Specifications on the generated pages	*/
+#endif
+int    g_nPAGEspec;									/* Number of pages attached					*/
+
 #if ((WEBS_MAX_SSI) > 0)
   void  (*g_SSIupdateFct[WEBS_MAX_SSI])(void);
 #else
@@ -173,6 +189,7 @@ void WebServerInit(void)
 
 	g_nCGIspec  = 0;								/* Number of CGIs handlers						*/
 	g_nPOSTspec = 0;								/* Number of POSTs handlers						*/
+	g_nPAGEspec = 0;								/* Number of page generators				*/
 	g_nSSIupd   = 0; 								/* Number of SSI updaters						*/
 
   #if ((WEBS_MAX_CGI_POST_PARAM) <= 0)
@@ -186,6 +203,9 @@ void WebServerInit(void)
   #if ((WEBS_MAX_POST) <= 0)
 	g_POSTspec = NULL;
   #endif
+  #if ((WEBS_MAX_PAGE) <= 0)
+	g_PAGEspec = NULL;
+  #endif
   #if ((WEBS_MAX_VARIABLE) > 0)
 	for (ii=0 ; ii<WEBS_MAX_VARIABLE ; ii++) {
 		g_MyVars[ii].VarName[0] = '\0';
@@ -908,6 +928,63 @@ int RetVal;
 	return(RetVal);
 }
 
+/* ------------------------------------------------------------------------------------------------ */
+/* Attach a page generator																			*/
+/*																									*/
+/* Memo in g_PAGEspec[] the page name & function writing the contents of that page. The page is		*/
+/* served as if it was a file with that name: the extension sets its Content-Type					*/
+/* ------------------------------------------------------------------------------------------------ */
+
+int PAGEnewHandler(const char *Fname, const PAGEhandler_t Handler)
+{
+int RetVal;
+
+  #if ((WEBS_MAX_PAGE) <= 0)
+	WEBS_LOCK_ALLOC();
+	g_PAGEspec = realloc(g_PAGEspec, (g_nPAGEspec+1)*sizeof(*g_PAGEspec));
+	WEBS_UNLOCK_ALLOC();
+	if (g_PAGEspec != NULL) {
+  #else
+	if (g_nPAGEspec < WEBS_MAX_PAGE) {				/* Room left, memo the page specifications	*/
+  #endif
+		g_PAGEspec[g_nPAGEspec].Name    = Fname;
+		g_PAGEspec[g_nPAGEspec].Handler = Handler;
+		RetVal = g_nPAGEspec++;						/* One more page							*/
+	}
+	else {											/* No more room to memo the pages			*/
+	  #if ((WEBS_DEBUG) != 0)
+		WEBS_LOCK_STDIO();
+		puts("WEBS  - Error - Too many pages attached");
+		WEBS_UNLOCK_STDIO();
+	  #endif
+		RetVal = -1;
+	}
+
+	return(RetVal);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Find the generator of a page																		*/
+/*																									*/
+/* The URI may hold parameters (after '?'), they are not part of the page name						*/
+/* ------------------------------------------------------------------------------------------------ */
+
+PAGEhandler_t PAGEfind(const char *URI)
+{
+int ii;
+int Len;
+
+	Len = strcspn(URI, "? ");
+	for (ii=0 ; ii<g_nPAGEspec ; ii++) {
+		if ((0 == strncmp(URI, g_PAGEspec[ii].Name, Len))
+		&&  (g_PAGEspec[ii].Name[Len] == '\0')) {
+			return(g_PAGEspec[ii].Handler);
+		}
+	}
+
+	return((PAGEhandler_t)NULL);
+}
+
 /* ------------------------------------------------------------------------------------------------ */
 /* Attach a new SSI variable update handler															*/
 /*																									*/
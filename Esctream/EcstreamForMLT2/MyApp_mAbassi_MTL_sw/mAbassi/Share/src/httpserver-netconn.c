@@ -36,21 +36,167 @@ struct Methods {									/* Association of text to verbs					*/
 	enum VerbTypes Verb;
 };
 
+struct MimeTypes {								/* Content-Type from the file extension				*/
+	char *Ext;
+	char *Type;
+};
+
 /* ------------------------------------------------------------------------------------------------ */
+/* Files are written with NETCONN_NOCOPY: the TCP segments point straight into the file cache or	*/
+/* into the stream buffers, which are only reused once the client has acknowledged the data.		*/
+/* The listening task hands the accepted connections to HTTP_N_WORKER worker tasks through a		*/
+/* mailbox of HTTP_QUEUE_SIZE entries; when it is full, the connection is refused with a 503.		*/
+/* A worker serves the requests of a connection one after the other (keep-alive, pipelining) until	*/
+/* the client closes it, is idle for HTTP_KEEPALIVE_TOUT ms or made HTTP_KEEPALIVE_MAX requests.	*/
+/* A page generated by the application (see PAGEnewHandler()) is streamed as server-sent events		*/
+/* when asked with "?stream[=ms]" or "Accept: text/event-stream": the worker stays with that		*/
+/* client until it goes away, so HTTP_N_WORKER bounds the number of streams.						*/
+
+#ifndef HTTP_N_WORKER
+ #if LWIP_LOTS_OF_MEMORY
+  #define HTTP_N_WORKER						3	/* Number of tasks serving the connections			*/
+ #else
+  #define HTTP_N_WORKER						1
+ #endif
+#endif
+#ifndef HTTP_QUEUE_SIZE
+  #define HTTP_QUEUE_SIZE						8	/* Connections waiting for a worker				*/
+#endif
+#ifndef HTTP_CORE
+  #define HTTP_CORE							(-1)	/* Core running the server tasks, -ve: any core	*/
+#endif
+#ifndef HTTP_KEEPALIVE_TOUT
+  #define HTTP_KEEPALIVE_TOUT					5000	/* ms a connection waits for the next request	*/
+#endif
+#ifndef HTTP_KEEPALIVE_MAX
+  #define HTTP_KEEPALIVE_MAX					100	/* Requests served before closing a connection	*/
+#endif
+#ifndef HTTP_BUF_SIZE
+  #define HTTP_BUF_SIZE						32768	/* Out larger than in for SSI processing		*/
+#endif
+#ifndef HTTP_RQST_SIZE
+  #define HTTP_RQST_SIZE						8192	/* Largest request, with the pipelined ones held	*/
+#endif
+#ifndef HTTP_FCACHE_N
+  #define HTTP_FCACHE_N						8	/* Number of files held in the file cache			*/
+#endif											/* 0 streams every file from the file system		*/
+#ifndef HTTP_FCACHE_FSIZE
+  #define HTTP_FCACHE_FSIZE					(128*1024)	/* Largest file held in the cache (bytes)	*/
+#endif											/* Larger files are streamed						*/
+#ifndef HTTP_FCACHE_NAME
+  #define HTTP_FCACHE_NAME					64	/* Longest name (with the path) of a cached file	*/
+#endif
+#ifndef HTTP_STREAM_SIZE
+  #define HTTP_STREAM_SIZE					(TCP_SND_BUF)	/* Chunk read from a streamed file: a full TCP	*/
+#endif											/* send buffer, with 2 chunks in flight				*/
+#ifndef HTTP_ACK_TOUT
+  #define HTTP_ACK_TOUT						OS_MS_TO_TICK(10000)	/* A client not acknowledging the data for	*/
+#endif											/* that long has its connection aborted				*/
+#ifndef HTTP_ACK_POLL
+  #define HTTP_ACK_POLL						100	/* ms between reads of lastack when the ACKs		*/
+#endif											/* raise no sent event (below TCP_SNDLOWAT)			*/
+
+#ifndef HTTP_SSE_PERIOD
+  #define HTTP_SSE_PERIOD					1000	/* ms between the events of a page stream		*/
+#endif
+#ifndef HTTP_SSE_MIN
+  #define HTTP_SSE_MIN						100	/* Shortest period a client can ask for (ms)		*/
+#endif
 
-static void WebserverProcess(struct netconn *conn); 
-static void WebserverTask(void *Arg);
+#define HTTP_PAGE_SIZE							4096	/* Alignment of the cache and stream buffers	*/
 
 /* ------------------------------------------------------------------------------------------------ */
-													/* Out larger than in for SSI processing		*/
-#ifndef HTTP_BUF_SIZE
-  static char g_PageInBuf[32768-2048];				/* Buffer holding input data when manipulated	*/
-  static char g_PageOutBuf[32768];					/* Buffer holding output data when manipulated	*/
-#else
-  static char g_PageInBuf[HTTP_BUF_SIZE-2048];
-  static char g_PageOutBuf[HTTP_BUF_SIZE];
+
+typedef struct {								/* File held in the file cache						*/
+	char     Name[HTTP_FCACHE_NAME];			/* Name as requested								*/
+	int      Size;								/* Bytes in the file, -1 when the entry is unused	*/
+	uint32_t Stamp;								/* Modification time when it was read				*/
+	int      Users;								/* Connections with data not yet acknowledged		*/
+	uint32_t LastUse;							/* Tick count of the last request (LRU eviction)	*/
+} FCache_t;
+
+typedef struct {								/* Buffers of a worker task							*/
+	char StreamBuf[2][HTTP_STREAM_SIZE]			/* Chunks of a streamed file						*/
+	     __attribute__ ((aligned (HTTP_PAGE_SIZE)));
+	char PageInBuf[HTTP_BUF_SIZE-2048];			/* Input data when manipulated						*/
+	char PageOutBuf[HTTP_BUF_SIZE];				/* Output data when manipulated						*/
+	char RqstBuf[HTTP_RQST_SIZE];				/* Data received and not yet served					*/
+	int  RqstLen;								/* Number of bytes in RqstBuf[]						*/
+	int  Trunc;									/* Data was dropped as RqstBuf[] was full			*/
+	struct netconn *SeqConn;					/* TcpSeq() request to the tcpip thread:			*/
+	u32_t           SeqAcked;					/* the pcb is only looked at in that thread			*/
+	u32_t           SeqQueued;
+	int             SeqGone;
+	sys_sem_t       SeqSem;
+	struct netconn *AckConn;					/* Connection served, for ConnEvent()				*/
+	volatile int    AckWait;					/* Set while WaitAcked() waits for AckSem			*/
+	sys_sem_t       AckSem;						/* Signaled by ConnEvent() on sent / error events	*/
+} HttpWrk_t;
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static void        AbortConn(void *Arg);
+static void        ConnAbort(struct netconn *conn);
+static void        ConnEvent(struct netconn *conn, enum netconn_evt Evt, u16_t Len);
+static void        SeqRead(void *Arg);
+static void        ConnServe(HttpWrk_t *Wrk, struct netconn *conn);
+#if ((HTTP_FCACHE_N) > 0)
+  static int       FCacheGet(FILE_DSC_t *Fdsc, const char *Name, int Size, uint32_t Stamp);
+#endif
+static int         FileSend(HttpWrk_t *Wrk, struct netconn *conn, FILE_DSC_t *Fdsc, const char *Name,
+                            int Code, int Keep);
+static const char *HdrFind(const char *Rqst, const char *Name);
+static int         HdrSend(struct netconn *conn, int Code, const char *Name, int Size, int Keep);
+static int         PageStream(HttpWrk_t *Wrk, struct netconn *conn, PAGEhandler_t Page, int Period);
+static int         RqstEnd(const char *Rqst, int Len);
+static int         RqstKeep(const char *Rqst);
+static int         TcpSeq(HttpWrk_t *Wrk, struct netconn *conn, u32_t *Acked, u32_t *Queued);
+static int         WaitAcked(HttpWrk_t *Wrk, struct netconn *conn, u32_t Seq);
+static int         WebserverProcess(HttpWrk_t *Wrk, struct netconn *conn, int Len, int Keep);
+static void        WebserverTask(void *Arg);
+static void        WorkerTask(void *Arg);
+static err_t       WriteNoCopy(HttpWrk_t *Wrk, struct netconn *conn, const void *Data, int Len,
+                               u32_t *Seq);
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static HttpWrk_t   g_Wrk[HTTP_N_WORKER];		/* Buffers of the worker tasks						*/
+static sys_mbox_t  g_ConnMbx;					/* Accepted connections waiting for a worker		*/
+static sys_mutex_t g_ConnMtx;					/* The mailbox has a single reader: one worker at a	*/
+												/* time waits on it									*/
+static sys_mutex_t g_WebSrvMtx;					/* CGIs, POSTs and SSIs are not reentrant			*/
+
+#if ((HTTP_FCACHE_N) > 0)
+  static FCache_t    g_FCache[HTTP_FCACHE_N];	/* File cache entries and their data				*/
+  static char        g_FCdata[HTTP_FCACHE_N][HTTP_FCACHE_FSIZE] __attribute__ ((aligned (HTTP_PAGE_SIZE)));
+  static sys_mutex_t g_FCacheMtx;				/* Protects g_FCache[]								*/
 #endif
-static char g_RqstBuf[8192];						/* Buffer holding the request string			*/
+
+static const char g_Busy[] = "HTTP/1.1 503 Service Unavailable\r\n"	/* Sent when all workers are busy and the	*/
+                             "Retry-After: 1\r\n"	/* mailbox of connections is full				*/
+                             "Content-Length: 0\r\n"
+                             "Connection: close\r\n\r\n";
+static const char g_SSEhdr[] = "HTTP/1.1 200 OK\r\n"	/* Header of a page stream					*/
+                               "Content-Type: text/event-stream\r\n"
+                               "Cache-Control: no-cache\r\n"
+                               "Connection: close\r\n\r\n";
+
+static struct MimeTypes g_MyTypes[] = {			/* Association of extensions to Content-Types		*/
+	{".html",  "text/html"},
+	{".htm",   "text/html"},
+	{".shtml", "text/html"},
+	{".shtm",  "text/html"},
+	{".stm",   "text/html"},
+	{".css",   "text/css"},
+	{".js",    "application/javascript"},
+	{".json",  "application/json"},
+	{".txt",   "text/plain"},
+	{".png",   "image/png"},
+	{".jpg",   "image/jpeg"},
+	{".gif",   "image/gif"},
+	{".bmp",   "image/bmp"},
+	{".ico",   "image/x-icon"}
+};
 
 static struct Methods g_MyVerbs[] = {				/* Association of text to verbs					*/
 	{"GET ",     V_GET},
@@ -109,12 +255,13 @@ void http_server_init()
 /*																									*/
 /* - Create a new TCP connection																	*/
 /* - Init the CGIs and SSIs																			*/
+/* - Create the worker tasks																		*/
 /* - Bind the network connection to port 80															*/
 /* - Start listening on the connection																*/
 /* - forever loop																					*/
 /*   - Block until a new connection with the client is established									*/
-/*   - Process the client request																	*/
-/*   - Delete the new connection																	*/
+/*   - Hand it to the worker tasks (see WorkerTask())												*/
+/*   - If none can take it, refuse it with a 503 and delete the connection							*/
 /* ------------------------------------------------------------------------------------------------ */
 
 static void WebserverTask(void *Arg)
@@ -128,8 +275,24 @@ int             NetErr;
 
 	Arg = Arg;										/* To remove compiler warning					*/
 
+  #if (defined(TSKsetCore) && ((HTTP_CORE) >= 0))
+	TSKsetCore(TSKmyID(), HTTP_CORE);			/* Keep the server off the application cores		*/
+  #endif
+
 	WebServerInit();
 
+	sys_mutex_new(&g_WebSrvMtx);
+	sys_mbox_new(&g_ConnMbx, HTTP_QUEUE_SIZE);
+	sys_mutex_new(&g_ConnMtx);
+
+  #if ((HTTP_FCACHE_N) > 0)
+	sys_mutex_new(&g_FCacheMtx);
+	for (ii=0 ; ii<HTTP_FCACHE_N ; ii++) {		/* Nothing cached yet								*/
+		g_FCache[ii].Size  = -1;
+		g_FCache[ii].Users = 0;
+	}
+  #endif
+
   #if (((OS_DEMO) == 12) || ((OS_DEMO) == 112) || ((OS_DEMO) == -12) || ((OS_DEMO) == -112))
 	memset(&g_FileSys, 0, sizeof(g_FileSys));
   #endif
@@ -171,7 +334,11 @@ int             NetErr;
 	osSignalSet(G_TaskMainID, 2);
   #endif
 
-	Conn = netconn_new(NETCONN_TCP);				/* Create a new TCP connection handle			*/
+	for (ii=0 ; ii<HTTP_N_WORKER ; ii++) {		/* The workers serve the connections				*/
+		sys_thread_new("HTTP worker", WorkerTask, &g_Wrk[ii], WEBS_STACKSIZE, WEBS_PRIO);
+	}
+
+	Conn = netconn_new_with_callback(NETCONN_TCP, ConnEvent);	/* Accepted ones inherit it			*/
 	if (Conn != NULL) {
 
 		Error = netconn_bind(Conn, NULL, 80);		/* Bind to port 80 (HTTP) with default IP addr	*/
@@ -183,8 +350,11 @@ int             NetErr;
 			while(1) {								/* And we go on forever							*/
 				NetErr = netconn_accept(Conn, &NewConn);	/* Accept any incoming connection		*/
 				if (NetErr == ERR_OK) {
-					WebserverProcess(NewConn);		/* Serve the connection							*/
-					netconn_delete(NewConn);		/* Delete connection							*/
+					if (ERR_OK != sys_mbox_trypost(&g_ConnMbx, NewConn)) {	/* Workers busy & queue full	*/
+						netconn_write(NewConn, &g_Busy[0], sizeof(g_Busy)-1, NETCONN_NOCOPY);	/* Shed	*/
+						netconn_close(NewConn);
+						netconn_delete(NewConn);
+					}
 				}
 			}
 		}
@@ -208,13 +378,18 @@ int             NetErr;
 }
 
 /* ------------------------------------------------------------------------------------------------ */
-/* Process a client request																			*/
+/* Process a client request held in Wrk->RqstBuf[] ('\0' terminated, Len bytes)						*/
 /*																									*/
-/* - Get the request																				*/
+/* Return: non-zero if the connection can be kept open for the next request							*/
+/*																									*/
+/* - Isolate the request																			*/
 /* - Find the request verb/method																	*/
 /* - Per Verb processing																			*/
 /*																									*/
 /*   - GET verb:																					*/
+/*     - If the page is generated by the application												*/
+/*       - Stream it if asked to (see PageStream()), the connection is then closed					*/
+/*       - else request to output what the generator wrote											*/
 /*     - Open the requested file																	*/
 /*     - if file opening OK																			*/
 /*       - if file extension .stm or .shtm or .shtml												*/
@@ -235,28 +410,30 @@ int             NetErr;
 /*       - else																						*/
 /*         - Try to mount the file system															*/
 /*     - If request to output file																	*/
-/*       - Copy file to output																		*/
+/*       - Send the file from the file cache or streamed (see FileSend())							*/
 /*     - If request to output buffer																*/
-/*       - Copy buffer to output																	*/
+/*       - Send the header and copy buffer to output												*/
 /*     - Close file																					*/
 /*																									*/
 /*   - Other verbs:																					*/
 /*     - print error message																		*/
 /*																									*/
-/* - Close connection																				*/
+/* - If nothing was sent back, reply 404 with an empty body											*/
 /* ------------------------------------------------------------------------------------------------ */
 
-static void WebserverProcess(struct netconn *conn) 
+static int WebserverProcess(HttpWrk_t *Wrk, struct netconn *conn, int Len, int Keep)
 {
+const char     *Accept;								/* Accept: field of the request header			*/
+char           *Arg;								/* Parameters of a generated page				*/
+int             Code;								/* HTTP status code of the file sent back		*/
 int             CopyFile;
-err_t           Error;
 FILE_DSC_t      Fdsc;								/* Descriptor of the file requested by client	*/
 int             FisOpen;							/* If the file to send back is open				*/
 int             Fsize;								/* Number of bytes read from the file			*/
 int             ii;									/* General purpose								*/
-int             Len;								/* Length of the request						*/
+PAGEhandler_t   Page;								/* Generator of the page requested				*/
 int             PageLen;							/* Length of the page to send back to client	*/
-struct netbuf  *Rqst;								/* Buffer to the client request page			*/
+int             Period;								/* ms between the events of a page stream		*/
 char           *uri;
 char            URIchar;							/* Character that was replaced by '\0'			*/
 char           *URIend;								/* Index where the '\0' was inserted			*/
@@ -266,22 +443,12 @@ enum VerbTypes  VerbRqst;							/* Verb / method of the client request			*/
 
 	URIchar = '\0';
 	uri     = &URIchar;
-	Rqst    = NULL;
-	Error   = netconn_recv(conn, &Rqst);			/* Read the data from the port					*/
-	if ((Rqst   != NULL)							/* Got a valid request							*/
-	&&  (Error  == ERR_OK)							/* No error getting the data					*/
-	&&  (netconn_err(conn) == ERR_OK))  {			/* No error on the connection					*/
-		Len = netbuf_len(Rqst);
-		if (Len > sizeof(g_RqstBuf)-1) {			/* Make sure to not get memory corruption		*/
-			Len = sizeof(g_RqstBuf)-1;
-		}											/* Copy the request page locally				*/
-		Len = netbuf_copy(Rqst, (void**)&g_RqstBuf[0], Len);
-		g_RqstBuf[Len] = 0;							/* Terminate the input buffer					*/
-
+	Code    = 200;
+	if (Len > 0) {									/* Empty requests are not served				*/
 		VerbRqst = V_UNKNOWN_;						/* Assume we can't understand the verb			*/
 		for(ii=0 ; ii<(sizeof(g_MyVerbs)/sizeof(g_MyVerbs[0])) ; ii++) {
-			if (0 == strncmp(&g_RqstBuf[0], g_MyVerbs[ii].Text, strlen(g_MyVerbs[ii].Text))) {
-				uri = strchr(&g_RqstBuf[0], ' ');	/* Isolate the resource name					*/
+			if (0 == strncmp(&Wrk->RqstBuf[0], g_MyVerbs[ii].Text, strlen(g_MyVerbs[ii].Text))) {
+				uri = strchr(&Wrk->RqstBuf[0], ' ');	/* Isolate the resource name					*/
 				if (uri != (char *)NULL) {
 					while (*uri == ' '){			/* Skip the white spaces before the name		*/
 						uri++;
@@ -310,10 +477,40 @@ enum VerbTypes  VerbRqst;							/* Verb / method of the client request			*/
 		CopyFile = 0;								/* We will decide to either copy the file as is	*/
 		PageLen  = 0;								/* or to output a processed buffer (SSI)		*/
 		switch(VerbRqst) {							/* -------------------------------------------- */
-		case V_GET:									/* GET											*/
+		case V_GET:								/* GET												*/
+			Page = PAGEfind(uri);
+			if (Page != (PAGEhandler_t)NULL) {	/* Page generated by the application				*/
+				Period = -1;
+				Arg    = strchr(uri, '?');
+				if (Arg != NULL) {
+					*Arg++ = '\0';				/* The extension then gives the Content-Type		*/
+					if (0 == strncmp(Arg, "stream", 6)) {
+						Period = (Arg[6] == '=') ? atoi(&Arg[7]) : HTTP_SSE_PERIOD;
+					}
+				}
+				if ((Period < 0) && (URIchar != '\0')) {	/* EventSource sets this field			*/
+					Accept = HdrFind(URIend+1, "Accept:");
+					if ((Accept != NULL)
+					&&  (0 == strncmp(Accept, "text/event-stream", 17))) {
+						Period = HTTP_SSE_PERIOD;
+					}
+				}
+				if (Period >= 0) {
+					return(PageStream(Wrk, conn, Page, Period));
+				}
+				sys_mutex_lock(&g_WebSrvMtx);
+				PageLen = Page(&Wrk->PageOutBuf[0], sizeof(Wrk->PageOutBuf));
+				sys_mutex_unlock(&g_WebSrvMtx);
+				if (PageLen < 0) {				/* Generator failed: 404							*/
+					PageLen = 0;
+				}
+				break;
+			}
 			FisOpen = F_OPEN(Fdsc, uri);			/* Try opening the file							*/
 			if (FisOpen == 0) {						/* The file did not open, it could be CGIs		*/
+				sys_mutex_lock(&g_WebSrvMtx);
 				uri = CGIprocess(uri);				/* Check and try processing CGIs				*/
+				sys_mutex_unlock(&g_WebSrvMtx);
 				if (uri != NULL) {					/* Try opening result of CGI if was valid CGI	*/
 					FisOpen = F_OPEN(Fdsc, uri);	/* If URI is NULL, FisOpen already holds 0		*/
 				}
@@ -322,7 +519,9 @@ enum VerbTypes  VerbRqst;							/* Verb / method of the client request			*/
 
 		case V_POST:								/* Place holders for unsupported methods		*/
 			if (URIchar != '\0') {					/* Make sure to not try to analyse garbage		*/
+				sys_mutex_lock(&g_WebSrvMtx);
 				uri = POSTprocess(uri, URIend+1);
+				sys_mutex_unlock(&g_WebSrvMtx);
 				if (uri != NULL) {					/* Try opening result of POST if was valid POST	*/
 					FisOpen = F_OPEN(Fdsc, uri);	/* If URI is NULL, FisOpen already holds 0		*/
 				}
@@ -351,16 +550,18 @@ enum VerbTypes  VerbRqst;							/* Verb / method of the client request			*/
 			F_PATCH_OPEN(Fdsc);						/* Used for in-memory to not modify fs.c		*/
 			if ((NULL != strstr(uri, ".shtm"))		/* Check if the file contains SSIs				*/
 			||  (NULL != strstr(uri, ".stm"))) {	/* SSI file extensions: .stm, .stml, .shtml		*/
+				sys_mutex_lock(&g_WebSrvMtx);
 				SSIvarUpdate();						/* Make sure the local variables are up to date	*/
-													/* Copy the file contents in g_PageInBuf		*/
-				F_READ(Fdsc, &g_PageInBuf[PageLen], sizeof(g_PageInBuf)-1, &Fsize);
-				if ((int)Fsize == (sizeof(g_PageInBuf)-1)) {
+													/* Copy the file contents in PageInBuf			*/
+				F_READ(Fdsc, &Wrk->PageInBuf[PageLen], sizeof(Wrk->PageInBuf)-1, &Fsize);
+				if ((int)Fsize == (sizeof(Wrk->PageInBuf)-1)) {
 					MTXLOCK_STDIO();
-					puts("httpserver_netcomm.c: File too big for g_PageInBuf");
+					puts("httpserver_netcomm.c: File too big for PageInBuf");
 					MTXUNLOCK_STDIO();
 				}
-				g_PageInBuf[(int)Fsize] = '\0';		/* Terminate the input buffer as a string		*/
-				PageLen = SSIexpand(&g_PageOutBuf[0], sizeof(g_PageOutBuf), &g_PageInBuf[0]);
+				Wrk->PageInBuf[(int)Fsize] = '\0';	/* Terminate the input buffer as a string		*/
+				PageLen = SSIexpand(&Wrk->PageOutBuf[0], sizeof(Wrk->PageOutBuf), &Wrk->PageInBuf[0]);
+				sys_mutex_unlock(&g_WebSrvMtx);
 			}
 			else {									/* Not a SSI file, direct copy from the file	*/
 				CopyFile = 1;						/* to the client								*/
@@ -389,11 +590,18 @@ enum VerbTypes  VerbRqst;							/* Verb / method of the client request			*/
 						MTXUNLOCK_STDIO();
 						TSKsleep(5*OS_TICK_PER_SEC);
 					}
+					else if (ii != 0) {			/* Mounted and still no 404 file: there is none		*/
+						break;					/* nothing is sent back								*/
+					}
 					ii = 1;
 				}
 			} while (CopyFile == 0);
 
-			if (ii != 0) {
+			if (CopyFile != 0) {				/* The file cache knows the file by its name		*/
+				uri  = "/404.html";
+				Code = 404;
+			}
+			if ((ii != 0) && (CopyFile != 0)) {
 				MTXLOCK_STDIO();
 				puts("            OK, File System mounted");
 				MTXUNLOCK_STDIO();				
@@ -403,22 +611,668 @@ enum VerbTypes  VerbRqst;							/* Verb / method of the client request			*/
 		if (CopyFile != 0) {						/* Request to copy the file contents as is		*/
 			F_PATCH_OPEN(Fdsc);						/* Used for in-memory to not modify fs.c		*/
 			FisOpen = 1;
-			do {
-				F_READ(Fdsc, &g_PageOutBuf[0], sizeof(g_PageOutBuf), &Fsize);
-				netconn_write(conn, (const void *)&g_PageOutBuf[0], Fsize, NETCONN_COPY);
-			} while (Fsize != 0);
+			Keep    = FileSend(Wrk, conn, &Fdsc, uri, Code, Keep);
 		}
 		else if (PageLen != 0) {					/* Request to send a processed buffer			*/
-			netconn_write(conn, (const void *)&g_PageOutBuf[0], PageLen, NETCONN_COPY);
+			Keep = HdrSend(conn, 200, uri, PageLen, Keep);
+			netconn_write(conn, (const void *)&Wrk->PageOutBuf[0], PageLen, NETCONN_COPY);
+		}
+		else {										/* Nothing to send, not even the 404 page		*/
+			Keep = HdrSend(conn, 404, NULL, 0, Keep);
 		}
 		if (FisOpen != 0) {
 			F_CLOSE(Fdsc);
 		}
 	}
-	netconn_close(conn);							/* Close the connection							*/
-	netbuf_delete(Rqst);							/* Return the buffer to the pool				*/
+
+	return(Keep);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Abort a connection whose client stopped acknowledging the data (runs in the tcpip thread)		*/
+/* The TCP segments referring to the file cache or the stream buffers are freed with the pcb		*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static void AbortConn(void *Arg)
+{
+struct netconn *conn;
+
+	conn = (struct netconn *)Arg;
+	if (conn->pcb.tcp != NULL) {				/* err_tcp() clears it when the pcb is gone			*/
+		tcp_abort(conn->pcb.tcp);
+	}
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Read the sequence numbers of a connection for TcpSeq() (runs in the tcpip thread)				*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static void SeqRead(void *Arg)
+{
+HttpWrk_t      *Wrk;
+struct tcp_pcb *Pcb;
+
+	Wrk = (HttpWrk_t *)Arg;
+	Pcb = Wrk->SeqConn->pcb.tcp;
+	Wrk->SeqGone = (Pcb == NULL);
+	if (Pcb != NULL) {
+		Wrk->SeqAcked  = Pcb->lastack;
+		Wrk->SeqQueued = Pcb->snd_lbb;
+	}
+	sys_sem_signal(&Wrk->SeqSem);
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Callback of the connections (runs in the tcpip thread)											*/
+/* The ACK of data, and the error that frees the pcb, wake up the worker waiting in WaitAcked()		*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static void ConnEvent(struct netconn *conn, enum netconn_evt Evt, u16_t Len)
+{
+int ii;
+
+	Len = Len;									/* To remove compiler warning						*/
+
+	if ((Evt == NETCONN_EVT_SENDPLUS)
+	||  (Evt == NETCONN_EVT_ERROR)) {
+		for (ii=0 ; ii<HTTP_N_WORKER ; ii++) {
+			if ((g_Wrk[ii].AckConn == conn)
+			&&  (g_Wrk[ii].AckWait != 0)) {
+				g_Wrk[ii].AckWait = 0;
+				sys_sem_signal(&g_Wrk[ii].AckSem);
+			}
+		}
+	}
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Have AbortConn() run in the tcpip thread. tcpip_callback() fails when no message can be			*/
+/* allocated: retry until it is posted, the caller relies on the pcb going away						*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static void ConnAbort(struct netconn *conn)
+{
+	while (ERR_OK != tcpip_callback(AbortConn, conn)) {
+		TSKsleep(1);
+	}
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Serve all the requests of a connection															*/
+/*																									*/
+/* - forever loop																					*/
+/*   - If RqstBuf[] holds a complete request (see RqstEnd())										*/
+/*     - Process it and drop it from RqstBuf[], pipelined requests stay behind						*/
+/*     - Exit if the connection cannot be kept open													*/
+/*   - else																							*/
+/*     - Append the data received to RqstBuf[]														*/
+/*     - Exit when closed by the client or idle for HTTP_KEEPALIVE_TOUT ms							*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static void ConnServe(HttpWrk_t *Wrk, struct netconn *conn)
+{
+int            Keep;							/* If the connection is kept open					*/
+int            Len;								/* Length of the request to process					*/
+int            Nrqst;							/* Number of requests served on the connection		*/
+struct netbuf *Rqst;							/* Data received from the client					*/
+char           Save;							/* Character replaced by the '\0' ending a request	*/
+
+  #if LWIP_SO_RCVTIMEO
+	netconn_set_recvtimeout(conn, HTTP_KEEPALIVE_TOUT);
+  #endif
+	if (conn->pcb.tcp != NULL) {				/* Small replies on a kept-alive connection must	*/
+		tcp_nagle_disable(conn->pcb.tcp);		/* not wait for the ACK of the previous one			*/
+	}
+
+	Wrk->RqstLen    = 0;
+	Wrk->RqstBuf[0] = '\0';
+	Wrk->Trunc      = 0;
+	Nrqst           = 0;
+	Keep            = 1;
+	while (Keep != 0) {
+		Len = RqstEnd(&Wrk->RqstBuf[0], Wrk->RqstLen);
+		if (Len == 0) {							/* No complete request, get more data				*/
+			if ((Wrk->RqstLen >= (int)(sizeof(Wrk->RqstBuf)-1))	/* Request larger than the buffer	*/
+			||  (ERR_OK != netconn_recv(conn, &Rqst))) {	/* or closed / idle client				*/
+				break;
+			}
+			Len = netbuf_len(Rqst);
+			if (Len > ((int)(sizeof(Wrk->RqstBuf)-1) - Wrk->RqstLen)) {
+				Len        = (int)(sizeof(Wrk->RqstBuf)-1) - Wrk->RqstLen;
+				Wrk->Trunc = 1;					/* Close once what fits is served					*/
+			}
+			Wrk->RqstLen += netbuf_copy(Rqst, &Wrk->RqstBuf[Wrk->RqstLen], Len);
+			Wrk->RqstBuf[Wrk->RqstLen] = '\0';
+			netbuf_delete(Rqst);
+		}
+		else {
+			Save              = Wrk->RqstBuf[Len];
+			Wrk->RqstBuf[Len] = '\0';			/* Isolate the request from the next ones			*/
+			Nrqst++;
+			Keep = (Nrqst      < HTTP_KEEPALIVE_MAX)
+			    && (Wrk->Trunc == 0)
+			    && (0 != RqstKeep(&Wrk->RqstBuf[0]));
+			Keep = WebserverProcess(Wrk, conn, Len, Keep);
+			Wrk->RqstBuf[Len] = Save;
+			Wrk->RqstLen     -= Len;
+			memmove(&Wrk->RqstBuf[0], &Wrk->RqstBuf[Len], Wrk->RqstLen+1);
+		}
+	}
 
 	return;
 }
 
+#if ((HTTP_FCACHE_N) > 0)
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Get the file in the file cache, reading it from the file system when not there or modified		*/
+/* The entry being read has Size -1 and Users 1: the other workers skip it, so g_FCacheMtx is not	*/
+/* held while reading the file																		*/
+/*																									*/
+/* Return: >= 0 : index in g_FCache[] of the file, the caller must decrement Users when done		*/
+/*          -1  : the file is not cached, the caller streams it										*/
+/*          -2  : the file could not be read, nothing is sent back									*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int FCacheGet(FILE_DSC_t *Fdsc, const char *Name, int Size, uint32_t Stamp)
+{
+int ii;
+int Nread;
+int Victim;
+
+	if ((Size < 0)								/* Unknown size, too large or name too long for		*/
+	||  (Size > HTTP_FCACHE_FSIZE)				/* the cache: streamed								*/
+	||  (strlen(Name) >= HTTP_FCACHE_NAME)) {
+		return(-1);
+	}
+
+	sys_mutex_lock(&g_FCacheMtx);
+	Victim = -1;
+	for (ii=0 ; ii<HTTP_FCACHE_N ; ii++) {		/* Look for the file in the cache					*/
+		if ((g_FCache[ii].Size >= 0)
+		&&  (0 == strcmp(&g_FCache[ii].Name[0], Name))) {
+			if ((g_FCache[ii].Size  == Size)
+			&&  (g_FCache[ii].Stamp == Stamp)) {	/* Hit with the same contents					*/
+				g_FCache[ii].Users++;
+				g_FCache[ii].LastUse = G_OStimCnt;
+				sys_mutex_unlock(&g_FCacheMtx);
+				return(ii);
+			}
+			if (g_FCache[ii].Users != 0) {		/* Modified but the old contents are still in		*/
+				sys_mutex_unlock(&g_FCacheMtx);	/* flight: stream the new ones this time			*/
+				return(-1);
+			}
+			Victim = ii;						/* Modified and unused: read it again in place		*/
+			break;
+		}
+	}
+
+	if (Victim < 0) {							/* Not in the cache: a free entry or the least		*/
+		for (ii=0 ; ii<HTTP_FCACHE_N ; ii++) {	/* recently used one not being sent					*/
+			if (g_FCache[ii].Users == 0) {
+				if (g_FCache[ii].Size < 0) {
+					Victim = ii;
+					break;
+				}
+				if ((Victim < 0)
+				||  ((G_OStimCnt - g_FCache[ii].LastUse) > (G_OStimCnt - g_FCache[Victim].LastUse))) {
+					Victim = ii;
+				}
+			}
+		}
+		if (Victim < 0) {						/* All entries are being sent						*/
+			sys_mutex_unlock(&g_FCacheMtx);
+			return(-1);
+		}
+	}
+
+	g_FCache[Victim].Size  = -1;				/* Invalid until the whole file is read				*/
+	g_FCache[Victim].Users = 1;
+	sys_mutex_unlock(&g_FCacheMtx);
+
+	for (ii=0 ; ii<Size ; ii+=Nread) {
+		F_READ(*Fdsc, &g_FCdata[Victim][ii], Size-ii, &Nread);
+		if (Nread <= 0) {						/* Read error or the file got shorter				*/
+			sys_mutex_lock(&g_FCacheMtx);
+			g_FCache[Victim].Users = 0;
+			sys_mutex_unlock(&g_FCacheMtx);
+			return(-2);
+		}
+	}
+
+	strcpy(&g_FCache[Victim].Name[0], Name);
+	g_FCache[Victim].Stamp   = Stamp;
+	g_FCache[Victim].LastUse = G_OStimCnt;
+	sys_mutex_lock(&g_FCacheMtx);
+	g_FCache[Victim].Size    = Size;
+	sys_mutex_unlock(&g_FCacheMtx);
+
+	return(Victim);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Send the header and a file already open: in-memory files are sent as is, files in the file		*/
+/* cache from the cache, other files are read in chunks of HTTP_STREAM_SIZE bytes, with 2 chunks	*/
+/* in flight. All writes use NETCONN_NOCOPY, so a buffer is only reused once the client				*/
+/* acknowledged it																					*/
+/*																									*/
+/* Return: non-zero if the connection can be kept open for the next request							*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int FileSend(HttpWrk_t *Wrk, struct netconn *conn, FILE_DSC_t *Fdsc, const char *Name,
+                    int Code, int Keep)
+{
+const void *Data;
+int         Fsize;
+int         ii;
+int         InFlight[2];
+u32_t       Seq[2];
+int         Size;
+uint32_t    Stamp;
+int         Total;								/* Number of bytes of a streamed file sent			*/
+
+	F_INFO(*Fdsc, Name, &Size, &Stamp);
+	Data = F_DATA(*Fdsc);
+	if (Data != NULL) {							/* In-memory file: the data is constant				*/
+		if (F_HDR(*Fdsc) != 0) {				/* The header is in the file, without a length		*/
+			Keep = 0;
+		}
+		else {
+			Keep = HdrSend(conn, Code, Name, Size, Keep);
+		}
+		if (ERR_OK != netconn_write(conn, Data, Size, NETCONN_NOCOPY)) {
+			Keep = 0;
+		}
+		return(Keep);
+	}
+
+  #if ((HTTP_FCACHE_N) > 0)
+	ii = FCacheGet(Fdsc, Name, Size, Stamp);
+	if (ii == -2) {								/* The file cannot be read							*/
+		return(0);
+	}
+	if (ii >= 0) {								/* Send from the file cache							*/
+		Keep = HdrSend(conn, Code, Name, Size, Keep);
+		if (ERR_OK != WriteNoCopy(Wrk, conn, &g_FCdata[ii][0], Size, &Seq[0])) {
+			ConnAbort(conn);					/* Partly queued data may still be referenced		*/
+			Keep = 0;							/* by the pcb: get rid of it						*/
+		}
+												/* WaitAcked() only returns once all acknowledged	*/
+												/* or once the pcb is gone: no segment refers to	*/
+												/* the cache entry anymore							*/
+		if (0 != WaitAcked(Wrk, conn, Seq[0])) {
+			Keep = 0;
+		}
+		sys_mutex_lock(&g_FCacheMtx);
+		g_FCache[ii].Users--;
+		sys_mutex_unlock(&g_FCacheMtx);
+		return(Keep);
+	}
+  #endif
+
+	Keep        = HdrSend(conn, Code, Name, Size, Keep);
+	InFlight[0] = 0;
+	InFlight[1] = 0;
+	Total       = 0;
+	ii          = 0;
+	do {
+		if (InFlight[ii] != 0) {				/* Wait for the client to have acknowledged the		*/
+												/* chunk sent 2 chunks ago from that buffer			*/
+			InFlight[ii] = 0;
+			if (0 != WaitAcked(Wrk, conn, Seq[ii])) {
+				Keep = 0;						/* The connection is gone, the other buffer is		*/
+				break;							/* checked below before returning					*/
+			}
+		}
+		F_READ(*Fdsc, &Wrk->StreamBuf[ii][0], HTTP_STREAM_SIZE, &Fsize);
+		if (Fsize > 0) {
+			InFlight[ii] = 1;
+			Total       += Fsize;
+			if (ERR_OK != WriteNoCopy(Wrk, conn, &Wrk->StreamBuf[ii][0], Fsize, &Seq[ii])) {
+				ConnAbort(conn);
+				Fsize = 0;
+			}
+		}
+		ii ^= 1;
+	} while (Fsize > 0);
+
+	for (ii=0 ; ii<2 ; ii++) {					/* The buffers are reused by the next request:		*/
+		if (InFlight[ii] != 0) {				/* wait for both to be acknowledged, or for the		*/
+			WaitAcked(Wrk, conn, Seq[ii]);		/* pcb holding them to be gone						*/
+		}
+	}
+
+	if (Total != Size) {						/* The file changed while being sent: the			*/
+		Keep = 0;								/* Content-Length was wrong							*/
+	}
+
+	return(Keep);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Find a header field in a request ('\0' terminated), the name includes the ':'					*/
+/*																									*/
+/* Return: pointer to the value, NULL if the field is not in the header								*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static const char *HdrFind(const char *Rqst, const char *Name)
+{
+int Len;
+
+	Len = strlen(Name);
+	Rqst = strchr(Rqst, '\n');					/* Skip the request line							*/
+	while (Rqst != NULL) {
+		Rqst++;
+		if ((*Rqst == '\r')						/* Empty line: end of the header					*/
+		||  (*Rqst == '\n')
+		||  (*Rqst == '\0')) {
+			break;
+		}
+		if (0 == strncasecmp(Rqst, Name, Len)) {
+			Rqst += Len;
+			while (*Rqst == ' ') {
+				Rqst++;
+			}
+			return(Rqst);
+		}
+		Rqst = strchr(Rqst, '\n');
+	}
+
+	return(NULL);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Send the HTTP header of a reply of Size bytes (-ve when unknown: the connection is closed)		*/
+/*																									*/
+/* Return: non-zero if the connection can be kept open for the next request							*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int HdrSend(struct netconn *conn, int Code, const char *Name, int Size, int Keep)
+{
+const char *Ext;
+char        Hdr[192];
+int         ii;
+int         Len;
+const char *Type;
+
+	Type = "application/octet-stream";
+	Ext  = (Name != NULL) ? strrchr(Name, '.') : NULL;
+	if (Ext != NULL) {
+		for (ii=0 ; ii<(sizeof(g_MyTypes)/sizeof(g_MyTypes[0])) ; ii++) {
+			if (0 == strcmp(Ext, g_MyTypes[ii].Ext)) {
+				Type = g_MyTypes[ii].Type;
+				break;
+			}
+		}
+	}
+
+	if (Size < 0) {								/* Without a length the end of the reply is the		*/
+		Keep = 0;								/* end of the connection							*/
+	}
+
+	Len = sprintf(&Hdr[0], "HTTP/1.1 %s\r\nContent-Type: %s\r\n",
+	              (Code == 404) ? "404 Not Found" : "200 OK", Type);
+	if (Size >= 0) {
+		Len += sprintf(&Hdr[Len], "Content-Length: %d\r\n", Size);
+	}
+	Len += sprintf(&Hdr[Len], "Connection: %s\r\n\r\n", (Keep != 0) ? "keep-alive" : "close");
+
+	if (ERR_OK != netconn_write(conn, &Hdr[0], Len, NETCONN_COPY)) {
+		Keep = 0;
+	}
+
+	return(Keep);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Stream a generated page as server-sent events, one every Period ms ("data: <page>\n\n")			*/
+/*																									*/
+/* Return: 0, the connection is closed once the client went away									*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int PageStream(HttpWrk_t *Wrk, struct netconn *conn, PAGEhandler_t Page, int Period)
+{
+err_t Error;
+int   Len;
+
+	if (Period < HTTP_SSE_MIN) {
+		Period = HTTP_SSE_MIN;
+	}
+
+	Error = netconn_write(conn, &g_SSEhdr[0], sizeof(g_SSEhdr)-1, NETCONN_NOCOPY);
+	while (Error == ERR_OK) {
+		memcpy(&Wrk->PageOutBuf[0], "data: ", 6);
+		sys_mutex_lock(&g_WebSrvMtx);
+		Len = Page(&Wrk->PageOutBuf[6], sizeof(Wrk->PageOutBuf)-8);	/* Room for the "\n\n" ending the event	*/
+		sys_mutex_unlock(&g_WebSrvMtx);
+		if (Len < 0) {
+			break;
+		}
+		Wrk->PageOutBuf[Len+6] = '\n';
+		Wrk->PageOutBuf[Len+7] = '\n';
+		Error = netconn_write(conn, &Wrk->PageOutBuf[0], Len+8, NETCONN_COPY);	/* Fails once the client reset	*/
+		if (Error == ERR_OK) {
+			TSKsleep(OS_MS_TO_TICK(Period));
+		}
+	}
+
+	return(0);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Check if the Len bytes in Rqst hold a complete request: the header up to its empty line and		*/
+/* the body when there is a Content-Length. Rqst must be '\0' terminated after the Len bytes		*/
+/*																									*/
+/* Return: number of bytes of the first request, 0 if it is not complete							*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int RqstEnd(const char *Rqst, int Len)
+{
+int         Body;
+int         End;
+const char *Ptr;
+
+	End = -1;
+	for (Ptr=Rqst ; Ptr<&Rqst[Len] ; Ptr++) {	/* Look for the empty line, \r\n\r\n or \n\n		*/
+		if (*Ptr == '\n') {
+			if (Ptr[1] == '\n') {
+				End = (Ptr+2) - Rqst;
+				break;
+			}
+			if ((Ptr[1] == '\r')
+			&&  (Ptr[2] == '\n')) {
+				End = (Ptr+3) - Rqst;
+				break;
+			}
+		}
+	}
+	if ((End < 0)
+	||  (End > Len)) {
+		return(0);
+	}
+
+	Body = 0;
+	Ptr  = HdrFind(Rqst, "Content-Length:");
+	if (Ptr != NULL) {
+		Body = atoi(Ptr);
+	}
+	if ((Body < 0)								/* Whole body not yet received						*/
+	||  ((End+Body) > Len)) {
+		return(0);
+	}
+
+	return(End+Body);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Check if the client wants the connection kept open after a request ('\0' terminated)				*/
+/* HTTP/1.1 keeps it unless "Connection: close", HTTP/1.0 only with "Connection: keep-alive"		*/
+/*																									*/
+/* Return: non-zero if the connection can be kept open												*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int RqstKeep(const char *Rqst)
+{
+const char *Conn;
+const char *Eol;
+const char *Vers;
+int         Keep;
+
+	Eol  = strchr(Rqst, '\n');
+	Vers = strstr(Rqst, " HTTP/1.");
+	if ((Eol  == NULL)							/* Not HTTP/1.x: the end of the reply is the		*/
+	||  (Vers == NULL)							/* end of the connection							*/
+	||  (Vers > Eol)) {
+		return(0);
+	}
+
+	Conn = HdrFind(Rqst, "Connection:");
+	if (Vers[8] == '0') {
+		Keep = (Conn != NULL) && (0 == strncasecmp(Conn, "keep-alive", 10));
+	}
+	else {
+		Keep = (Conn == NULL) || (0 != strncasecmp(Conn, "close", 5));
+	}
+
+	return(Keep);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Wait for the client to have acknowledged all data up to the sequence number Seq					*/
+/* A client that acknowledges nothing for HTTP_ACK_TOUT has its connection aborted					*/
+/* The wait is woken by ConnEvent() on the ACKs and the errors, with a read every HTTP_ACK_POLL ms	*/
+/* as lwIP only reports the ACKs that bring the send buffer over its low water marks				*/
+/*																									*/
+/* Return:  0 : all acknowledged																	*/
+/*         -1 : the connection is gone (pcb freed, no segment refers to the data anymore)			*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int WaitAcked(HttpWrk_t *Wrk, struct netconn *conn, u32_t Seq)
+{
+u32_t Acked;
+int   Err;
+u32_t Last;
+int   Start;
+
+	Last  = 0;
+	Start = G_OStimCnt;
+	for (;;) {
+		Wrk->AckWait = 1;						/* Before the read: no ACK can be missed			*/
+		Err = TcpSeq(Wrk, conn, &Acked, NULL);
+		if (Err == -1) {
+			return(-1);
+		}
+		if (Err == 0) {
+			if ((int32_t)(Acked - Seq) >= 0) {	/* Done when lastack is at or past Seq				*/
+				Wrk->AckWait = 0;
+				return(0);
+			}
+			if (Last != Acked) {				/* Progress, restart the timeout					*/
+				Last  = Acked;
+				Start = G_OStimCnt;
+			}
+		}
+		if ((G_OStimCnt - Start) >= HTTP_ACK_TOUT) {
+			ConnAbort(conn);					/* Stalled client, keep waiting for the pcb to		*/
+			Start = G_OStimCnt;					/* be gone											*/
+		}
+		sys_arch_sem_wait(&Wrk->AckSem, (Err == 0) ? HTTP_ACK_POLL : 1);
+	}
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Worker task: serve the connections handed by WebserverTask() one after the other					*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static void WorkerTask(void *Arg)
+{
+struct netconn *Conn;
+void           *Msg;
+HttpWrk_t      *Wrk;
+
+	Wrk = (HttpWrk_t *)Arg;
+	sys_sem_new(&Wrk->SeqSem, 0);
+	sys_sem_new(&Wrk->AckSem, 0);
+
+  #if (defined(TSKsetCore) && ((HTTP_CORE) >= 0))
+	TSKsetCore(TSKmyID(), HTTP_CORE);
+  #endif
+
+	for (;;) {
+		sys_mutex_lock(&g_ConnMtx);				/* The idle workers queue on the mutex				*/
+		sys_arch_mbox_fetch(&g_ConnMbx, &Msg, 0);	/* Wait for a connection to serve				*/
+		sys_mutex_unlock(&g_ConnMtx);
+		Conn = (struct netconn *)Msg;
+		Wrk->AckConn = Conn;					/* Where ConnEvent() finds this worker				*/
+		ConnServe(Wrk, Conn);
+		Wrk->AckConn = NULL;
+		netconn_close(Conn);					/* Close and delete the connection					*/
+		netconn_delete(Conn);
+	}
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Queue data with NETCONN_NOCOPY and report the sequence number following its last byte			*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static err_t WriteNoCopy(HttpWrk_t *Wrk, struct netconn *conn, const void *Data, int Len, u32_t *Seq)
+{
+err_t Error;
+int   Err;
+
+	Error = netconn_write(conn, Data, Len, NETCONN_NOCOPY);
+	for (;;) {
+		Err = TcpSeq(Wrk, conn, NULL, Seq);		/* snd_lbb: next byte to be queued					*/
+		if (Err != -2) {
+			break;
+		}
+		TSKsleep(1);							/* No tcpip message available, retry				*/
+	}
+	if (Err != 0) {								/* Gone: WaitAcked() returns right away				*/
+		*Seq = 0;
+	}
+
+	return(Error);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* Get the last byte acknowledged by the client (lastack) and the next byte to be queued (snd_lbb)	*/
+/* of a connection. The pcb belongs to the tcpip thread, it may be freed any time by another one	*/
+/*																									*/
+/* Return:  0 : *Acked and *Queued are set (when not NULL)											*/
+/*         -1 : the connection is gone (the pcb was freed)											*/
+/*         -2 : the request could not be posted to the tcpip thread (out of messages), retry		*/
+/* ------------------------------------------------------------------------------------------------ */
+
+static int TcpSeq(HttpWrk_t *Wrk, struct netconn *conn, u32_t *Acked, u32_t *Queued)
+{
+	Wrk->SeqConn = conn;
+	if (ERR_OK != tcpip_callback(SeqRead, Wrk)) {
+		return(-2);
+	}
+	sys_arch_sem_wait(&Wrk->SeqSem, 0);
+
+	if (Wrk->SeqGone != 0) {
+		return(-1);
+	}
+	if (Acked != NULL) {
+		*Acked = Wrk->SeqAcked;
+	}
+	if (Queued != NULL) {
+		*Queued = Wrk->SeqQueued;
+	}
+
+	return(0);
+}
+
 /* EOF */
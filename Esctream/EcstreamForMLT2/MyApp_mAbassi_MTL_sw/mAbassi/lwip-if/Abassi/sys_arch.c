@@ -74,6 +74,23 @@
   #define LWIP_MAX_TASK		16					/* Maximum # of tasks created with sys_thread_new()	*/
 #endif
 
+struct _MboxSlot {								/* One message slot of a mailbox ring				*/
+	volatile u32_t  Seq;						/* Ring index the slot is free (==) or full (+1) at	*/
+	void * volatile Msg;
+};
+
+struct _SysMbox {								/* Bounded lock-free multi-producer single-consumer	*/
+	volatile u32_t    WrtIdx;					/* Next ring index a producer claims				*/
+	volatile u32_t    RdIdx;					/* Next ring index the consumer reads				*/
+	u32_t             Mask;						/* Number of slots - 1, the slots are a power of 2	*/
+	int               Size;						/* Size requested when created						*/
+	volatile int      RdWait;					/* != 0 when the consumer is blocked on RdSem		*/
+	volatile int      WrtWait;					/* # of producers blocked on WrtSem because full	*/
+	SEM_t            *RdSem;					/* The semaphores are only used to block, never		*/
+	SEM_t            *WrtSem;					/* when a message can go through					*/
+	struct _MboxSlot *Slot;
+};
+
 struct _MboxParking {							/* Structure to hold freed mailboxes & related info	*/
 	sys_mbox_t Mbox;							/* Mailbox that was "freed"							*/
 	int        Size;							/* Size of the freed mailbox						*/
@@ -93,26 +110,22 @@ static struct _TaskFctArg  g_TaskFctArg[LWIP_MAX_TASK];
   static MTX_t              *g_LWIPmutex;
 #endif
 
-#if ((OX_N_CORE) > 1)	
-  static int               g_ParkSpin;			/* To protect access to the parking lots			*/
-#endif
+static sys_spin_t g_MbxSpin;					/* Each parking lot has its own spinlock so the		*/
+static sys_spin_t g_MtxSpin;					/* cores only contend when they access the same		*/
+static sys_spin_t g_SemSpin;					/* parking lot. The mailboxes themselves are lock-	*/
+static sys_spin_t g_TskSpin;					/* free and don't need one							*/
+static sys_spin_t g_NowSpin;
 
 static void TaskTrampoline(void);				/* Used to set argument as lwip_thread_fn() needs	*/
 
-#if ((OX_N_CORE) > 1)							/* Macros for short time mutual exclusion			*/
-  #define PROT_START()		OSintOff(); CORElock(LWIP_SPINLOCK, &g_ParkSpin, 0, 1+COREgetID())
-  #define PROT_END(x)		do {COREunlock(LWIP_SPINLOCK, &g_ParkSpin, 0); OSintBack(x);}while(0)
-#else											/* The spinlock is not needed on a single core		*/
-  #define PROT_START()		OSintOff()
-  #define PROT_END(x)		OSintBack(x)
-#endif
+#define PROT_START(Lock)	sys_spin_lock(Lock)	/* Macros for short time mutual exclusion			*/
+#define PROT_END(Lock, x)	sys_spin_unlock((Lock), (x))
 
 #if (((OX_N_CORE) > 1) && ((MEM_LIBC_MALLOC) == 0))
   static volatile int g_MySpinLock;				/* The spinlock variable							*/
   static volatile int g_MySpinGot;				/* When I got the spin lock (needed for reentrance	*/
   static volatile int g_MySpinIsr[OX_N_CORE];	/* ISR enable/disable state of the core				*/
 #endif
-static int g_IdxMbxNames;
 static int g_IdxMtxNames;
 static int g_IdxSemNames;
 
@@ -195,6 +208,95 @@ static const char g_Names[][8] = {
   #error "Add more names in the g_Names[] array"
 #endif
 
+/*--------------------------------------------------------------------------------------------------*/
+/* Mailbox rings: a producer claims a slot with a compare & swap on WrtIdx, writes the message and	*/
+/* then publishes it through the slot Seq. The consumer reads in order and hands the slot back for	*/
+/* the next turn of the ring. No lock and no interrupt disabling; the semaphores are only posted		*/
+/* when the other side said (RdWait / WrtWait) it is about to block.								*/
+
+static int MboxPut(sys_mbox_t Mbox, void *Msg)
+{
+struct _MboxSlot *Slot;							/* Slot of the ring index claimed					*/
+int               Dif;							/* Slot state relative to the claimed index			*/
+u32_t             Idx;							/* Ring index trying to be claimed					*/
+
+	Idx = Mbox->WrtIdx;
+	for (;;) {
+		Slot = &Mbox->Slot[Idx & Mbox->Mask];
+		Dif  = (int)(Slot->Seq - Idx);
+		if (Dif == 0) {							/* The slot is free for this turn, try to claim it	*/
+			if (__sync_bool_compare_and_swap(&Mbox->WrtIdx, Idx, Idx+1)) {
+				break;
+			}
+		}
+		else if (Dif < 0) {						/* Still holds the message of the previous turn		*/
+			return(-1);							/* The mailbox is full								*/
+		}
+		Idx = Mbox->WrtIdx;						/* Another producer got it, try the next one		*/
+	}
+
+	Slot->Msg = Msg;
+	__sync_synchronize();						/* Message in memory before being published			*/
+	Slot->Seq = Idx+1;
+
+	__sync_synchronize();						/* Published before looking if the consumer is		*/
+	if (Mbox->RdWait != 0) {					/* blocked (it sets RdWait then looks again)		*/
+		Mbox->RdWait = 0;
+		SEMpost(Mbox->RdSem);
+	}
+
+	return(0);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static int MboxGet(sys_mbox_t Mbox, void **Msg)
+{
+struct _MboxSlot *Slot;							/* Slot of the next ring index to read				*/
+u32_t             Idx;							/* Next ring index to read							*/
+
+	Idx  = Mbox->RdIdx;
+	Slot = &Mbox->Slot[Idx & Mbox->Mask];
+
+	if ((int)(Slot->Seq - (Idx+1)) < 0) {		/* Nothing published in there yet					*/
+		return(-1);								/* The mailbox is empty								*/
+	}
+
+	__sync_synchronize();						/* Read the message after it was published			*/
+	if (Msg != NULL) {
+		*Msg = Slot->Msg;
+	}
+	Mbox->RdIdx = Idx+1;
+	__sync_synchronize();						/* Message read before the slot is handed back		*/
+	Slot->Seq = Idx + Mbox->Mask + 1;			/* Free for the next turn of the ring				*/
+
+	__sync_synchronize();						/* A producer may be waiting for a free slot		*/
+	if (Mbox->WrtWait != 0) {
+		SEMpost(Mbox->WrtSem);
+	}
+
+	return(0);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static void MboxReset(sys_mbox_t Mbox)
+{
+u32_t ii;
+
+	for (ii=0 ; ii<=Mbox->Mask ; ii++) {
+		Mbox->Slot[ii].Seq = ii;
+	}
+	Mbox->WrtIdx  = 0;
+	Mbox->RdIdx   = 0;
+	Mbox->RdWait  = 0;
+	Mbox->WrtWait = 0;
+	SEMreset(Mbox->RdSem);						/* Drop postings left from a previous use			*/
+	SEMreset(Mbox->WrtSem);
+
+	return;
+}
+
 /*--------------------------------------------------------------------------------------------------*/
 /*
   Creates an empty mailbox.
@@ -203,28 +305,45 @@ err_t sys_mbox_new(sys_mbox_t *mbox, int size)
 {
 int        ii;									/* Loop counter										*/
 int        IsrState;							/* State of ISRs (enable/disable) before disabling	*/
-sys_mbox_t MailBox;
+sys_mbox_t MailBox;								/* New mailbox (either allocated or parking lot)	*/
+u32_t      Nslot;								/* Number of slots in the ring						*/
 
 	MailBox = (sys_mbox_t)NULL;					/* Assume there is no matching "freed" mailboxes	*/
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the parking lot	*/
+	IsrState = PROT_START(&g_MbxSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<SYS_MBX_HOLD ; ii++) {		/* Check if the same mailbox size was freed			*/
 		if ((g_MbxParking[ii].Mbox != (sys_mbox_t)NULL)
 		&&  (g_MbxParking[ii].Size == size)) {	/* If yes, then take the freed one instead of new	*/
 			MailBox               = g_MbxParking[ii].Mbox;
 			g_MbxParking[ii].Mbox = (sys_mbox_t)NULL;
-		  
-			MailBox->RdIdx        = 0;			/* Make sure the mailbox is empty					*/
-			MailBox->WrtIdx       = MailBox->Size;	/* Should defintitely be but let's play safe	*/
 			break;
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_MbxSpin, IsrState);
 
 	if (MailBox == (sys_mbox_t)NULL) {			/* No such mailbox was freed						*/
-		MailBox = (sys_mbox_t)MBXopen(&g_Names[g_IdxMbxNames++][0], size);
+		Nslot = 1;								/* Round up to a power of 2 for the masking			*/
+		while ((int)Nslot < size) {
+			Nslot <<= 1;
+		}
+		MailBox = (sys_mbox_t)OSalloc(sizeof(*MailBox) + Nslot*sizeof(struct _MboxSlot));
+		if (MailBox != (sys_mbox_t)NULL) {
+			MailBox->Slot   = (struct _MboxSlot *)&MailBox[1];
+			MailBox->Mask   = Nslot-1;
+			MailBox->Size   = size;
+			MailBox->RdSem  = SEMopen(NULL);
+			MailBox->WrtSem = SEMopen(NULL);
+			if ((MailBox->RdSem == NULL)
+			||  (MailBox->WrtSem == NULL)) {	/* Memory can't be given back, is lost				*/
+				MailBox = (sys_mbox_t)NULL;
+			}
+		}
+	}
+
+	if (MailBox != (sys_mbox_t)NULL) {
+		MboxReset(MailBox);
 	}
 
 	*mbox = MailBox;
@@ -241,6 +360,7 @@ sys_mbox_t MailBox;
 	return((MailBox == NULL) ? (ERR_MEM) : (ERR_OK));
 }
 
+
 /*--------------------------------------------------------------------------------------------------*/
 /*
   Deallocates a mailbox. If there are messages still present in the
@@ -251,13 +371,13 @@ void sys_mbox_free(sys_mbox_t *mbox)
 {
 int        ii;									/* Loop counter										*/
 int        IsrState;							/* State of ISRs (enable/disable) before disabling	*/
-sys_mbox_t MailBox;								/* New mailbox (either MBXopen or from parking lot)	*/
+sys_mbox_t MailBox;								/* Mailbox to put in the parking lot				*/
 
 	STATS_DEC(sys.mbox.used);					/* Should be protected. Not, to keep best real-time	*/
 
 	MailBox = *mbox;							/* Local may help speed-up the code					*/
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the parking lot	*/
+	IsrState = PROT_START(&g_MbxSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<SYS_MBX_HOLD ; ii++) {		/* Find an unused entry to memo that mailbox		*/
 		if (g_MbxParking[ii].Mbox == (sys_mbox_t)NULL) {
@@ -268,7 +388,7 @@ sys_mbox_t MailBox;								/* New mailbox (either MBXopen or from parking lot)	*
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_MbxSpin, IsrState);
 												/* No more room to hold deleted mailbox				*/
 	LWIP_ERROR("lwIP (sys_arch.c) - Out room to hold mailboxes", (ii<SYS_MBX_HOLD), do{}while(0); );
 
@@ -286,7 +406,19 @@ sys_mbox_t MailBox;								/* New mailbox (either MBXopen or from parking lot)	*
 */
 void sys_mbox_post(sys_mbox_t *mbox, void *data)
 {
-	MBXput(*mbox, (intptr_t)data, -1);
+sys_mbox_t MailBox;
+
+	MailBox = *mbox;
+
+	while (MboxPut(MailBox, data) != 0) {		/* Full, block until the consumer frees a slot		*/
+		__sync_fetch_and_add(&MailBox->WrtWait, 1);
+		if (MboxPut(MailBox, data) == 0) {		/* Look again now MboxGet() knows about us			*/
+			__sync_fetch_and_sub(&MailBox->WrtWait, 1);
+			break;
+		}
+		SEMwait(MailBox->WrtSem, -1);
+		__sync_fetch_and_sub(&MailBox->WrtWait, 1);
+	}
 
 	return;
 }
@@ -301,7 +433,7 @@ err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
 err_t result;
 
 	result = ERR_OK;							/* Assume the mailbox is not full					*/
-	if (0 != MBXput(*mbox, (intptr_t)msg, 0)) {
+	if (0 != MboxPut(*mbox, msg)) {
 		result = ERR_MEM;						/* Mailbox is full, return info abour the error		*/
 		STATS_INC(sys.mbox.err);				/* Should be protected. Not, to keep best real-time	*/
 	}
@@ -309,6 +441,7 @@ err_t result;
    return(result);
 }
 
+
 /*--------------------------------------------------------------------------------------------------*/
 /*
   Blocks the thread until a message arrives in the mailbox, but does
@@ -324,21 +457,45 @@ err_t result;
 
   Note that a function with a similar name, sys_mbox_fetch(), is
   implemented by lwIP.
+
+  The mailboxes are single-consumer: only one task at a time may fetch from
+  a given mailbox (see sys_arch.h).
 */
 u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
 {
-u32_t Elapse;
-
-	Elapse = (u32_t)G_OStimCnt;					/* Current Abassi internal time						*/
-	if (0 == MBXget(*mbox, (intptr_t *)msg, (timeout == 0) ? -1 : OS_MS_TO_TICK(timeout))) {
-		Elapse = (((u32_t)G_OStimCnt-Elapse)*1000)
-		       / OS_TICK_PER_SEC;				/* Compute elapsed time and convert in milliseconds	*/
-	}
-	else {
-		Elapse = SYS_ARCH_TIMEOUT;				/* Did not get it, report the error					*/
-		*msg   = NULL;							/* Make sure there is an invalid meesage there		*/
+u32_t      Elapse;
+int        Left;								/* Ticks left before the timeout					*/
+sys_mbox_t MailBox;
+int        Tout;
+
+	MailBox = *mbox;
+	Elapse  = (u32_t)G_OStimCnt;				/* Current Abassi internal time						*/
+	Tout    = (timeout == 0) ? -1 : OS_MS_TO_TICK(timeout);
+
+	while (MboxGet(MailBox, msg) != 0) {
+		Left = -1;
+		if (Tout >= 0) {
+			Left = Tout - (int)((u32_t)G_OStimCnt - Elapse);
+			if (Left <= 0) {					/* Did not get it, report the error					*/
+				if (msg != NULL) {				/* Make sure there is an invalid meesage there		*/
+					*msg = NULL;
+				}
+				return(SYS_ARCH_TIMEOUT);
+			}
+		}
+		MailBox->RdWait = 1;					/* Tell the producers then look again, so a post	*/
+		__sync_synchronize();					/* done in between is never missed					*/
+		if (MboxGet(MailBox, msg) == 0) {
+			MailBox->RdWait = 0;
+			break;
+		}
+		SEMwaitBin(MailBox->RdSem, Left);		/* Extra postings are harmless, it re-loops			*/
+		MailBox->RdWait = 0;
 	}
 
+	Elapse = (((u32_t)G_OStimCnt-Elapse)*1000)
+	       / OS_TICK_PER_SEC;					/* Compute elapsed time and convert in milliseconds	*/
+
 	return(Elapse);
 }
 
@@ -346,20 +503,24 @@ u32_t Elapse;
 /*
   Similar to sys_arch_mbox_fetch, but if message is not ready immediately, we'll
   return with SYS_MBOX_EMPTY.  On success, 0 is returned.
+  Single-consumer, as sys_arch_mbox_fetch().
 */
 u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
 {
 u32_t RetVal;
 
 	RetVal = ERR_OK;
-	if (0 != MBXget(*mbox, (intptr_t *)msg, 0)) {
-		*msg   = NULL;							/* Make sure there is an invalid meesage there		*/
+	if (0 != MboxGet(*mbox, msg)) {
+		if (msg != NULL) {
+			*msg = NULL;						/* Make sure there is an invalid meesage there		*/
+		}
 		RetVal = SYS_MBOX_EMPTY;				/* Report the mailbox is empty						*/
 	}
 
 	return(RetVal);
 }
 
+
 /*--------------------------------------------------------------------------------------------------*/
 /*
   Creates and returns a new semaphore. The "count" argument specifies
@@ -373,7 +534,7 @@ sys_sem_t Sema;									/* New semaphore (either SEMopen or parking lot)	*/
 
 	Sema = (sys_sem_t)NULL;
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the parking lot	*/
+	IsrState = PROT_START(&g_SemSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<SYS_SEM_HOLD ; ii++) {		/* Check if a semaphore was freed					*/
 		if (g_SemParking[ii] != (sys_sem_t)NULL) {/* If yes, then take the freed one instead of new	*/
@@ -383,7 +544,7 @@ sys_sem_t Sema;									/* New semaphore (either SEMopen or parking lot)	*/
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_SemSpin, IsrState);
 
 	if (Sema == (sys_sem_t)NULL) {				/* No semaphore was freed							*/
 		Sema = SEMopen(&g_Names[g_IdxSemNames++][0]);
@@ -474,7 +635,7 @@ int IsrState;									/* State of ISRs (enable/disable) before disabling	*/
 
 	STATS_DEC(sys.sem.used);					/* Should be protected. Not, to keep best real-time	*/
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the parking lot*/
+	IsrState = PROT_START(&g_SemSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<SYS_SEM_HOLD ; ii++) {		/* Find an unused entry to memo that semaphore		*/
 		if (g_SemParking[ii] == (sys_sem_t)NULL) {
@@ -483,7 +644,7 @@ int IsrState;									/* State of ISRs (enable/disable) before disabling	*/
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_SemSpin, IsrState);
 												/* No more room to hold deleted semaphores			*/
 	LWIP_ERROR("lwIP (sys_arch.c) - Out room to hold semaphores", (ii<SYS_SEM_HOLD), do{}while(0); );
 
@@ -505,9 +666,9 @@ int         ii;									/* Loop counter										*/
 int         IsrState;							/* State of ISRs (enable/disable) before disabling	*/
 sys_mutex_t Mtx;								/* New mutex (either MTXopen or from parking lot)	*/
 
-	Mtx = (sys_sem_t)NULL;
+	Mtx = (sys_mutex_t)NULL;
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the parking lot	*/
+	IsrState = PROT_START(&g_MtxSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<SYS_MTX_HOLD ; ii++) {		/* Check if a mutex was freed						*/
 		if (g_MtxParking[ii] != (sys_mutex_t)NULL) {/* If yes, then take the freed instead of new	*/
@@ -517,7 +678,7 @@ sys_mutex_t Mtx;								/* New mutex (either MTXopen or from parking lot)	*/
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_MtxSpin, IsrState);
 
 	if (Mtx == (sys_mutex_t)NULL) {				/* No mutex was freed								*/
 		Mtx = MTXopen(&g_Names[g_IdxMtxNames++][0]);
@@ -577,7 +738,7 @@ int IsrState;									/* State of ISRs (enable/disable) before disabling	*/
 
 	(*mutex)->Value = 1;						/* Make sure the mutex is at its initial state		*/
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the arking lot	*/
+	IsrState = PROT_START(&g_MtxSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<SYS_MTX_HOLD ; ii++) {		/* Find an unused entry to memo that semaphore		*/
 		if (g_MtxParking[ii] == (sys_mutex_t)NULL) {
@@ -586,7 +747,7 @@ int IsrState;									/* State of ISRs (enable/disable) before disabling	*/
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_MtxSpin, IsrState);
 												/* No more room to hold deleted mutex				*/
 	LWIP_ERROR("lwIP (sys_arch.c) - Out room to hold mutexes", (ii<SYS_MTX_HOLD), do{}while(0); );
 
@@ -619,7 +780,6 @@ int ii;											/* Loop counter										*/
 		g_TaskFctArg[ii].Fct = (lwip_thread_fn)NULL;
 	}
 
-	g_IdxMbxNames=0;
 	g_IdxMtxNames=0;
 	g_IdxSemNames=0;
 
@@ -662,7 +822,7 @@ sys_thread_t Task;								/* Created task decriptor							*/
 		for(;;);								/* This should be found during development			*/
 	}
 
-	IsrState = PROT_START();					/* Make sure only 1 task plays with the parking lot	*/
+	IsrState = PROT_START(&g_TskSpin);			/* Make sure only 1 task plays with the parking lot	*/
 
 	for (ii=0 ; ii<LWIP_MAX_TASK ; ii++) {
 		if (g_TaskFctArg[ii].Fct == (lwip_thread_fn)NULL) {
@@ -672,7 +832,7 @@ sys_thread_t Task;								/* Created task decriptor							*/
 		}
 	}
 
-	PROT_END(IsrState);
+	PROT_END(&g_TskSpin, IsrState);
 
 	LWIP_ERROR("lwIP (sys_arch.c) - Out room to hold threads", (ii<LWIP_MAX_TASK),  do{}while(0););
 
@@ -707,6 +867,41 @@ struct _TaskFctArg *MyFctArg;					/* My function and argument							*/
 	}
 }
 
+/*--------------------------------------------------------------------------------------------------*/
+/*
+  Short time mutual exclusion on one structure: the interrupts are disabled on the
+  local core and, on multi-core, the lock word of the structure is spun on. Two
+  cores only wait for each other when they access the same structure. Not re-entrant.
+*/
+int sys_spin_lock(sys_spin_t *Lock)
+{
+int IsrState;
+
+	IsrState = OSintOff();
+  #if ((OX_N_CORE) > 1)
+	CORElock(LWIP_SPINLOCK, Lock, 0, 1+COREgetID());
+  #else
+	Lock = Lock;								/* To remove compiler warning						*/
+  #endif
+
+	return(IsrState);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+
+void sys_spin_unlock(sys_spin_t *Lock, int IsrState)
+{
+  #if ((OX_N_CORE) > 1)
+	COREunlock(LWIP_SPINLOCK, Lock, 0);
+  #else
+	Lock = Lock;								/* To remove compiler warning						*/
+  #endif
+	OSintBack(IsrState);
+
+	return;
+}
+
+
 /*--------------------------------------------------------------------------------------------------*/
 /*
   This optional function does a "fast" critical region protection and returns
@@ -731,6 +926,12 @@ struct _TaskFctArg *MyFctArg;					/* My function and argument							*/
 /*       situation.  The blocking means a task switch will happen when the interrupts are disable.	*/
 /*		 This would most likely mean the application would become frozen. That's why a mutex is		*/
 /*       used instead of enabling/disabling ISRs.													*/
+/*																									*/
+/* NOTE: SYS_LIGHTWEIGHT_PROT is NOT per structure: SYS_ARCH_PROTECT() in lwIP 1.4.1 takes no		*/
+/*       argument, so memp, pbuf, mem and the netconn / socket events all share this one recursive	*/
+/*       lock, with the interrupts disabled on the core holding it. Only the locks of this port		*/
+/*       (parking lots, sys_now(), ethernetif RX pool) are per structure, see sys_spin_lock().		*/
+/*       Splitting this one needs changes to the lwIP core and is not done here.					*/
 
 sys_prot_t sys_arch_protect(void)
 {
@@ -816,13 +1017,13 @@ u32_t sys_now(void)
     unsigned int Now;                        /* always be used first to read a ref and then    */
     int          ISRstate;                    /* will be called again sooner than 2^32 ticks    */
     
-    ISRstate = PROT_START();
+    ISRstate = PROT_START(&g_NowSpin);
     Now = (unsigned int)G_OStimCnt;                /* To add extra MSBits we need to work with        */
     if (Prev > Now) {                                /* unsigned variables                            */
         Offset += 0x100000000ULL;                    /* When a rool-=over occurred, increment the    */
     }                                                /* MSBits to add                                */
     Prev = Now;                                    /* Memo for the next call                        */
-    PROT_END(ISRstate);
+    PROT_END(&g_NowSpin, ISRstate);
     
     return((u32_t)(((Offset+(uint64_t)Now) * (OS_TIMER_US)) / 1000LL));
 #else                                                /* OS_TIMER_US is an exact multiple of 1 ms        */
@@ -71,7 +71,12 @@
   #define SYS_DEFAULT_THREAD_STACK_DEPTH	1024
 #endif
 
-typedef MBX_t *sys_mbox_t;
+/* sys_mbox_t: bounded lock-free ring, multi-producer SINGLE-CONSUMER.								*/
+/* Any number of tasks may use sys_mbox_post() / sys_mbox_trypost() concurrently, but at any time	*/
+/* only one task may be in sys_arch_mbox_fetch() / sys_arch_mbox_tryfetch() on a given mailbox.		*/
+/* lwIP only fetches a mailbox from its owner (tcpip thread, netconn user). An application with		*/
+/* several readers must serialize them (e.g. with a sys_mutex_t held around the fetch).				*/
+typedef struct _SysMbox *sys_mbox_t;			/* Lock-free ring, defined in sys_arch.c			*/
 typedef MTX_t *sys_mutex_t;
 typedef SEM_t *sys_sem_t;
 typedef TSK_t *sys_thread_t;
@@ -83,6 +88,11 @@ typedef TSK_t *sys_thread_t;
 #define sys_sem_set_invalid(x)   (*(x)  = (sys_sem_t)  NULL)
 #define sys_sem_valid(x)         (*(x) != (sys_sem_t)  NULL)
 
+typedef volatile int sys_spin_t;				/* Lock word for sys_spin_lock()/sys_spin_unlock()	*/
+
+extern int  sys_spin_lock(sys_spin_t *Lock);
+extern void sys_spin_unlock(sys_spin_t *Lock, int IsrState);
+
 #ifdef __cplusplus
 }
 #endif
@@ -81,6 +81,7 @@
 #include "lwip/pbuf.h"
 #include "lwip/sys.h"
 #include "lwip/stats.h"
+#include "lwip/ip.h"
 #include "sys_arch.h"
 #include "ethernetif.h"
 #include "WebApp.h"
@@ -109,6 +110,14 @@
   #define ETH_LINK_SPEED			-1			/* See PHY_init() in dw_ethernet for the valid		*/
 #endif											/* values. -ve is auto								*/
 
+#ifndef ETH_RX_BUDGET							/* Packets the input task processes before it lets	*/
+  #define ETH_RX_BUDGET				((ETH_N_RXBUF)/2)	/* the other tasks run. 0 is no limit		*/
+#endif
+
+#ifndef ETH_RX_COALESCE_US						/* When the budget is used up, time the input task	*/
+  #define ETH_RX_COALESCE_US		0			/* sleeps with the RX interrupt still masked so		*/
+#endif											/* more packets pile up. 0 only yields the CPU		*/
+
 #ifndef ETH_MULTICORE_ISR
   #define ETH_MULTICORE_ISR			0			/* If 2 or more cores can handle the interrupt		*/
 #endif
@@ -127,7 +136,49 @@
   #error "ETH_PAD_SIZE is negative";
 #endif
 
-#if ((ETH_IS_BUF_PBUF) != 0)
+#ifndef ETH_RX_ZCOPY							/* RX DMA buffers are custom pbufs from a pool		*/
+ #if ((ETH_IS_BUF_PBUF) != 0)					/* handed as is to the stack instead of				*/
+  #define ETH_RX_ZCOPY				1			/* PBUF_POOL pbufs. ETH_BUFFER_PBUF only			*/
+ #else
+  #define ETH_RX_ZCOPY				0
+ #endif
+#endif
+
+#ifndef ETH_RX_POOL_SIZE						/* Buffers in the RX pool: all the descriptors		*/
+  #define ETH_RX_POOL_SIZE			(2*(ETH_N_RXBUF))	/* and as many in the stack					*/
+#endif
+
+#if ((ETH_RX_ZCOPY) != 0)
+  #if ((ETH_IS_BUF_PBUF) == 0)
+	#error "ETH_RX_ZCOPY requires ETH_BUFFER_TYPE set to ETH_BUFFER_PBUF"
+  #endif
+  #if !(LWIP_SUPPORT_CUSTOM_PBUF)
+	#error "ETH_RX_ZCOPY requires the lwIP custom pbufs (LWIP_SUPPORT_CUSTOM_PBUF)"
+  #endif
+  #define RX_POOL_BUFSIZE			(((ETH_RX_BUFSIZE)+(ETH_PAD_SIZE)+(OX_CACHE_LSIZE)-1) \
+								 & ~((OX_CACHE_LSIZE)-1))	/* Whole cache lines as it is invalidated	*/
+  #define RX_PBUF_ALLOC()			RXpoolAlloc()
+#else
+  #define RX_PBUF_ALLOC()			pbuf_alloc(PBUF_RAW, ETH_RX_BUFSIZE+ETH_PAD_SIZE, PBUF_POOL)
+#endif
+
+#ifndef ETH_TX_ZCOPY							/* TX DMA descriptors point to the pbuf payloads	*/
+ #if ((ETH_IS_BUF_PBUF) != 0)					/* instead of copying them. The pbufs are held		*/
+  #define ETH_TX_ZCOPY				1			/* until the DMA is done. ETH_BUFFER_PBUF only		*/
+ #else
+  #define ETH_TX_ZCOPY				0
+ #endif
+#endif
+
+#ifndef ETH_TX_COPY_MAX							/* Segments up to this size are still copied:		*/
+  #define ETH_TX_COPY_MAX			64			/* headers are cheaper to copy than to hold			*/
+#endif
+
+#if (((ETH_TX_ZCOPY) != 0) && ((ETH_IS_BUF_PBUF) == 0))
+	#error "ETH_TX_ZCOPY requires ETH_BUFFER_TYPE set to ETH_BUFFER_PBUF"
+#endif
+
+#if (((ETH_IS_BUF_PBUF) != 0) && ((ETH_RX_ZCOPY) == 0))
   #if ((PBUF_POOL_BUFSIZE) < (ETH_RX_BUFSIZE))
 	#if ((ETH_PAD_SIZE) > 0)
 	  #error "PBUF_POOL_BUFSIZE-ETH_PAD_SIZE must be >= ETH_RX_BUFSIZE when ETH_BUFFER_TYPE is PBUF"
@@ -141,6 +192,12 @@
 static SEM_t        *g_EthRXsem[5]    = {NULL, NULL, NULL, NULL, NULL};
 static SEM_t        *g_EthTXsem[5]    = {NULL, NULL, NULL, NULL, NULL};
 static MTX_t        *g_MyMutex[5]     = {NULL, NULL, NULL, NULL, NULL};
+static int           g_RXbudget[5];				/* Set by ethernetif_rx_moderation()				*/
+static int           g_RXcoalesce[5];
+#ifdef USE_ENHANCED_DMA_DESCRIPTORS				/* Set by ethernetif_timestamp()					*/
+  static int       (*g_TXstampSel[5])(struct pbuf *p);
+  static void      (*g_RXstamp[5])(struct pbuf *p, u32_t Sec, u32_t Nsec);
+#endif
 static const char    g_RXsemName[][9] = {"ETHRX-0", "ETHRX-1", "ETHRX-2", "ETHRX-3", "ETHRX-4"};
 static const char    g_TXsemName[][9] = {"ETHTX-0", "ETHTX-1", "ETHTX-2", "ETHTX-3", "ETHTX-4"};
 static const char    g_EthName[][6]   = {"ETH-0",   "ETH-1",   "ETH-2",   "ETH-3",   "ETH-4"};
@@ -151,6 +208,20 @@ static volatile int  g_DummyRead;				/* Needed to make sure to read DMA status r
   extern ETH_DMAdesc_t G_DMArxDescTbl[ETH_N_RXBUF][ETH_N_RXBUF];
 #endif
 
+#if ((ETH_RX_ZCOPY) != 0)
+  typedef struct {
+	struct pbuf_custom Pbuf;					/* Must be first, the stack sees a struct pbuf		*/
+	void              *Next;					/* Next buffer in the free list						*/
+	u8_t               Mem[RX_POOL_BUFSIZE]		/* DMA buffer, never shares a cache line with		*/
+	                       __attribute__ ((aligned (OX_CACHE_LSIZE)));	/* the pbuf header			*/
+  } RXbuf_t;
+
+  static RXbuf_t    g_RXpool[ETH_RX_POOL_SIZE] __attribute__ ((aligned (OX_CACHE_LSIZE)));
+  static RXbuf_t   *g_RXfree     = NULL;		/* Free list of the pool							*/
+  static int        g_RXpoolInit = 0;
+  static sys_spin_t g_RXspin;				/* Own lock, not the lwIP core one (SYS_ARCH_PROTECT)	*/
+#endif
+
 static err_t ethernetif_0_init(struct netif *netif);
 static err_t ethernetif_1_init(struct netif *netif);
 static err_t ethernetif_2_init(struct netif *netif);
@@ -159,6 +230,9 @@ static err_t ethernetif_4_init(struct netif *netif);
 static err_t ethernetif_init  (struct netif *netif);
 static void  ethernetif_input (void *Arg);
 static err_t low_level_output (struct netif *netif, struct pbuf *p);
+#if ((ETH_TX_ZCOPY) != 0)
+  static void TXreclaim(int DevNmb);
+#endif
 
 err_t (*ethernet_init[])(struct netif *netif) = {  &ethernetif_0_init
                                                   ,&ethernetif_1_init
@@ -171,6 +245,88 @@ err_t (*ethernet_init[])(struct netif *netif) = {  &ethernetif_0_init
   static int g_LockVar[5];
 #endif
 
+/*--------------------------------------------------------------------------------------------------*/
+/* Pool of RX pbufs (ETH_RX_ZCOPY)																	*/
+/* The payload of each pbuf is the DMA buffer of the descriptor it was installed in. A received		*/
+/* packet goes up the stack without any copy and its pbufs come back here when the stack frees it.	*/
+/* The pool is shared by all devices: used by the input tasks and freed by the tcpip thread			*/
+
+#if ((ETH_RX_ZCOPY) != 0)
+
+static void RXpoolFree(struct pbuf *p)
+{
+RXbuf_t *Buf;
+int      IsrState;
+
+	Buf = (RXbuf_t *)p;							/* The pbuf is at the start of the buffer			*/
+	IsrState  = sys_spin_lock(&g_RXspin);
+	Buf->Next = g_RXfree;
+	g_RXfree  = Buf;
+	sys_spin_unlock(&g_RXspin, IsrState);
+
+	return;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static struct pbuf *RXpoolAlloc(void)
+{
+RXbuf_t *Buf;
+int      IsrState;
+
+	IsrState = sys_spin_lock(&g_RXspin);
+	Buf      = g_RXfree;
+	if (Buf != NULL) {
+		g_RXfree = Buf->Next;
+	}
+	sys_spin_unlock(&g_RXspin, IsrState);
+
+	if (Buf == NULL) {							/* Pool empty, the caller drops the packet			*/
+		return(NULL);
+	}
+
+	Buf->Pbuf.custom_free_function = &RXpoolFree;	/* Typed PBUF_POOL, so the stack can move the	*/
+	return(pbuf_alloced_custom(PBUF_RAW, ETH_RX_BUFSIZE+ETH_PAD_SIZE, PBUF_POOL, &Buf->Pbuf,
+	                           &Buf->Mem[0], RX_POOL_BUFSIZE));	/* payload pointer back over the headers	*/
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static void RXpoolInit(void)
+{
+int ii;
+
+	for (ii=0 ; ii<ETH_RX_POOL_SIZE-1 ; ii++) {
+		g_RXpool[ii].Next = &g_RXpool[ii+1];
+	}
+	g_RXpool[ETH_RX_POOL_SIZE-1].Next = NULL;
+	g_RXfree = &g_RXpool[0];
+
+	return;
+}
+
+#endif
+
+/*--------------------------------------------------------------------------------------------------*/
+/* Release the pbufs the TX DMA is done with (ETH_TX_ZCOPY)											*/
+/* Called with the device mutex held, before each transmission and by the input task when the		*/
+/* TX-complete interrupt wakes it up, so the pbufs are not freed in the ISR							*/
+
+#if ((ETH_TX_ZCOPY) != 0)
+
+static void TXreclaim(int DevNmb)
+{
+struct pbuf *Pbuf;
+
+	while ((Pbuf = (struct pbuf *)ETH_Reclaim_Transmit(DevNmb)) != NULL) {
+		pbuf_free(Pbuf);
+	}
+
+	return;
+}
+
+#endif
+
 /*--------------------------------------------------------------------------------------------------*/
 /* Need to set the EMAC I/F # in netif->num but netif_add overwrites netif->num with its own #		*/
 /* be done calling the init function.  We simply use individual init function that sets netif->num	*/
@@ -243,6 +399,12 @@ int ii;											/* General purpose									*/
 		(void)sys_mutex_new(&g_MyMutex[DevNmb]);
 		First = 1;								/* Is the first time init done on this device		*/
 	}
+  #if ((ETH_RX_ZCOPY) != 0)
+	if (g_RXpoolInit == 0) {					/* The RX pool is shared by all devices				*/
+		RXpoolInit();
+		g_RXpoolInit = 1;
+	}
+  #endif
 	MTXunlock(G_OSmutex);
 
 	sys_mutex_lock(&g_MyMutex[DevNmb]);			/* Protect against re-entrance						*/
@@ -281,7 +443,7 @@ int ii;											/* General purpose									*/
   #if ((ETH_IS_BUF_PBUF) != 0)					/* Init Rx Desc list buffers						*/
 	ReMap = ETH_MAP_DEV(DevNmb);
 	for (ii=0 ; ii<ETH_N_RXBUF ; ii++) {		/* Install the buffers in the RX DMA descriptor		*/
-		NewPbuf = pbuf_alloc(PBUF_RAW, PBUF_POOL_BUFSIZE, PBUF_POOL);
+		NewPbuf = RX_PBUF_ALLOC();
 		G_DMArxDescTbl[ReMap][ii].PbufPtr = NewPbuf;
 
 		if (NewPbuf == NULL) {
@@ -331,6 +493,10 @@ int ii;											/* General purpose									*/
 	g_LockVar[DevNmb] = 0;
   #endif
 
+	if (First != 0) {
+		ethernetif_rx_moderation(DevNmb, ETH_RX_BUDGET, ETH_RX_COALESCE_US);
+	}
+
   #if ((ETH_DEBUG) > 1) 
 	printf("ETHN  [Dev:%d] - Ethernet Input task started\n", DevNmb);
   #endif
@@ -379,13 +545,36 @@ int            IsLast;							/* If is the last buffer of a packet				*/
 int            LeftOver;						/* Left over from a packet yet not transmitted		*/
 struct pbuf   *MyPbuf;							/* P buffer being processed							*/
 u32_t          Nbytes;							/* Number of bytes in the buffer					*/
+#if ((ETH_TX_ZCOPY) != 0)
+  struct pbuf *Stale;							/* pbuf left in the descriptor being reused			*/
+  int          IsTCP;							/* If the packet is a TCP segment					*/
+#endif
 
 	DevNmb = (int)netif->num;					/* ->num holds the EMAC I/F # of this netif			*/
 
 	sys_mutex_lock(&g_MyMutex[DevNmb]);			/* Protect against re-entrance						*/
 
+  #if ((ETH_TX_ZCOPY) != 0)
+	TXreclaim(DevNmb);							/* Free what was sent since the last time			*/
+  #endif
+
 	SKIP_PAD(p);								/* Drop the padding word if needed					*/
 
+  #if ((ETH_TX_ZCOPY) != 0)
+	BufPtr = p->payload;						/* IPv4 & TCP: lwIP rewrites the Ethernet, IP		*/
+	IsTCP  = (p->len > 23)						/* and TCP headers in place when it retransmits		*/
+	      && (BufPtr[12] == 0x08)				/* the segment, maybe while the DMA still reads		*/
+	      && (BufPtr[13] == 0x00)				/* them												*/
+	      && (BufPtr[23] == IP_PROTO_TCP);
+  #endif
+
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	if ((g_TXstampSel[DevNmb] != NULL)			/* Time stamp it when sent if asked to				*/
+	&&  (g_TXstampSel[DevNmb](p) != 0)) {
+		ETH_PTPtxArm(DevNmb);
+	}
+  #endif
+
 	IsFirst = 1;
 	IsLast  = 0;
 
@@ -393,7 +582,7 @@ u32_t          Nbytes;							/* Number of bytes in the buffer					*/
 		LeftOver = MyPbuf->len;					/* Number of bytes left to give to the EMAC driver	*/
 		BufPtr   = MyPbuf->payload;				/* Current base address of the data to give			*/
 		while (LeftOver > 0) {					/* Loop in case pbuf payload > DMA buffer size		*/
-			DMAbuf = ETH_Get_Transmit_Buffer(DevNmb);	/* Get the next DMA transmit buffer		*/
+			DMAbuf = ETH_Get_Transmit_Buffer(DevNmb);	/* Get the next DMA transmit buffer			*/
 			if (DMAbuf == NULL) {				/* If NULL, DMA is currently using all the buffers	*/
 				SEMwaitBin(g_EthTXsem[DevNmb], 0);	/* Get rid of any previous postings				*/
 				for (ii=0 ; ii<10 ; ii++) {		/* Try a few time in case DMA is using all buffers	*/
@@ -425,7 +614,24 @@ u32_t          Nbytes;							/* Number of bytes in the buffer					*/
 			IsLast = (MyPbuf->len == MyPbuf->tot_len)
 			       && (LeftOver == 0);			/* Set if it is the last segment of a packet		*/
 
-		  #if ((ETH_IS_BUF_CACHED) != 0)
+		  #if ((ETH_TX_ZCOPY) != 0)
+			if ((MyPbuf->type == PBUF_REF)		/* The application may reuse PBUF_REF memory as		*/
+			||  (Nbytes <= ETH_TX_COPY_MAX)		/* soon as the stack returns: must be copied		*/
+			||  ((IsTCP != 0)					/* Only the PBUF_ROM data of a TCP segment (written	*/
+			 &&  (MyPbuf->type != PBUF_ROM))) {	/* with NETCONN_NOCOPY) is never rewritten			*/
+				Stale  = (struct pbuf *)ETH_Set_Transmit_Buffer(DevNmb, NULL, NULL);
+				DMAbuf = ETH_Get_Transmit_Buffer(DevNmb);
+				SMEMCPY((void *)&DMAbuf[0], BufPtr, Nbytes);
+			}
+			else {								/* The DMA reads the payload, the reference is		*/
+				pbuf_ref(MyPbuf);				/* dropped by TXreclaim() once it is sent			*/
+				Stale = (struct pbuf *)ETH_Set_Transmit_Buffer(DevNmb, BufPtr, MyPbuf);
+			}
+			if (Stale != NULL) {
+				pbuf_free(Stale);
+			}
+			BufPtr += Nbytes;
+		  #elif ((ETH_IS_BUF_CACHED) != 0)
 			if (Nbytes > 0) {
 				SMEMCPY((void *)&DMAbuf[0], BufPtr, Nbytes);
 				BufPtr += Nbytes;				/* Advance the pointer to the next segment payload	*/
@@ -503,6 +709,10 @@ struct pbuf *PbufDst;							/* pbuf with new packek to return to the called		*/
 #if (((ETH_PAD_SIZE) != 0) || ((ETH_IS_BUF_PBUF) == 0))
   u8_t *Buf8;
 #endif
+#ifdef USE_ENHANCED_DMA_DESCRIPTORS
+  u32_t        Sec;								/* Time of reception of the packet					*/
+  u32_t        Nsec;
+#endif
 
 	DevNmb = (int)netif->num;					/* ->num holds the EMAC I/F # of this netif			*/
 
@@ -524,7 +734,7 @@ struct pbuf *PbufDst;							/* pbuf with new packek to return to the called		*/
 			FrmSize = Frame.length;
 			if (FrmSize >= 0) {					/* We have a good frame								*/
 												/* Make sure we can get a replacement pbuf			*/
-				PbufNew = pbuf_alloc(PBUF_RAW, ETH_RX_BUFSIZE+ETH_PAD_SIZE, PBUF_POOL);
+				PbufNew = RX_PBUF_ALLOC();
 
 				if (PbufNew != NULL) {			/* Got a replacement pbuf, proceed					*/
 					if (IsFirst != 0) {			/* First segment of the packet or full packet		*/
@@ -586,6 +796,13 @@ struct pbuf *PbufDst;							/* pbuf with new packek to return to the called		*/
 
 		ETH_Release_Received(DevNmb);			/* Give back the descriptors to the DMA				*/
 
+	  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+		if ((g_RXstamp[DevNmb] != NULL)			/* Hand the time of reception to the app			*/
+		&&  (ETH_PTPrxStamp(DevNmb, &Sec, &Nsec) == 0)) {
+			g_RXstamp[DevNmb](PbufDst, Sec, Nsec);
+		}
+	  #endif
+
 		CLAIM_PAD(PbufDst);
 
 	  #if ((ETH_PAD_SIZE) != 0)
@@ -678,6 +895,13 @@ struct pbuf *PbufDst;							/* pbuf with new packek to return to the called		*/
 
 		ETH_Release_Received(DevNmb);
 
+	  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+		if ((g_RXstamp[DevNmb] != NULL)			/* Hand the time of reception to the app			*/
+		&&  (ETH_PTPrxStamp(DevNmb, &Sec, &Nsec) == 0)) {
+			g_RXstamp[DevNmb](PbufDst, Sec, Nsec);
+		}
+	  #endif
+
 		CLAIM_PAD(PbufDst);
 
 	  #if ((ETH_PAD_SIZE) != 0)
@@ -703,11 +927,15 @@ struct pbuf *PbufDst;							/* pbuf with new packek to return to the called		*/
  * that should handle the actual reception of bytes from the network
  * interface. Then the type of the received packet is determined and
  * the appropriate input function is called.
+ * The ISR masks the RX interrupt when it wakes the task up. The task then polls
+ * the descriptor ring, ETH_RX_BUDGET packets at a time, until it is empty and
+ * only then unmasks the interrupt: one interrupt for a whole burst.
  *
  * @param netif the lwip network interface structure for this ethernetif
  */
 void ethernetif_input(void *Arg)
 {
+int           Count;							/* Packets processed in this round					*/
 int           DevNmb;
 struct netif *netif;
 struct pbuf  *p;
@@ -719,14 +947,37 @@ struct pbuf  *p;
 												/* Block for max of 1s.  This allows periodic		*/
 		SEMwait(g_EthRXsem[DevNmb], OS_TICK_PER_SEC);	/* checks for link up / link down and		*/
 												/* also recovery in case the RX DMA chain is full	*/
-		do {
-			p = low_level_input(netif);			/* Process the input buffer							*/
-			if (p != (struct pbuf *)NULL) {		/* OK, we got a valid buffer						*/
-				if (ERR_OK != netif->input(p, netif)) {	/* Process it								*/
-					pbuf_free(p);				/* If processing error, free the pbuf				*/
+		for (;;) {
+			Count = 0;
+			do {
+				p = low_level_input(netif);		/* Process the input buffer							*/
+				if (p != (struct pbuf *)NULL) {	/* OK, we got a valid buffer						*/
+					if (ERR_OK != netif->input(p, netif)) {	/* Process it							*/
+						pbuf_free(p);			/* If processing error, free the pbuf				*/
+					}
+					Count++;
 				}
+			} while ((p != NULL)
+			  &&     (Count != g_RXbudget[DevNmb]));
+
+		  #if ((ETH_TX_ZCOPY) != 0)
+			sys_mutex_lock(&g_MyMutex[DevNmb]);
+			TXreclaim(DevNmb);					/* Also woken up by the TX-complete interrupt		*/
+			sys_mutex_unlock(&g_MyMutex[DevNmb]);
+		  #endif
+
+			if (p == NULL) {					/* The ring is empty								*/
+				break;
+			}
+			if (g_RXcoalesce[DevNmb] > 0) {		/* Budget used up, still busy: let the others		*/
+				TSKsleep(g_RXcoalesce[DevNmb]);	/* run before polling again							*/
+			}
+			else {
+				TSKyield();
 			}
-		} while (p != NULL);
+		}
+		ETH_DMAisrEnable(DevNmb, EMAC_DMA_INT_RIE);	/* A packet RXed since the ring was seen empty	*/
+												/* raises the interrupt as soon as unmasked			*/
 
 		if (ETH_LinkStatus(DevNmb) == 0) {		/* The link is down, wait for it to be back			*/
 		  #if ((ETH_DEBUG) > 0)
@@ -745,6 +996,76 @@ struct pbuf  *p;
 	}
 }
 
+/*--------------------------------------------------------------------------------------------------*/
+/* Set at run time the RX interrupt moderation of a device											*/
+/* Budget     : packets processed before letting the other tasks run (0: no limit)					*/
+/* CoalesceUs : time to wait when the budget is used up, rounded up to the OS tick (0: yield only)	*/
+
+void ethernetif_rx_moderation(int Dev, int Budget, int CoalesceUs)
+{
+	if (Budget < 0) {
+		Budget = 0;
+	}
+	if (CoalesceUs < 0) {
+		CoalesceUs = 0;
+	}
+
+	g_RXbudget[Dev]   = Budget;
+	g_RXcoalesce[Dev] = (CoalesceUs + OS_TIMER_US - 1)
+	                  / OS_TIMER_US;			/* Ticks of sleep									*/
+
+	return;
+}
+
+/*--------------------------------------------------------------------------------------------------*/
+/* Start the IEEE 1588 time stamping of a device (see ETH_PTPinit())								*/
+/* TXsel   : non-zero when the frame about to be sent is to be time stamped (NULL: none)			*/
+/* RXstamp : gets the time of reception of each frame before the stack (NULL: none)					*/
+/* Both are called with the device locked and the Ethernet header at ->payload: must not send		*/
+/* Returns 0 when OK, -1 when the EMAC can't time stamp												*/
+
+int ethernetif_timestamp(int Dev, int (*TXsel)(struct pbuf *p),
+                         void (*RXstamp)(struct pbuf *p, u32_t Sec, u32_t Nsec))
+{
+int Ret;
+
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	sys_mutex_lock(&g_MyMutex[Dev]);
+
+	Ret = ETH_PTPinit(Dev);
+	if (Ret == 0) {
+		g_TXstampSel[Dev] = TXsel;
+		g_RXstamp[Dev]    = RXstamp;
+	}
+
+	sys_mutex_unlock(&g_MyMutex[Dev]);
+  #else											/* The time stamps are in the enhanced descriptors	*/
+	Ret = -1;
+  #endif
+
+	return(Ret);
+}
+
+
+/*--------------------------------------------------------------------------------------------------*/
+/* Time of transmission of the last frame TXsel selected, see ETH_PTPtxStamp() for the return value	*/
+
+int ethernetif_tx_stamp(int Dev, u32_t *Sec, u32_t *Nsec)
+{
+int Ret;
+
+  #ifdef USE_ENHANCED_DMA_DESCRIPTORS
+	sys_mutex_lock(&g_MyMutex[Dev]);
+	Ret = ETH_PTPtxStamp(Dev, (uint32_t *)Sec, (uint32_t *)Nsec);
+	sys_mutex_unlock(&g_MyMutex[Dev]);
+  #else
+	Ret = -1;
+  #endif
+
+	return(Ret);
+}
+
+
 /*--------------------------------------------------------------------------------------------------*/
 /* EMAC interrupt handlers																			*/
 /*--------------------------------------------------------------------------------------------------*/
@@ -848,12 +1169,16 @@ uint32_t StatReg;								/* Snapshot of the status register					*/
 
 		if ((StatReg & EMAC_DMA_STAT_RI)		/* Was a new frame RXed?							*/
 		&&  (g_EthRXsem[Dev] != NULL)) {		/* Make sure the semaphore is valid					*/
-			SEMpost(g_EthRXsem[Dev]);			/* Post the semaphore ethernetif_input() blocks on	*/
+			ETH_DMAisrDisable(Dev, EMAC_DMA_INT_RIE);	/* ethernetif_input() polls until the ring	*/
+			SEMpost(g_EthRXsem[Dev]);			/* is empty, then unmasks it						*/
 		}
 
 		if ((StatReg & EMAC_DMA_STAT_TI)		/* Was a new frame TXed?							*/
 		&&  (g_EthTXsem[Dev] != NULL)) {		/* Make sure the semaphore is valid					*/
 			SEMpost(g_EthTXsem[Dev]);			/* Post the semaphore low_level_output() uses		*/
+		  #if ((ETH_TX_ZCOPY) != 0)
+			SEMpost(g_EthRXsem[Dev]);			/* ethernetif_input() releases the pbufs sent		*/
+		  #endif
 		}
 												/* Add INT_STAT_PCSLCHGIS & INT_STAT_TSIS if used	*/
 	} while ((EMACreg(Dev, EMAC_INT_STAT_REG) & (EMAC_INT_STAT_RGSMIIIS
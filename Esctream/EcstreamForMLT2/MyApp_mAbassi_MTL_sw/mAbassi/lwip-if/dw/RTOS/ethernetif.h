@@ -41,6 +41,11 @@ extern void Emac2_IRQHandler(void);
 extern void Emac3_IRQHandler(void);
 extern void Emac4_IRQHandler(void);
 
+extern void ethernetif_rx_moderation(int Dev, int Budget, int CoalesceUs);
+extern int  ethernetif_timestamp(int Dev, int (*TXsel)(struct pbuf *p),
+                                 void (*RXstamp)(struct pbuf *p, u32_t Sec, u32_t Nsec));
+extern int  ethernetif_tx_stamp(int Dev, u32_t *Sec, u32_t *Nsec);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,7 +1,7 @@
 #include <Const.h>
 #include <stdlib.h>
 
-void new_player(LVL* level,int offset, int start_x, int start_y, int fin_x, int fin_y, bool color){
+void new_player(LVL* level,int offset, int start_x, int start_y, int fin_x, int fin_y, int color){
     PLAYER* player=level->players+offset;
         player->start_x=start_x;
         player->start_y=start_y;
@@ -12,7 +12,7 @@ void new_player(LVL* level,int offset, int start_x, int start_y, int fin_x, int
         player->y=start_y;
 }
 
-void new_line(LVL* level,int offset,int x, int y, int width, int height, DIR dir, bool color){
+void new_line(LVL* level,int offset,int x, int y, int width, int height, DIR dir, int color){
     LINE* line1 =level->lines+offset;
         line1->x=x;
         line1->y=y;
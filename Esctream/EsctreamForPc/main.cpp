@@ -7,6 +7,7 @@
 #include <SDL/SDL.h>
 #include <Const.h>
 #include <level.c>
+#include <core.h>
 //block la fonction en attendant qu'on quite l'ecran
 void pause()
 {
@@ -25,117 +26,6 @@ void pause()
         }
     }
 }
-//return true si on a gagne, false otherwise
-bool success(LVL* lvl){
-    int nbr_succes=0;
-    for(int i=0;i<lvl->nbr_players;i++){
-      PLAYER* player=lvl->players+i;
-        if((player->fin_x<player->x+PLAYER_WIDTH && player->fin_x>player->x) && (player->fin_y<player->y+PLAYER_HEIGHT && player->fin_y>player->y)){
-        nbr_succes++;
-            printf("VICTORY condition\n");
-        }
-    }
-    return nbr_succes==lvl->nbr_players;
-}
-
-//return true si le joueur se trouve sur la partie non-coupee d'une ligne verticale
-bool notcuty(LINE* line,PLAYER* player){
-    if(line->interrupt==false){
-        return true;
-    }
-    else{
-        switch (line->dir){
-        case UP:
-            if(player->y+PLAYER_HEIGHT<line->stop_at)
-                return false;
-            else
-                return true;
-            break;
-        case DOWN: //to complete !!!!!!!!!!!!!!!!!!!!!
-                return false;
-            break;
-        }
-    }
-}
-
-//return true si le joueur se trouve sur la partie non-coupee d'une ligne horizontale
-bool notcutx(LINE* line,PLAYER* player){
-    if(line->interrupt==false){
-        return true;
-    }
-    else{
-        switch (line->dir){
-        case LEFT:
-            if(player->x+PLAYER_WIDTH<line->stop_at)
-                return false;
-            else
-                return true;
-            break;
-        case RIGHT:
-                return false;
-            break;
-        }
-    }
-}
-
-//analyse la position des players par rapport aux lines, en cas de collision declare une defaite ou declare une ligne comme interompue
-void pos_correlator(LVL* lvl){
-    for(int j=0;j<lvl->nbr_lines;j++){
-        LINE* line=lvl->lines+j;
-        bool no_interrupt[lvl->nbr_players];//permet de remettre  false line->interrupt quand il n'y a plus d'interrupt
-        for(int i=0;i<lvl->nbr_players;i++){
-            PLAYER* player=lvl->players+i;
-            int lx=line->x;
-            int px=player->x;
-            int pxpw=player->x+PLAYER_WIDTH;
-            int lxlw=line->x+line->width;
-            no_interrupt[i]=true;
-           if((lx>px && lx<pxpw) ||( lxlw >px && lxlw<pxpw)){
-                if(line->color==player->color){
-                    if(notcuty(line,player)){
-                        defeat=true;
-                    }
-                }
-                else{
-                    line->interrupt=true;
-                    no_interrupt[i]=false;
-                    if(line->dir==UP){
-                        line->stop_at=player->y+PLAYER_HEIGHT;
-                    }
-                    else if(line->dir==DOWN){
-                        line->stop_at=player->y;
-                    }
-                }
-           }
-           int ly=line->y;
-           int lylh=line->y+line->height;
-           int py=player->y;
-           int pyph=player->y+PLAYER_HEIGHT;
-           if((ly<pyph && ly>py) || (lylh>py && lylh <pyph )){
-                if(line->color==player->color){
-                    if(notcutx(line,player)){
-                        defeat=true;
-                    }
-                }
-                else{
-                    line->interrupt=true;
-                    no_interrupt[i]=false;
-                    if(line->dir==LEFT){
-                        line->stop_at=player->x+PLAYER_WIDTH;
-                    }
-                    else if(line->dir==RIGHT){
-                        line->stop_at=player->x+PLAYER_HEIGHT;
-                    }
-                }
-            }
-        printf("line->interrupt %d\n",line->interrupt);
-        }
-        if(no_interrupt[0] && no_interrupt[1]){
-            line->interrupt=false;
-            printf("(no_interrupt[0] && no_interrupt[1])=true\n");
-        }
-    }
-}
 void change_pos(PLAYER* player,int dest_x,int dest_y){
     if(dest_x>player->x)
         player->x++;
@@ -283,7 +173,8 @@ bool play_lvl(int niv,SDL_Surface* ecran){
             SDL_BlitSurface(Players_Surfaces[i], NULL, ecran, &Players_Rect[i]); //plot le player
             SDL_BlitSurface(Dest[i], NULL, ecran, &R_Dest[i]);
         }
-        pos_correlator(lvl);//detect les collisions
+        if(pos_correlator(lvl))//detect les collisions
+            defeat=true;
         interrupt_modif(lvl, Lines_Rect,Lines_Surfaces,ecran);//modifie si collision + replot les lines
         victory=success(lvl);//determine si il y a victoire
         SDL_Flip(ecran);//mise  jour de l'ecran
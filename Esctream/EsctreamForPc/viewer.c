@@ -0,0 +1,254 @@
+/*
+ * viewer.c
+ *
+ *  Spectator viewer of the board screen: shows the tiles the board streams on
+ *  TCP port 5900 when built with GAME_STREAM=1 (see src/stream.c of the board
+ *  and game/tilecodec.h for the format), or a stream file written by the
+ *  replay of the Linux host build (replay -s), played at the session pace.
+ *
+ *  Usage: viewer board_ip [port]
+ *         viewer -f stream.fbs
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL/SDL.h>
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <errno.h>
+    #include <netdb.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <unistd.h>
+    #define closesocket close
+#endif
+#include "tilecodec.h"
+
+#define VIEWER_PORT "5900"
+#define VIEWER_POLL_MS 50       // Longest wait for data before the window events are handled
+
+typedef struct
+{
+    FILE *file;         // Stream file, NULL when reading from the board
+    int sock;
+} SOURCE;
+
+static bool quit = false;
+
+// Handles the window events, true once the viewer is closed
+static bool viewer_Events(void)
+{
+    SDL_Event event;
+
+    while (SDL_PollEvent(&event))
+        if (event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE))
+            quit = true;
+    return quit;
+}
+
+// Waits ms milliseconds, the window events still handled
+static void viewer_Wait(uint32_t ms)
+{
+    uint32_t spent, start = SDL_GetTicks();
+
+    while (!viewer_Events() && (spent = SDL_GetTicks() - start) < ms)
+        SDL_Delay(ms - spent < VIEWER_POLL_MS ? ms - spent : VIEWER_POLL_MS);
+}
+
+// The board may send nothing for a while: the reads time out so the window
+// keeps handling its events and can be closed
+static void source_Timeout(SOURCE *src)
+{
+#ifdef _WIN32
+    DWORD ms = VIEWER_POLL_MS;
+    setsockopt(src->sock, SOL_SOCKET, SO_RCVTIMEO, (const char *) &ms, sizeof(ms));
+#else
+    struct timeval tv = { 0, VIEWER_POLL_MS * 1000 };
+    setsockopt(src->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+}
+
+static bool source_TimedOut(void)
+{
+#ifdef _WIN32
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// Fails at the end of the stream or once the viewer is closed
+static bool source_Read(SOURCE *src, void *buf, int len)
+{
+    char *p = (char *) buf;
+    int n;
+
+    if (src->file != NULL)
+        return fread(buf, 1, len, src->file) == (size_t) len;
+    while (len > 0)
+    {
+        n = recv(src->sock, p, len, 0);
+        if (n < 0 && source_TimedOut())
+        {
+            if (viewer_Events())
+                return false;
+            continue;
+        }
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static int source_Connect(const char *host, const char *port)
+{
+    struct addrinfo hints, *res, *ai;
+    int sock = -1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+        return -1;
+    for (ai = res; ai != NULL && sock < 0; ai = ai->ai_next)
+    {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock >= 0 && connect(sock, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            closesocket(sock);
+            sock = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return sock;
+}
+
+// Copies the tiles received since the last frame to the screen
+static void show(SDL_Surface *screen, const TILE_DEC *dec, SDL_Rect *dirty, int n)
+{
+    int i, x, y;
+
+    SDL_LockSurface(screen);
+    for (i = 0; i < n; i++)
+        for (y = dirty[i].y; y < dirty[i].y + dirty[i].h; y++)
+        {
+            const uint32_t *src = dec->fb + y * dec->width + dirty[i].x;
+            Uint32 *dst = (Uint32 *) ((Uint8 *) screen->pixels + y * screen->pitch) + dirty[i].x;
+            for (x = 0; x < dirty[i].w; x++)
+                dst[x] = SDL_MapRGB(screen->format, src[x] >> 16, src[x] >> 8, src[x]);
+        }
+    SDL_UnlockSurface(screen);
+    SDL_UpdateRects(screen, n, dirty);
+}
+
+int main(int argc, char *argv[])
+{
+    SOURCE src = { NULL, -1 };
+    TILE_DEC dec;
+    SDL_Surface *screen;
+    SDL_Rect *dirty;
+    uint8_t hdr[TILE_HDR_SIZE], rec[TILE_REC_SIZE], data[TILE_MAX_BYTES];
+    uint32_t time, last = 0, frames = 0, bytes = 0, tick;
+    int ndirty = 0, index, len;
+    bool first = true;
+    char title[64];
+
+    if (argc == 3 && strcmp(argv[1], "-f") == 0)
+        src.file = fopen(argv[2], "rb");
+    else if (argc == 2 || argc == 3)
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+        src.sock = source_Connect(argv[1], argc == 3 ? argv[2] : VIEWER_PORT);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s board_ip [port]\n       %s -f stream.fbs\n", argv[0], argv[0]);
+        return 2;
+    }
+    if (src.file == NULL && src.sock < 0)
+    {
+        fprintf(stderr, "viewer: cannot open %s\n", argv[argc-1]);
+        return 1;
+    }
+    if (!source_Read(&src, hdr, sizeof(hdr)) || !TILE_DecInit(&dec, hdr))
+    {
+        fprintf(stderr, "viewer: not a screen stream\n");
+        return 1;
+    }
+
+    SDL_Init(SDL_INIT_VIDEO);
+    screen = SDL_SetVideoMode(dec.width, dec.height, 32, SDL_SWSURFACE);
+    dirty = (SDL_Rect *) malloc(dec.tiles_x * dec.tiles_y * sizeof(SDL_Rect));
+    if (screen == NULL || dirty == NULL)
+    {
+        fprintf(stderr, "viewer: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_WM_SetCaption("Esctream viewer", NULL);
+    tick = SDL_GetTicks();
+    if (src.file == NULL)
+        source_Timeout(&src);
+
+    while (!quit && source_Read(&src, rec, sizeof(rec)))
+    {
+        index = rec[0] | rec[1] << 8;
+        len = rec[2] | rec[3] << 8;
+        bytes += sizeof(rec) + len;
+        if (len > (int) sizeof(data) || !source_Read(&src, data, len))
+            break;
+        if (index != TILE_END)
+        {
+            if (!TILE_DecTile(&dec, index, data, len))
+            {
+                fprintf(stderr, "viewer: bad tile %d\n", index);
+                break;
+            }
+            if (ndirty < dec.tiles_x * dec.tiles_y)     // A tile is sent once per frame
+            {
+                SDL_Rect *r = &dirty[ndirty++];
+                r->x = (index % dec.tiles_x) * TILE_SIZE;
+                r->y = (index / dec.tiles_x) * TILE_SIZE;
+                r->w = dec.width - r->x < TILE_SIZE ? dec.width - r->x : TILE_SIZE;
+                r->h = dec.height - r->y < TILE_SIZE ? dec.height - r->y : TILE_SIZE;
+            }
+            continue;
+        }
+
+        // End of a frame: time of its flip on the board
+        time = data[0] | data[1] << 8 | data[2] << 16 | (uint32_t) data[3] << 24;
+        if (src.file != NULL && !first && time - last < 1000000)
+            viewer_Wait((time - last) / 1000);
+        last = time;
+        first = false;
+        show(screen, &dec, dirty, ndirty);
+        ndirty = 0;
+        frames++;
+
+        if (SDL_GetTicks() - tick >= 1000)
+        {
+            sprintf(title, "Esctream viewer - %u fps, %u kbit/s", (unsigned) frames,
+                    (unsigned) (bytes * 8 / (SDL_GetTicks() - tick)));
+            SDL_WM_SetCaption(title, NULL);
+            tick = SDL_GetTicks();
+            frames = 0;
+            bytes = 0;
+        }
+        viewer_Events();
+    }
+
+    if (src.file != NULL)
+        fclose(src.file);
+    else
+        closesocket(src.sock);
+    TILE_DecFree(&dec);
+    free(dirty);
+    SDL_Quit();
+    return 0;
+}
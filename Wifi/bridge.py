@@ -0,0 +1,252 @@
+#Event-driven bridge between the SPI link of a board and the Pi of the other player
+#
+#One loop (selectors) polls the SPI at a fixed rate, or as soon as the data-ready
+#GPIO of the board rises, and moves whole SPI frames (see game/frame.h of the
+#board application) to the other Pi, one frame per message (see transport.py),
+#over TCP or UDP:
+#  board -> SPI words -> frame -> message -> other Pi
+#  other Pi -> message -> frame words -> SPI words -> board (FRAME_IDLE when nothing to send)
+#The latency of each message through the bridge is counted in both directions,
+#as well as the network latency given by the time of the sender, and printed
+#every --stats seconds (the network figure needs the clocks of the Pis in sync).
+#
+#Without a board: python3 bridge.py --loopback
+#runs two bridges and two fake boards over 127.0.0.1 and prints the board to
+#board latency.
+import argparse
+import binascii
+import os
+import selectors
+import socket
+import struct
+import time
+import transport
+
+#Same values as game/frame.h
+FRAME_MAGIC=0xA5
+FRAME_IDLE=0x00000000
+FRAME_PAYLOAD_MAX=16
+FRAME_OVERHEAD=3
+FRAME_WORDS=1
+
+def now_us():
+  return time.monotonic_ns()//1000
+
+#CRC-32 of the board: the words are taken little endian
+def crc32(words):
+  return binascii.crc32(struct.pack('<%dI' % len(words), *words)) & 0xFFFFFFFF
+
+def is_header(w):
+  return (w>>24)==FRAME_MAGIC and (w&0xFF)<=FRAME_PAYLOAD_MAX
+
+def make_frame(player,seq,time,payload):
+  header=(FRAME_MAGIC<<24)|(player<<20)|(FRAME_WORDS<<16)|((seq&0xFF)<<8)|len(payload)
+  words=[header,time&0xFFFFFFFF]+payload
+  return words+[crc32(words)]
+
+#Collects the words of a frame, anything between frames (FRAME_IDLE) is dropped
+class Deframer:
+  def __init__(self):
+    self.words=[]
+    self.length=0
+  def put(self,w):
+    if not self.words:
+      if not is_header(w):
+        return None
+      self.length=(w&0xFF)+FRAME_OVERHEAD
+    self.words.append(w)
+    if len(self.words)<self.length:
+      return None
+    frame,self.words=self.words,[]
+    return frame
+  def busy(self):
+    return len(self.words)>0
+
+class Latency:
+  def __init__(self,name):
+    self.name=name
+    self.reset()
+  def reset(self):
+    self.count=0
+    self.total=0
+    self.max=0
+  def add(self,us):
+    self.count+=1
+    self.total+=us
+    self.max=max(self.max,us)
+  def report(self):
+    if self.count==0:
+      return '%s: no message' % self.name
+    return '%s: %d msgs, avg %d us, max %d us' % (self.name,self.count,self.total//self.count,self.max)
+
+#SPI of the Pi, the Pi is master: every transfer sends a word and reads one
+class Spi:
+  def __init__(self,bus,device,hz):
+    import spidev
+    self.dev=spidev.SpiDev()
+    self.dev.open(bus,device)
+    self.dev.max_speed_hz=hz
+  def xfer(self,w):
+    return struct.unpack('>I',bytes(self.dev.xfer2(list(struct.pack('>I',w)))))[0]
+
+#Stands for a board on the SPI: sends its position in a new frame every period
+#and checks the frames it gets (time words are now_us(), so on one host the
+#board to board latency is known)
+class FakeBoard:
+  def __init__(self,player,period_us):
+    self.player=player
+    self.period=period_us
+    self.next=0
+    self.seq=0
+    self.out=[]
+    self.rx=Deframer()
+    self.latency=Latency('board %d <- other board' % player)
+    self.bad=0
+  def xfer(self,w):
+    frame=self.rx.put(w)
+    if frame is not None:
+      if crc32(frame[:-1])!=frame[-1]:
+        self.bad+=1
+      else:
+        self.latency.add((now_us()-frame[1]) & 0xFFFFFFFF)
+    t=now_us()
+    if not self.out and t>=self.next:
+      self.next=t+self.period
+      position=(self.player<<20)|((self.seq%800)<<10)|(self.seq%480)
+      self.out=make_frame(self.player,self.seq,t,[position])
+      self.seq+=1
+    return self.out.pop(0) if self.out else FRAME_IDLE
+
+class Bridge:
+  def __init__(self,sel,spi,kind,addr,listen,rate,burst):
+    self.spi=spi
+    self.period=1.0/rate
+    self.burst=burst
+    self.next_poll=time.monotonic()
+    self.peer=transport.open_link(kind,sel,addr,listen,self.received)
+    self.rx=Deframer()
+    self.rx_start=0
+    self.tx=[] #(words, reception time) waiting for the SPI
+    self.tx_words=[]
+    self.tx_start=0
+    self.dropped=0
+    self.spi_to_net=Latency('SPI -> network')
+    self.net_to_spi=Latency('network -> SPI')
+    self.network=Latency('network')
+
+  def received(self,words,seq,sent):
+    self.network.add(max(0,transport.wall_us()-sent))
+    self.tx.append((words,now_us()))
+
+  #Moves words until there is nothing left to send nor to receive (burst at most)
+  def poll_spi(self):
+    for n in range(self.burst):
+      if not self.tx_words and self.tx:
+        self.tx_words,self.tx_start=self.tx.pop(0)
+      w=self.tx_words.pop(0) if self.tx_words else FRAME_IDLE
+      if not self.tx_words and self.tx_start:
+        self.net_to_spi.add(now_us()-self.tx_start)
+        self.tx_start=0
+      started=self.rx.busy()
+      frame=self.rx.put(self.spi.xfer(w))
+      if not started and self.rx.busy():
+        self.rx_start=now_us()
+      if frame is not None:
+        if self.peer.send(frame):
+          self.spi_to_net.add(now_us()-(self.rx_start or now_us()))
+        else:
+          self.dropped+=1
+        self.rx_start=0
+      if not self.tx_words and not self.tx and not self.rx.busy():
+        break
+
+  #Called by the loop, returns the time of the next call
+  def tick(self):
+    self.peer.tick()
+    t=time.monotonic()
+    if t>=self.next_poll:
+      self.poll_spi()
+      self.next_poll=max(self.next_poll+self.period,t)
+    return self.next_poll
+
+  def report(self):
+    line='%s | %s | %s' % (self.spi_to_net.report(),self.network.report(),self.net_to_spi.report())
+    if self.dropped:
+      line+=' | %d frames dropped while disconnected' % self.dropped
+    if getattr(self.peer,'stale',0):
+      line+=' | %d stale messages dropped' % self.peer.stale
+    self.spi_to_net.reset()
+    self.network.reset()
+    self.net_to_spi.reset()
+    return line
+
+#Data-ready line of the board: the GPIO callback thread only wakes the loop up
+def watch_gpio(sel,pin,bridge):
+  import RPi.GPIO as GPIO
+  r,w=os.pipe()
+  os.set_blocking(r,False)
+  def wake(mask):
+    os.read(r,64)
+    bridge.poll_spi()
+  sel.register(r,selectors.EVENT_READ,wake)
+  GPIO.setmode(GPIO.BCM)
+  GPIO.setwarnings(False)
+  GPIO.setup(pin,GPIO.IN)
+  GPIO.add_event_detect(pin,GPIO.RISING,callback=lambda channel: os.write(w,b'x'))
+
+def run(sel,bridges,stats,duration=None):
+  end=None if duration is None else time.monotonic()+duration
+  next_stats=time.monotonic()+stats if stats else None
+  while end is None or time.monotonic()<end:
+    deadline=min(b.tick() for b in bridges)
+    for key,mask in sel.select(max(0,deadline-time.monotonic())):
+      key.data(mask)
+    if next_stats is not None and time.monotonic()>=next_stats:
+      next_stats+=stats
+      for b in bridges:
+        print(b.report())
+
+def loopback(args):
+  sel=selectors.DefaultSelector()
+  boards=[FakeBoard(0,args.fake_period*1000),FakeBoard(1,args.fake_period*1000)]
+  a=Bridge(sel,boards[0],args.transport,('127.0.0.1',0),True,args.rate,args.burst)
+  b=Bridge(sel,boards[1],args.transport,a.peer.addr,False,args.rate,args.burst)
+  run(sel,[a,b],args.stats,args.duration)
+  for board in boards:
+    print(board.latency.report()+(' | %d bad frames' % board.bad if board.bad else ''))
+  for bridge in (a,b):
+    print(bridge.report())
+
+def address(text):
+  host,port=text.rsplit(':',1)
+  return (host,int(port))
+
+def main(argv=None):
+  p=argparse.ArgumentParser(description='SPI to network bridge of a player')
+  g=p.add_mutually_exclusive_group(required=True)
+  g.add_argument('--listen',type=address,metavar='HOST:PORT',help='wait for the other Pi')
+  g.add_argument('--connect',type=address,metavar='HOST:PORT',help='connect to the other Pi')
+  g.add_argument('--loopback',action='store_true',help='two bridges and fake boards on this host')
+  p.add_argument('--transport',choices=('tcp','udp'),default='tcp',help='udp: latest position wins, not for lockstep')
+  p.add_argument('--rate',type=float,default=1000,help='SPI polls per second (default 1000)')
+  p.add_argument('--burst',type=int,default=64,help='max SPI words per poll (default 64)')
+  p.add_argument('--drdy',type=int,metavar='GPIO',help='BCM pin of the data-ready line of the board')
+  p.add_argument('--spi-hz',type=int,default=500000)
+  p.add_argument('--fake',type=int,metavar='PLAYER',help='fake board of this player instead of the SPI')
+  p.add_argument('--fake-period',type=float,default=20,help='ms between the frames of a fake board')
+  p.add_argument('--stats',type=float,default=5,help='seconds between latency reports, 0 for none')
+  p.add_argument('--duration',type=float,default=5,help='loopback test length (s)')
+  args=p.parse_args(argv)
+
+  if args.loopback:
+    loopback(args)
+    return
+  sel=selectors.DefaultSelector()
+  spi=FakeBoard(args.fake,args.fake_period*1000) if args.fake is not None else Spi(0,0,args.spi_hz)
+  bridge=Bridge(sel,spi,args.transport,args.listen or args.connect,args.listen is not None,args.rate,args.burst)
+  if args.drdy is not None:
+    watch_gpio(sel,args.drdy,bridge)
+  run(sel,[bridge],args.stats)
+
+if __name__=='__main__':
+  main()
@@ -0,0 +1,322 @@
+#Binary messages between the Pis of the players, over TCP or UDP
+#
+#Every message is
+#  length	2 bytes, bytes after this field
+#  kind		1 byte, KIND_DATA or KIND_HELLO
+#  seq		4 bytes, sequence number of the sender
+#  time		8 bytes, wall clock of the sender when sent (us)
+#  payload	32-bit words (an SPI frame, see bridge.py)
+#all big endian. Over TCP (with TCP_NODELAY) the length splits the stream back
+#into messages, however recv() cuts it. Over UDP one datagram is one message
+#and the latest value wins: a message older than the last one received is
+#dropped, so a lost or late datagram never holds the newer ones back. UDP is
+#for position updates only, the lockstep inputs need TCP.
+#
+#Loopback benchmark: python3 transport.py --bench [--transport udp]
+import argparse
+import errno
+import selectors
+import socket
+import struct
+import time
+
+HEADER=struct.Struct('>HBIQ')
+KIND_DATA=1
+KIND_HELLO=2 #UDP only: lets the listening side learn the address of the other
+STALE_WINDOW=1024 #Sequences behind the last one dropped as stale, further back the sender restarted
+HELLO_PERIOD=1.0
+MAX_MESSAGE=1400
+BENCH_BURST=32 #Messages sent between two polls of the benchmark loop
+
+def wall_us():
+  return time.time_ns()//1000
+
+def pack(kind,seq,words):
+  return HEADER.pack(HEADER.size-2+4*len(words),kind,seq&0xFFFFFFFF,wall_us())+struct.pack('>%dI' % len(words),*words)
+
+#(kind, seq, time, words) of a message without its length, None if malformed
+def unpack(data):
+  if len(data)<HEADER.size-2 or (len(data)-HEADER.size+2)%4:
+    return None
+  kind,seq,sent=struct.unpack_from('>BIQ',data)
+  return kind,seq,sent,list(struct.unpack_from('>%dI' % ((len(data)-HEADER.size+2)//4),data,HEADER.size-2))
+
+#Latest value wins: true when seq is newer than every sequence accepted so far
+class SeqFilter:
+  def __init__(self):
+    self.last=None
+    self.stale=0
+  def accept(self,seq):
+    if self.last is not None and ((self.last-seq) & 0xFFFFFFFF)<STALE_WINDOW:
+      self.stale+=1
+      return False
+    self.last=seq
+    return True
+
+#Non-blocking TCP connection to the other Pi. The listening side accepts again
+#and the connecting side retries after a loss. on_message(words,seq,time).
+class TcpLink:
+  def __init__(self,sel,addr,listen,on_message):
+    self.sel=sel
+    self.addr=addr
+    self.listen=listen
+    self.on_message=on_message
+    self.sock=None
+    self.server=None
+    self.connected=False
+    self.retry=0
+    self.seq=0
+    self.inbuf=bytearray()
+    self.outbuf=bytearray()
+    if listen:
+      self.server=socket.socket(socket.AF_INET,socket.SOCK_STREAM)
+      self.server.setsockopt(socket.SOL_SOCKET,socket.SO_REUSEADDR,1)
+      self.server.bind(addr)
+      self.server.listen(1)
+      self.server.setblocking(False)
+      self.addr=self.server.getsockname()
+      sel.register(self.server,selectors.EVENT_READ,self.accept)
+
+  def accept(self,mask):
+    sock,other=self.server.accept()
+    if self.sock is not None:
+      sock.close()
+      return
+    print('Got connection from',other[0])
+    self.attach(sock)
+    self.connected=True
+    self.update()
+
+  def attach(self,sock):
+    sock.setblocking(False)
+    sock.setsockopt(socket.IPPROTO_TCP,socket.TCP_NODELAY,1)
+    self.sock=sock
+    self.inbuf=bytearray()
+    self.outbuf=bytearray()
+    self.sel.register(sock,selectors.EVENT_READ,self.event)
+
+  #Called by the loop: starts a connection when there is none
+  def tick(self):
+    if self.listen or self.sock is not None or time.monotonic()<self.retry:
+      return
+    sock=socket.socket(socket.AF_INET,socket.SOCK_STREAM)
+    self.attach(sock)
+    err=sock.connect_ex(self.addr)
+    if err not in (0,errno.EINPROGRESS):
+      self.close()
+      return
+    self.sel.modify(sock,selectors.EVENT_READ|selectors.EVENT_WRITE,self.event)
+
+  def close(self):
+    if self.sock is not None:
+      self.sel.unregister(self.sock)
+      self.sock.close()
+    if self.connected:
+      print('Connection lost')
+    self.sock=None
+    self.connected=False
+    self.retry=time.monotonic()+1
+
+  def update(self):
+    mask=selectors.EVENT_READ
+    if self.outbuf or not self.connected:
+      mask|=selectors.EVENT_WRITE
+    self.sel.modify(self.sock,mask,self.event)
+
+  def event(self,mask):
+    if not self.connected and mask & selectors.EVENT_WRITE:
+      if self.sock.getsockopt(socket.SOL_SOCKET,socket.SO_ERROR)!=0:
+        self.close()
+        return
+      print('Connected to',self.addr[0])
+      self.connected=True
+    if mask & selectors.EVENT_READ:
+      try:
+        data=self.sock.recv(65536)
+      except BlockingIOError:
+        data=None
+      except OSError:
+        data=b''
+      if data==b'':
+        self.close()
+        return
+      if data:
+        self.inbuf+=data
+        self.parse()
+    if self.sock is not None and self.outbuf:
+      self.flush()
+    if self.sock is not None:
+      self.update()
+
+  #Every complete message, several may come in one recv()
+  def parse(self):
+    while len(self.inbuf)>=2:
+      length=struct.unpack_from('>H',self.inbuf)[0]
+      if len(self.inbuf)<2+length:
+        break
+      msg=unpack(bytes(self.inbuf[2:2+length]))
+      del self.inbuf[:2+length]
+      if msg is None:
+        print('Malformed message, connection dropped')
+        self.close()
+        return
+      kind,seq,sent,words=msg
+      if kind==KIND_DATA:
+        self.on_message(words,seq,sent)
+
+  def flush(self):
+    try:
+      sent=self.sock.send(self.outbuf)
+      del self.outbuf[:sent]
+    except BlockingIOError:
+      pass
+    except OSError:
+      self.close()
+
+  #false when not connected, the message is then dropped
+  def send(self,words):
+    if not self.connected:
+      return False
+    self.outbuf+=pack(KIND_DATA,self.seq,words)
+    self.seq+=1
+    self.flush()
+    if self.sock is not None:
+      self.update()
+    return self.connected
+
+#UDP to the other Pi. The listening side answers the address the last message
+#came from, the connecting side says hello until it hears from the other.
+class UdpLink:
+  def __init__(self,sel,addr,listen,on_message):
+    self.on_message=on_message
+    self.sock=socket.socket(socket.AF_INET,socket.SOCK_DGRAM)
+    self.sock.setblocking(False)
+    self.sock.bind(addr if listen else ('',0))
+    self.listen=listen
+    self.addr=self.sock.getsockname() if listen else addr
+    self.peer=None if listen else addr
+    self.heard=0
+    self.hello=0
+    self.seq=0
+    self.filter=SeqFilter()
+    self.dropped=0
+    sel.register(self.sock,selectors.EVENT_READ,self.event)
+
+  @property
+  def connected(self):
+    return self.peer is not None
+
+  @property
+  def stale(self):
+    return self.filter.stale
+
+  def tick(self):
+    t=time.monotonic()
+    if not self.listen and t-self.heard>HELLO_PERIOD and t>=self.hello:
+      self.hello=t+HELLO_PERIOD
+      self.sendto(pack(KIND_HELLO,0,[]))
+
+  def event(self,mask):
+    for i in range(64):
+      try:
+        data,source=self.sock.recvfrom(MAX_MESSAGE)
+      except (BlockingIOError,ConnectionRefusedError):
+        return
+      msg=unpack(data[2:]) if len(data)>=2 and struct.unpack_from('>H',data)[0]==len(data)-2 else None
+      if msg is None:
+        continue
+      self.heard=time.monotonic()
+      if self.listen:
+        self.peer=source
+      kind,seq,sent,words=msg
+      if kind==KIND_DATA and self.filter.accept(seq):
+        self.on_message(words,seq,sent)
+
+  def sendto(self,data):
+    try:
+      self.sock.sendto(data,self.peer)
+      return True
+    except (BlockingIOError,OSError):
+      self.dropped+=1
+      return False
+
+  def send(self,words):
+    if self.peer is None:
+      return False
+    data=pack(KIND_DATA,self.seq,words)
+    self.seq+=1
+    return self.sendto(data)
+
+def open_link(transport,sel,addr,listen,on_message):
+  return (UdpLink if transport=='udp' else TcpLink)(sel,addr,listen,on_message)
+
+def percentile(values,p):
+  return values[min(len(values)-1,int(len(values)*p/100))]
+
+#Sends count messages of size words from a link to another over 127.0.0.1,
+#paced (rate per second) for the latency or back to back for the throughput
+def bench(transport,count,size,rate):
+  sel=selectors.DefaultSelector()
+  latency=[]
+  def received(words,seq,sent):
+    latency.append(wall_us()-sent)
+  rx=open_link(transport,sel,('127.0.0.1',0),True,received)
+  tx=open_link(transport,sel,rx.addr,False,lambda words,seq,sent: None)
+  payload=list(range(size))
+
+  end=time.monotonic()+5
+  while not (tx.connected and rx.connected) and time.monotonic()<end:
+    tx.tick()
+    rx.tick()
+    for key,mask in sel.select(0.01):
+      key.data(mask)
+  latency.clear()
+
+  sent=0
+  start=time.monotonic()
+  period=1.0/rate if rate else 0
+  next_send=start
+  while len(latency)<count and time.monotonic()-start<60:
+    t=time.monotonic()
+    burst=0
+    while sent<count and t>=next_send and burst<BENCH_BURST:
+      if not tx.send(payload):
+        break
+      burst+=1
+      sent+=1
+      next_send+=period
+      if period and next_send<t:
+        next_send=t
+    timeout=0 if sent<count and not period else max(0,next_send-time.monotonic())
+    for key,mask in sel.select(min(timeout,0.01)):
+      key.data(mask)
+    if transport=='udp' and sent>=count and len(latency)<count and time.monotonic()-next_send>1:
+      break #The rest was lost
+  elapsed=time.monotonic()-start
+
+  latency.sort()
+  lost=count-len(latency)
+  if not latency:
+    print('%s: nothing received' % transport)
+    return
+  print('%s %s: %d msgs of %d bytes, p50 %d us, p99 %d us, max %d us, %.0f msgs/s, %.2f MB/s%s' % (
+    transport,'paced %d/s' % rate if rate else 'flood',len(latency),HEADER.size+4*size,
+    percentile(latency,50),percentile(latency,99),latency[-1],len(latency)/elapsed,
+    len(latency)*(HEADER.size+4*size)/elapsed/1e6,', %d lost' % lost if lost else ''))
+  if transport=='udp' and rx.stale:
+    print('  %d stale messages dropped' % rx.stale)
+
+def main(argv=None):
+  p=argparse.ArgumentParser(description='Loopback benchmark of the player link')
+  p.add_argument('--bench',action='store_true',required=True)
+  p.add_argument('--transport',choices=('tcp','udp','both'),default='both')
+  p.add_argument('--count',type=int,default=10000)
+  p.add_argument('--size',type=int,default=4,help='payload words (an SPI frame with one word is 4)')
+  p.add_argument('--rate',type=float,default=1000,help='messages per second of the latency run')
+  args=p.parse_args(argv)
+  for transport in ('tcp','udp') if args.transport=='both' else (args.transport,):
+    bench(transport,args.count//10 if args.rate else args.count,args.size,args.rate)
+    bench(transport,args.count,args.size,0)
+
+if __name__=='__main__':
+  main()